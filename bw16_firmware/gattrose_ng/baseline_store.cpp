@@ -0,0 +1,177 @@
+#include "baseline_store.h"
+#include "proto.h"
+#include <string.h>
+
+#define BS_ENTRY_MAX    (17 + 32)
+
+// Worst case fits a slot; checked here so RD_MAX_BASELINE can't outgrow it
+static_assert(BS_HEADER_LEN + RD_MAX_BASELINE * BS_ENTRY_MAX <= BS_SLOT_SIZE,
+              "baseline record doesn't fit a store slot");
+
+static uint8_t recordBuf[BS_SLOT_SIZE];     // Shared by load and save
+
+static uint16_t getU16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t getU32(const uint8_t* p) {
+    return getU16(p) | ((uint32_t)getU16(p + 2) << 16);
+}
+
+typedef struct {
+    uint16_t flags;
+    uint32_t generation;
+    uint16_t count;
+    uint16_t body_len;
+    uint16_t crc;
+} RecordHeader;
+
+static bool readHeader(int slot, RecordHeader* h) {
+    uint8_t raw[BS_HEADER_LEN];
+    if (!storeReadSlot(slot, 0, raw, sizeof(raw))) return false;
+    if (getU32(raw) != BS_MAGIC || getU16(raw + 4) != BS_VERSION) return false;
+    h->flags = getU16(raw + 6);
+    h->generation = getU32(raw + 8);
+    h->count = getU16(raw + 12);
+    h->body_len = getU16(raw + 14);
+    h->crc = getU16(raw + 16);
+    return h->count <= RD_MAX_BASELINE && h->body_len <= BS_SLOT_SIZE - BS_HEADER_LEN;
+}
+
+void baselineStoreInit(BaselineStore* bs) {
+    memset(bs, 0, sizeof(*bs));
+    bs->slot = -1;
+}
+
+// ============== Load ==============
+
+static bool parseBody(RogueDetector* rd, const uint8_t* body, uint16_t len, uint16_t count) {
+    rogueClearBaseline(rd);
+    uint16_t off = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        if (off + 17 > len) return false;
+        const uint8_t* p = body + off;
+        uint8_t ssidLen = p[16];
+        if (ssidLen > 32 || off + 17 + ssidLen > len) return false;
+
+        char ssid[33];
+        memcpy(ssid, p + 17, ssidLen);
+        ssid[ssidLen] = '\0';
+        if (!rogueAddBaseline(rd, p, ssid, p[6])) return false;
+
+        RogueBaselineEntry& e = rd->baseline[macIndexFind(&rd->bssid_index, macToKey(p))];
+        e.fp_known = (p[7] & BS_FP_KNOWN) != 0;
+        e.capability = getU16(p + 8);
+        e.beacon_interval = getU16(p + 10);
+        e.sec_hash = getU32(p + 12);
+        off += 17 + ssidLen;
+    }
+    return off == len;
+}
+
+bool baselineLoad(BaselineStore* bs, RogueDetector* rd) {
+    RecordHeader h[BS_SLOTS];
+    bool valid[BS_SLOTS];
+    for (int s = 0; s < BS_SLOTS; s++) valid[s] = readHeader(s, &h[s]);
+
+    // Newest first; fall back to the other slot if the newest is damaged
+    int order[BS_SLOTS] = {0, 1};
+    if (valid[1] && (!valid[0] || (int32_t)(h[1].generation - h[0].generation) > 0)) {
+        order[0] = 1;
+        order[1] = 0;
+    }
+    for (int i = 0; i < BS_SLOTS; i++) {
+        int s = order[i];
+        if (!valid[s]) continue;
+        if (!storeReadSlot(s, BS_HEADER_LEN, recordBuf, h[s].body_len)) continue;
+        if (crc16Ccitt(recordBuf, h[s].body_len) != h[s].crc) continue;
+        if (!parseBody(rd, recordBuf, h[s].body_len, h[s].count)) continue;
+
+        rd->active = (h[s].flags & BS_FLAG_ACTIVE) != 0;
+        bs->slot = s;
+        bs->generation = h[s].generation;
+        bs->flags = h[s].flags;
+        bs->count = h[s].count;
+        bs->body_len = h[s].body_len;
+        bs->crc = h[s].crc;
+        return true;
+    }
+    rogueClearBaseline(rd);
+    return false;
+}
+
+// ============== Save ==============
+
+// Byte-compares body against what the slot holds, a chunk at a time
+static bool slotHolds(int slot, const uint8_t* body, uint16_t len) {
+    uint8_t chunk[64];
+    for (uint16_t off = 0; off < len; off += sizeof(chunk)) {
+        uint16_t n = (len - off < (int)sizeof(chunk)) ? len - off : sizeof(chunk);
+        if (!storeReadSlot(slot, BS_HEADER_LEN + off, chunk, n)) return false;
+        if (memcmp(chunk, body + off, n) != 0) return false;
+    }
+    return true;
+}
+
+int baselineSave(BaselineStore* bs, const RogueDetector* rd) {
+    ProtoBuf pb;
+    protoBufInit(&pb, recordBuf + BS_HEADER_LEN, BS_SLOT_SIZE - BS_HEADER_LEN);
+    for (size_t i = 0; i < rd->baseline.size(); i++) {
+        const RogueBaselineEntry& e = rd->baseline[i];
+        uint8_t bssid[6];
+        keyToMac(e.bssid, bssid);
+        uint8_t ssidLen = strlen(e.ssid);
+        protoPutBytes(&pb, bssid, 6);
+        protoPutU8(&pb, e.channel);
+        protoPutU8(&pb, e.fp_known ? BS_FP_KNOWN : 0);
+        protoPutU16(&pb, e.capability);
+        protoPutU16(&pb, e.beacon_interval);
+        protoPutU32(&pb, e.sec_hash);
+        protoPutU8(&pb, ssidLen);
+        protoPutBytes(&pb, e.ssid, ssidLen);
+    }
+    if (pb.overflow) return BS_FAILED;
+
+    uint16_t flags = rd->active ? BS_FLAG_ACTIVE : 0;
+    uint16_t count = rd->baseline.size();
+    uint16_t crc = crc16Ccitt(pb.buf, pb.len);
+    // Flash wears per erase, so an identical record is never rewritten
+    if (bs->slot >= 0 && flags == bs->flags && count == bs->count &&
+        pb.len == bs->body_len && crc == bs->crc && slotHolds(bs->slot, pb.buf, pb.len)) {
+        return BS_UNCHANGED;
+    }
+
+    // The slot not holding the current record, so that one survives a failed write
+    int slot = (bs->slot == 0) ? 1 : 0;
+    uint32_t generation = bs->generation + 1;
+    ProtoBuf hb;
+    protoBufInit(&hb, recordBuf, BS_HEADER_LEN);
+    protoPutU32(&hb, BS_MAGIC);
+    protoPutU16(&hb, BS_VERSION);
+    protoPutU16(&hb, flags);
+    protoPutU32(&hb, generation);
+    protoPutU16(&hb, count);
+    protoPutU16(&hb, pb.len);
+    protoPutU16(&hb, crc);
+
+    bs->writes++;
+    if (!storeWriteSlot(slot, recordBuf, BS_HEADER_LEN + pb.len, BS_HEADER_LEN)) return BS_FAILED;
+
+    bs->slot = slot;
+    bs->generation = generation;
+    bs->flags = flags;
+    bs->count = count;
+    bs->body_len = pb.len;
+    bs->crc = crc;
+    return BS_SAVED;
+}
+
+bool baselineErase(BaselineStore* bs) {
+    bool ok = true;
+    for (int s = 0; s < BS_SLOTS; s++) {
+        if (!storeEraseSlot(s)) ok = false;
+    }
+    bs->slot = -1;
+    bs->generation = 0;
+    return ok;
+}
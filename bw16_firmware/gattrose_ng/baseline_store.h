@@ -0,0 +1,62 @@
+#ifndef GATTROSE_BASELINE_STORE_H
+#define GATTROSE_BASELINE_STORE_H
+
+#include <stdint.h>
+#include "rogue_detect.h"
+
+/*
+ * Rogue AP baseline persistence. Portable; the raw storage is two slots
+ * behind the storeReadSlot()/storeWriteSlot() hooks (flash on the BW16).
+ *
+ * Record, little-endian:
+ *   magic u32 | version u16 | flags u16 | generation u32 | count u16 |
+ *   body_len u16 | crc u16 (CRC16-CCITT over body)
+ *   then per AP: bssid[6] | channel u8 | fp_flags u8 | capability u16 |
+ *   beacon_interval u16 | sec_hash u32 | ssid_len u8 | ssid[ssid_len]
+ *
+ * Saves alternate between the slots with an increasing generation and
+ * the header goes down last, so a write cut short by power loss leaves the
+ * previous record intact. Loading takes the newest slot whose CRC checks
+ * out. A save whose content matches the stored record writes nothing.
+ */
+
+#define BS_MAGIC        0x4C425247u     // "GRBL"
+#define BS_VERSION      1
+#define BS_SLOTS        2
+#define BS_SLOT_SIZE    8192            // Flash erase sectors are 4 KB
+#define BS_HEADER_LEN   18
+
+#define BS_FLAG_ACTIVE  0x0001          // Monitoring was on; resume at boot
+#define BS_FP_KNOWN     0x01
+
+enum { BS_SAVED, BS_UNCHANGED, BS_FAILED };
+
+typedef struct {
+    int slot;                   // Holding the current record, -1 if none
+    uint32_t generation;
+    uint16_t flags;
+    uint16_t count;
+    uint16_t body_len;
+    uint16_t crc;
+    uint32_t writes;            // Slot writes attempted since boot
+} BaselineStore;
+
+void baselineStoreInit(BaselineStore* bs);
+
+// Loads the newest valid record into rd, including its active flag.
+// Returns false, leaving rd's baseline empty, if neither slot holds one.
+bool baselineLoad(BaselineStore* bs, RogueDetector* rd);
+
+// Writes rd's baseline and active flag. BS_UNCHANGED skips the write.
+int baselineSave(BaselineStore* bs, const RogueDetector* rd);
+
+// Invalidates both slots
+bool baselineErase(BaselineStore* bs);
+
+// Platform hooks: slot I/O. storeWriteSlot() erases the slot first; len
+// bytes at buf go to offset 0, with the first headerLen bytes written last.
+bool storeReadSlot(int slot, uint32_t offset, void* buf, uint32_t len);
+bool storeWriteSlot(int slot, const uint8_t* buf, uint32_t len, uint32_t headerLen);
+bool storeEraseSlot(int slot);
+
+#endif
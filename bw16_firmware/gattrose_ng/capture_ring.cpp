@@ -0,0 +1,47 @@
+#include "capture_ring.h"
+
+#define CAPTURE_RING_MASK (CAPTURE_RING_SLOTS - 1)
+
+void captureRingInit(CaptureRing* ring) {
+    ring->head.store(0, std::memory_order_relaxed);
+    ring->tail.store(0, std::memory_order_relaxed);
+    ring->high_water.store(0, std::memory_order_relaxed);
+    ring->drops.store(0, std::memory_order_relaxed);
+    ring->truncated.store(0, std::memory_order_relaxed);
+}
+
+CaptureFrame* captureRingReserve(CaptureRing* ring) {
+    uint32_t head = ring->head.load(std::memory_order_relaxed);
+    uint32_t tail = ring->tail.load(std::memory_order_acquire);
+    if (head - tail >= CAPTURE_RING_SLOTS) {
+        ring->drops.fetch_add(1, std::memory_order_relaxed);
+        return NULL;
+    }
+    return &ring->slots[head & CAPTURE_RING_MASK];
+}
+
+uint32_t captureRingCommit(CaptureRing* ring) {
+    uint32_t head = ring->head.load(std::memory_order_relaxed) + 1;
+    ring->head.store(head, std::memory_order_release);
+
+    // Only the producer writes high_water, so no CAS needed
+    uint32_t used = head - ring->tail.load(std::memory_order_relaxed);
+    if (used > ring->high_water.load(std::memory_order_relaxed)) {
+        ring->high_water.store(used, std::memory_order_relaxed);
+    }
+    return used;
+}
+
+const CaptureFrame* captureRingPeek(CaptureRing* ring) {
+    uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+    if (ring->head.load(std::memory_order_acquire) == tail) return NULL;
+    return &ring->slots[tail & CAPTURE_RING_MASK];
+}
+
+void captureRingRelease(CaptureRing* ring) {
+    ring->tail.store(ring->tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+uint32_t captureRingUsed(CaptureRing* ring) {
+    return ring->head.load(std::memory_order_relaxed) - ring->tail.load(std::memory_order_relaxed);
+}
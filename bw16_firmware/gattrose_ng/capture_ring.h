@@ -0,0 +1,55 @@
+#ifndef GATTROSE_CAPTURE_RING_H
+#define GATTROSE_CAPTURE_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+/*
+ * Single-producer / single-consumer ring of captured 802.11 frames.
+ *
+ * The promiscuous callback is the only producer: it reserves the next slot,
+ * copies the first CAPTURE_SNAP_LEN bytes of the frame plus radio metadata
+ * straight into it, and commits. A worker task is the only consumer and
+ * does all parsing. Neither side blocks; when the ring is full the frame is
+ * dropped and counted so an overrun shows up in the stats.
+ */
+
+#define CAPTURE_RING_SLOTS  32      // Must be a power of two
+#define CAPTURE_SNAP_LEN    320     // Headers, IEs and an EAPOL-Key with key data
+
+typedef struct {
+    uint16_t len;                   // Length on air
+    uint16_t cap_len;               // Bytes stored in data
+    int8_t rssi;
+    uint8_t channel;
+    bool has_bssid;                 // bssid came from the driver's frame info
+    uint8_t bssid[6];
+    uint8_t data[CAPTURE_SNAP_LEN];
+} CaptureFrame;
+
+typedef struct {
+    CaptureFrame slots[CAPTURE_RING_SLOTS];
+    std::atomic<uint32_t> head;     // Next slot to fill (producer)
+    std::atomic<uint32_t> tail;     // Next slot to drain (consumer)
+
+    // Stats (reported by the 'i' command)
+    std::atomic<uint32_t> high_water;   // Max slots in use
+    std::atomic<uint32_t> drops;        // Frames lost because the ring was full
+    std::atomic<uint32_t> truncated;    // Frames longer than CAPTURE_SNAP_LEN
+} CaptureRing;
+
+void captureRingInit(CaptureRing* ring);
+
+// Producer: returns the slot to fill, or NULL (and counts a drop) if full
+CaptureFrame* captureRingReserve(CaptureRing* ring);
+// Producer: publishes the reserved slot. Returns the occupancy afterwards.
+uint32_t captureRingCommit(CaptureRing* ring);
+
+// Consumer: oldest frame or NULL if empty; release it when done
+const CaptureFrame* captureRingPeek(CaptureRing* ring);
+void captureRingRelease(CaptureRing* ring);
+
+uint32_t captureRingUsed(CaptureRing* ring);
+
+#endif
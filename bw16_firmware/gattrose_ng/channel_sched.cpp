@@ -0,0 +1,124 @@
+#include "channel_sched.h"
+#include <string.h>
+
+int chanToSlot(int channel) {
+    if (channel >= 1 && channel <= 14) return channel - 1;
+    if (channel >= 36 && channel <= 64 && channel % 4 == 0) return 14 + (channel - 36) / 4;
+    if (channel >= 100 && channel <= 144 && channel % 4 == 0) return 22 + (channel - 100) / 4;
+    if (channel >= 149 && channel <= 165 && (channel - 149) % 4 == 0) return 34 + (channel - 149) / 4;
+    return -1;
+}
+
+int chanSlotToChannel(int slot) {
+    if (slot < 0 || slot >= CHAN_SLOTS) return 0;
+    if (slot < 14) return slot + 1;
+    if (slot < 22) return 36 + (slot - 14) * 4;
+    if (slot < 34) return 100 + (slot - 22) * 4;
+    return 149 + (slot - 34) * 4;
+}
+
+void chanSchedInit(ChanSched* s) {
+    memset(s, 0, sizeof(*s));
+    for (int i = 0; i < CHAN_SLOTS; i++) {
+        s->slots[i].channel = chanSlotToChannel(i);
+        s->slots[i].weight = CHAN_WEIGHT_UNKNOWN;
+    }
+}
+
+void chanSchedAddAp(ChanSched* s, int channel) {
+    int slot = chanToSlot(channel);
+    if (slot < 0) return;
+    ChanState* c = &s->slots[slot];
+    if (c->ap_count == 0) s->active++;
+    if (c->ap_count < 255) c->ap_count++;
+}
+
+void chanSchedRemoveAp(ChanSched* s, int channel) {
+    int slot = chanToSlot(channel);
+    if (slot < 0) return;
+    ChanState* c = &s->slots[slot];
+    if (c->ap_count == 0) return;
+    if (--c->ap_count == 0) s->active--;
+}
+
+// Keeps the learned rates - the same channels usually come back on rescan
+void chanSchedClearAps(ChanSched* s) {
+    for (int i = 0; i < CHAN_SLOTS; i++) {
+        s->slots[i].ap_count = 0;
+    }
+    s->active = 0;
+}
+
+int chanSchedNext(ChanSched* s, uint32_t now, uint32_t* dwell_ms) {
+    int best = -1;
+    uint64_t bestScore = 0;
+    int overdue = -1;
+    uint32_t overdueAge = 0;
+    uint32_t maxWeight = 1;
+
+    for (int i = 0; i < CHAN_SLOTS; i++) {
+        ChanState* c = &s->slots[i];
+        if (c->ap_count == 0) continue;
+
+        uint32_t age = c->visits ? now - c->last_visit : now;
+        if (age >= CHAN_REVISIT_MS && age >= overdueAge) {
+            overdue = i;
+            overdueAge = age;
+        }
+
+        uint64_t score = (uint64_t)c->weight * (age + 1);
+        if (best < 0 || score > bestScore) {
+            best = i;
+            bestScore = score;
+        }
+        if (c->weight > maxWeight) maxWeight = c->weight;
+    }
+
+    if (best < 0) return 0;
+    if (overdue >= 0) best = overdue;
+
+    ChanState* c = &s->slots[best];
+    *dwell_ms = CHAN_DWELL_MIN_MS +
+                (uint32_t)((uint64_t)(CHAN_DWELL_MAX_MS - CHAN_DWELL_MIN_MS) * c->weight / maxWeight);
+    return c->channel;
+}
+
+static uint32_t windowWeight(const ChanState* c) {
+    uint32_t dwell = 0, frames = 0, newClients = 0;
+    for (int i = 0; i < c->sample_count; i++) {
+        dwell += c->samples[i].dwell_ms;
+        frames += c->samples[i].frames;
+        newClients += c->samples[i].new_clients;
+    }
+    if (dwell == 0) return CHAN_WEIGHT_UNKNOWN;
+
+    uint64_t framesPerSec = (uint64_t)frames * 1000 / dwell;
+    uint64_t clientsPerMin = (uint64_t)newClients * 60000 / dwell;
+    uint64_t w = CHAN_WEIGHT_BASE + framesPerSec + CHAN_WEIGHT_CLIENT * clientsPerMin;
+    return w > CHAN_WEIGHT_MAX ? CHAN_WEIGHT_MAX : (uint32_t)w;
+}
+
+static inline uint16_t clampU16(uint32_t v) {
+    return v > 0xFFFF ? 0xFFFF : (uint16_t)v;
+}
+
+void chanSchedRecord(ChanSched* s, int channel, uint32_t now, uint32_t dwell_ms,
+                     uint32_t frames, uint32_t new_clients) {
+    int slot = chanToSlot(channel);
+    if (slot < 0) return;
+    ChanState* c = &s->slots[slot];
+
+    ChanSample* smp = &c->samples[c->sample_head];
+    smp->dwell_ms = clampU16(dwell_ms);
+    smp->frames = clampU16(frames);
+    smp->new_clients = clampU16(new_clients);
+    c->sample_head = (c->sample_head + 1) % CHAN_WINDOW;
+    if (c->sample_count < CHAN_WINDOW) c->sample_count++;
+
+    c->weight = windowWeight(c);
+    c->last_visit = now;
+    c->visits++;
+    c->total_dwell_ms += dwell_ms;
+    c->total_frames += frames;
+    c->total_new_clients += new_clients;
+}
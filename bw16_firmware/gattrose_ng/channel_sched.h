@@ -0,0 +1,76 @@
+#ifndef GATTROSE_CHANNEL_SCHED_H
+#define GATTROSE_CHANNEL_SCHED_H
+
+#include <stdint.h>
+
+/*
+ * Adaptive channel dwell scheduler for promiscuous client discovery.
+ *
+ * Every channel that has at least one known AP is scheduled. Each channel
+ * keeps its last CHAN_WINDOW visits (dwell, frames, new clients) and derives
+ * a weight from the frame rate and new-client rate over that window. The
+ * next channel is the one with the highest weight * time-since-visit, so
+ * airtime share follows weight, and its dwell scales with its weight
+ * relative to the busiest channel. A channel left unvisited for
+ * CHAN_REVISIT_MS jumps the queue regardless of weight.
+ *
+ * No platform dependencies - time is passed in by the caller.
+ */
+
+#define CHAN_SLOTS 39               // 2.4 GHz 1-14 plus 5 GHz 36-165
+#define CHAN_WINDOW 8               // Visits kept per channel for rate estimates
+#define CHAN_DWELL_MIN_MS 250
+#define CHAN_DWELL_MAX_MS 3000
+#define CHAN_REVISIT_MS 10000       // Max gap between visits to an active channel
+
+#define CHAN_WEIGHT_BASE 10         // Floor so quiet channels still get airtime
+#define CHAN_WEIGHT_CLIENT 20       // Per new client/min - what a survey is after
+#define CHAN_WEIGHT_UNKNOWN 1000    // Unsampled channels get explored first
+#define CHAN_WEIGHT_MAX 10000
+
+typedef struct {
+    uint16_t dwell_ms;
+    uint16_t frames;
+    uint16_t new_clients;
+} ChanSample;
+
+typedef struct {
+    uint8_t channel;
+    uint8_t ap_count;               // Known APs here; 0 = not scheduled
+    uint8_t sample_head;
+    uint8_t sample_count;
+    ChanSample samples[CHAN_WINDOW];
+    uint32_t weight;                // Recomputed after each visit
+    uint32_t last_visit;            // ms
+
+    // Lifetime totals for reporting
+    uint32_t visits;
+    uint32_t total_dwell_ms;
+    uint32_t total_frames;
+    uint32_t total_new_clients;
+} ChanState;
+
+typedef struct {
+    ChanState slots[CHAN_SLOTS];
+    uint8_t active;                 // Slots with ap_count > 0
+} ChanSched;
+
+// Channel number <-> slot. chanToSlot returns -1 for unknown channels.
+int chanToSlot(int channel);
+int chanSlotToChannel(int slot);
+
+void chanSchedInit(ChanSched* s);
+
+// Channel set, maintained as APs come and go
+void chanSchedAddAp(ChanSched* s, int channel);
+void chanSchedRemoveAp(ChanSched* s, int channel);
+void chanSchedClearAps(ChanSched* s);
+
+// Returns the channel to visit next and its dwell, or 0 if no channel is active
+int chanSchedNext(ChanSched* s, uint32_t now, uint32_t* dwell_ms);
+
+// Feeds back what a visit yielded
+void chanSchedRecord(ChanSched* s, int channel, uint32_t now, uint32_t dwell_ms,
+                     uint32_t frames, uint32_t new_clients);
+
+#endif
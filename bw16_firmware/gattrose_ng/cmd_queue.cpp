@@ -0,0 +1,125 @@
+#include "cmd_queue.h"
+#include <string.h>
+
+#define CMD_QUEUE_MASK (CMD_QUEUE_SLOTS - 1)
+
+// ============== Framing ==============
+
+// Moves a leading "#<id>" into msg->req_id. False if it is malformed.
+static bool takeRequestId(CmdMsg* msg) {
+    msg->req_id = 0;
+    if (msg->text[0] != '#') return true;
+
+    uint32_t id = 0;
+    int pos = 1;
+    while (pos < msg->len && msg->text[pos] >= '0' && msg->text[pos] <= '9') {
+        id = id * 10 + (msg->text[pos++] - '0');
+        if (id > 0xFFFF) return false;
+    }
+    if (pos == 1 || id == 0 || pos == msg->len) return false;
+
+    msg->req_id = (uint16_t)id;
+    msg->len -= pos;
+    memmove(msg->text, msg->text + pos, msg->len + 1);
+    return true;
+}
+
+void cmdFramerInit(CmdFramer* f, uint8_t source) {
+    memset(f, 0, sizeof(*f));
+    f->msg.source = source;
+}
+
+int cmdFramerPush(CmdFramer* f, uint8_t b) {
+    if (b == CMD_STX) {
+        f->in_frame = true;
+        f->overflow = false;
+        f->msg.len = 0;
+        return CMD_FRAME_NONE;
+    }
+    if (!f->in_frame) return CMD_FRAME_NONE;
+
+    if (b == CMD_ETX) {
+        f->in_frame = false;
+        if (f->overflow) return CMD_FRAME_TOO_LONG;
+        if (f->msg.len == 0) return CMD_FRAME_NONE;
+        f->msg.text[f->msg.len] = '\0';
+        return takeRequestId(&f->msg) ? CMD_FRAME_DONE : CMD_FRAME_BAD_ID;
+    }
+
+    if (f->msg.len < CMD_MAX_LEN) f->msg.text[f->msg.len++] = (char)b;
+    else f->overflow = true;
+    return CMD_FRAME_NONE;
+}
+
+// ============== Queue ==============
+
+void cmdQueueInit(CmdQueue* q) {
+    q->head.store(0, std::memory_order_relaxed);
+    q->tail.store(0, std::memory_order_relaxed);
+    q->high_water.store(0, std::memory_order_relaxed);
+    q->drops.store(0, std::memory_order_relaxed);
+    q->too_long.store(0, std::memory_order_relaxed);
+    q->bad_id.store(0, std::memory_order_relaxed);
+}
+
+bool cmdQueuePush(CmdQueue* q, const CmdMsg* msg) {
+    uint32_t head = q->head.load(std::memory_order_relaxed);
+    uint32_t tail = q->tail.load(std::memory_order_acquire);
+    if (head - tail >= CMD_QUEUE_SLOTS) {
+        q->drops.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    CmdMsg* slot = &q->slots[head & CMD_QUEUE_MASK];
+    slot->source = msg->source;
+    slot->len = msg->len;
+    slot->req_id = msg->req_id;
+    slot->received_us = msg->received_us;
+    memcpy(slot->text, msg->text, msg->len);
+    slot->text[msg->len] = '\0';
+    q->head.store(head + 1, std::memory_order_release);
+
+    // Only the producer writes high_water, so no CAS needed
+    uint32_t used = head + 1 - tail;
+    if (used > q->high_water.load(std::memory_order_relaxed)) {
+        q->high_water.store(used, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+CmdMsg* cmdQueuePeek(CmdQueue* q) {
+    uint32_t tail = q->tail.load(std::memory_order_relaxed);
+    if (q->head.load(std::memory_order_acquire) == tail) return NULL;
+    return &q->slots[tail & CMD_QUEUE_MASK];
+}
+
+void cmdQueueRelease(CmdQueue* q) {
+    q->tail.store(q->tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+uint32_t cmdQueueUsed(CmdQueue* q) {
+    return q->head.load(std::memory_order_relaxed) - q->tail.load(std::memory_order_relaxed);
+}
+
+// ============== Classification ==============
+
+bool cmdIsSlow(const CmdMsg* msg) {
+    switch (msg->text[0]) {
+        case 'w': return true;                      // Evil twin start/stop settle delays
+        case 'x': return true;                      // Stops everything, evil twin included
+        default: return false;
+    }
+}
+
+bool cmdOnWorker(const CmdMsg* msg) {
+    switch (msg->text[0]) {
+        case 'g': return true;                      // Network list
+        case 'c': return true;                      // Client list and table stats
+        case 'h': return true;                      // PMKID list
+        case 'H': return true;                      // Handshake list
+        case 'R': return msg->text[1] == '1';       // Baseline from the network table
+        case 'u':                                   // Table resync, "ur" or "u<SEP>r"
+            return msg->text[1] == 'r' || (msg->text[1] == 0x1D && msg->text[2] == 'r');
+        default: return false;
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef GATTROSE_CMD_QUEUE_H
+#define GATTROSE_CMD_QUEUE_H
+
+#include <stdint.h>
+#include <atomic>
+
+/*
+ * Command intake: STX/ETX framing and a bounded queue of whole commands.
+ * Portable.
+ *
+ * Each serial port gets a CmdFramer. The intake task feeds it every byte
+ * received and, once the ETX arrives, pushes the finished command into a
+ * CmdQueue. The dispatcher task is the only consumer. A command is copied
+ * into its own slot, so bytes arriving while an earlier one runs can never
+ * overwrite it. Commands longer than CMD_MAX_LEN are discarded whole rather
+ * than run truncated; a full queue drops the new command. Both are counted.
+ *
+ * A command may start with an optional request ID, "#<1-65535>", directly
+ * followed by the command letter. The framer strips it into CmdMsg.req_id
+ * so handlers see the same text either way; the sketch echoes it in every
+ * response to that command.
+ */
+
+#define CMD_MAX_LEN         128     // Command letter and arguments, without STX/ETX
+#define CMD_QUEUE_SLOTS     8       // Must be a power of two
+#define CMD_STX             0x02    // Same framing bytes as the responses
+#define CMD_ETX             0x03
+
+enum { CMD_SRC_FLIPPER, CMD_SRC_USB };
+
+typedef struct {
+    uint8_t source;                 // CMD_SRC_*
+    uint8_t len;
+    uint16_t req_id;                // From the "#<id>" prefix, 0 if none
+    uint32_t received_us;           // When the ETX arrived, for latency stats
+    char text[CMD_MAX_LEN + 1];     // NUL-terminated; text[0] is the command
+} CmdMsg;
+
+typedef struct {
+    CmdMsg msg;                     // Command being assembled
+    bool in_frame;                  // Between an STX and its ETX
+    bool overflow;                  // Current frame ran past CMD_MAX_LEN
+} CmdFramer;
+
+enum { CMD_FRAME_NONE, CMD_FRAME_DONE, CMD_FRAME_TOO_LONG, CMD_FRAME_BAD_ID };
+
+void cmdFramerInit(CmdFramer* f, uint8_t source);
+
+// Feeds one received byte. CMD_FRAME_DONE means f->msg holds a complete,
+// non-empty command (received_us is left to the caller). Bytes outside a
+// frame are ignored and an STX inside one starts over. CMD_FRAME_BAD_ID is
+// a frame whose "#" prefix isn't an ID in range followed by a command.
+int cmdFramerPush(CmdFramer* f, uint8_t b);
+
+typedef struct {
+    CmdMsg slots[CMD_QUEUE_SLOTS];
+    std::atomic<uint32_t> head;     // Next slot to fill (producer)
+    std::atomic<uint32_t> tail;     // Next slot to drain (consumer)
+
+    // Stats (reported by the 'i' command)
+    std::atomic<uint32_t> high_water;   // Max slots in use
+    std::atomic<uint32_t> drops;        // Commands lost because the queue was full
+    std::atomic<uint32_t> too_long;     // Frames discarded for exceeding CMD_MAX_LEN
+    std::atomic<uint32_t> bad_id;       // Frames discarded for a malformed request ID
+} CmdQueue;
+
+void cmdQueueInit(CmdQueue* q);
+
+// Producer: copies msg into the next slot. False (and a drop) if full.
+bool cmdQueuePush(CmdQueue* q, const CmdMsg* msg);
+
+// Consumer: oldest command or NULL if empty; release it when done
+CmdMsg* cmdQueuePeek(CmdQueue* q);
+void cmdQueueRelease(CmdQueue* q);
+
+uint32_t cmdQueueUsed(CmdQueue* q);
+
+// True for commands whose handler blocks for seconds (evil twin start/stop,
+// stop all). The dispatcher hands these to a worker so quick commands keep
+// being answered meanwhile.
+bool cmdIsSlow(const CmdMsg* msg);
+
+// True for commands that read or clear what the capture worker writes: the
+// network and client tables, the PMKID and handshake lists, a rogue
+// baseline built from the networks, and a table resync. The dispatcher hands these to the worker
+// so they run between frames instead of racing it.
+bool cmdOnWorker(const CmdMsg* msg);
+
+#endif
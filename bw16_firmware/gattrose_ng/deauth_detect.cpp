@@ -0,0 +1,232 @@
+#include "deauth_detect.h"
+#include "net_tables.h"
+#include <string.h>
+
+static const char* const alertNames[DA_TYPES] = {
+    "DEAUTH_FLOOD",
+    "DEAUTH_SRC_FLOOD",
+    "DEAUTH_FLOOD_END",
+    "DEAUTH_SPOOFED",
+};
+
+const char* deauthAlertName(int type) {
+    if (type < 0 || type >= DA_TYPES) return "?";
+    return alertNames[type];
+}
+
+// ============== Sliding Windows ==============
+
+// Zeroes buckets that have slid out since the last update
+static void windowAdvance(DeauthWindow* w, unsigned long now) {
+    uint32_t epoch = now / DD_BUCKET_MS;
+    if (epoch == w->epoch) return;
+    uint32_t gap = epoch - w->epoch;
+    if (gap >= DD_BUCKETS) {
+        memset(w->buckets, 0, sizeof(w->buckets));
+    } else {
+        for (uint32_t e = w->epoch + 1; e <= epoch; e++) w->buckets[e % DD_BUCKETS] = 0;
+    }
+    w->epoch = epoch;
+}
+
+static void windowAdd(DeauthWindow* w, unsigned long now) {
+    windowAdvance(w, now);
+    uint16_t& b = w->buckets[w->epoch % DD_BUCKETS];
+    if (b < 0xFFFF) b++;
+}
+
+static int windowSum(DeauthWindow* w, unsigned long now) {
+    windowAdvance(w, now);
+    int sum = 0;
+    for (int i = 0; i < DD_BUCKETS; i++) sum += w->buckets[i];
+    return sum;
+}
+
+// Read-only, so safe to call from a task that doesn't own the detector
+int deauthWindowCount(const DeauthTrack* t, unsigned long now) {
+    uint32_t epoch = now / DD_BUCKET_MS;
+    int sum = 0;
+    for (uint32_t i = 0; i < DD_BUCKETS && i <= t->frames.epoch; i++) {
+        uint32_t e = t->frames.epoch - i;
+        if (epoch - e < DD_BUCKETS) sum += t->frames.buckets[e % DD_BUCKETS];
+    }
+    return sum;
+}
+
+// ============== Tables ==============
+
+void deauthInit(DeauthDetector* dd) {
+    macIndexInit(&dd->bssid_index, dd->bssid_slots, DD_INDEX_SLOTS);
+    macIndexInit(&dd->source_index, dd->source_slots, DD_INDEX_SLOTS);
+    dd->active = false;
+    dd->flood_threshold = DD_FLOOD_DEFAULT;
+    deauthClear(dd);
+}
+
+void deauthClear(DeauthDetector* dd) {
+    dd->bssids.clear();
+    dd->sources.clear();
+    macIndexClear(&dd->bssid_index);
+    macIndexClear(&dd->source_index);
+    dd->frames = 0;
+    dd->deauth = 0;
+    dd->disassoc = 0;
+    dd->broadcast = 0;
+    dd->spoof_indicators = 0;
+    dd->evicted = 0;
+    memset(dd->alerts, 0, sizeof(dd->alerts));
+}
+
+// Finds or creates the entry for key. When the table is full the entry idle
+// longest is replaced; ongoing floods are kept while anything else can go.
+static DeauthTrack* trackFor(DeauthDetector* dd, DeauthTable& table, MacIndex* index,
+                             MacKey key, unsigned long now) {
+    int idx = macIndexFind(index, key);
+    if (idx >= 0) return &table[idx];
+
+    if (!table.full()) {
+        DeauthTrack t = {};
+        table.push_back(t);
+        idx = table.size() - 1;
+    } else {
+        int victim = -1;
+        for (size_t i = 0; i < table.size(); i++) {
+            if (victim < 0 || (table[victim].flooding && !table[i].flooding) ||
+                (table[victim].flooding == table[i].flooding &&
+                 now - table[i].last_at > now - table[victim].last_at)) {
+                victim = i;
+            }
+        }
+        macIndexErase(index, table[victim].key);
+        memset(&table[victim], 0, sizeof(DeauthTrack));
+        dd->evicted++;
+        idx = victim;
+    }
+
+    DeauthTrack* t = &table[idx];
+    t->key = key;
+    t->last_at = now;
+    t->frames.epoch = now / DD_BUCKET_MS;
+    t->spoof.epoch = t->frames.epoch;
+    macIndexInsert(index, key, idx);
+    return t;
+}
+
+// ============== Alerts ==============
+
+static void raiseAlert(DeauthDetector* dd, uint8_t type, bool source, const DeauthTrack* t, int count) {
+    dd->alerts[type]++;
+
+    DeauthAlert a;
+    a.type = type;
+    a.source = source;
+    keyToMac(t->key, a.mac);
+    memcpy(a.target, t->last_target, 6);
+    a.channel = t->channel;
+    a.count = count > 0xFFFF ? 0xFFFF : count;
+    a.reason = t->last_reason;
+    onDeauthAlert(&a);
+}
+
+// Flood state with hysteresis: on at the threshold, off below half of it
+static void updateFlood(DeauthDetector* dd, DeauthTrack* t, bool source, unsigned long now) {
+    int count = windowSum(&t->frames, now);
+    if (!t->flooding && count >= dd->flood_threshold) {
+        t->flooding = true;
+        raiseAlert(dd, source ? DA_SRC_FLOOD : DA_FLOOD, source, t, count);
+    } else if (t->flooding && count < dd->flood_threshold / 2) {
+        t->flooding = false;
+        raiseAlert(dd, DA_FLOOD_END, source, t, count);
+    }
+}
+
+static void recordFrame(DeauthTrack* t, const uint8_t* frame, bool deauth, bool broadcast,
+                        uint16_t reason, int channel, unsigned long now) {
+    windowAdd(&t->frames, now);
+    if (deauth) t->deauth++;
+    else t->disassoc++;
+    if (broadcast) t->broadcast++;
+    t->last_reason = reason;
+    memcpy(t->last_target, frame + 4, 6);
+    t->channel = channel;
+    t->last_at = now;
+}
+
+// Counts the reasons to doubt that the claimed source sent this frame
+static int spoofIndicators(DeauthTrack* src, const uint8_t* frame, int rssi, unsigned long now) {
+    int score = 0;
+
+    // A different transmitter at a different distance
+    if (src->rssi_frames >= DD_RSSI_MIN_FRAMES) {
+        int mean = src->rssi_q4 / 16;
+        if (rssi - mean > DD_RSSI_SPREAD || mean - rssi > DD_RSSI_SPREAD) score++;
+    }
+    if (src->rssi_frames == 0) src->rssi_q4 = rssi * 16;
+    else src->rssi_q4 += (rssi * 16 - src->rssi_q4) / 8;
+    if (src->rssi_frames < 0xFFFF) src->rssi_frames++;
+
+    // One radio's sequence counter only moves forward; retries may repeat it
+    uint16_t seq = (frame[22] | (frame[23] << 8)) >> 4;
+    bool retry = (frame[1] & 0x08) != 0;
+    if (!retry && src->deauth + src->disassoc > 0 && now - src->last_at < DD_SEQ_GAP_MS) {
+        uint16_t delta = (seq - src->last_seq) & 0x0FFF;
+        if (delta == 0 || delta > 2048) score++;
+    }
+    src->last_seq = seq;
+
+    if (frame[1] & 0x40) return score;
+
+    // An AP that negotiated PMF protects its own deauths
+    int net = findNetwork(macToKey(frame + 16));
+    if (net >= 0 && networks[net].has_pmf) score++;
+
+    // Reserved reason codes come from tools, not stacks
+    uint16_t reason = frame[24] | (frame[25] << 8);
+    if (reason == 0 || reason > 66) score++;
+    return score;
+}
+
+void deauthCheckFrame(DeauthDetector* dd, const uint8_t* frame, int len, int rssi, int channel,
+                      unsigned long now) {
+    if (!dd->active || len < 26) return;
+    uint8_t subtype = (frame[0] >> 4) & 0x0F;
+    if ((frame[0] & 0x0C) != 0x00 || (subtype != 0x0A && subtype != 0x0C)) return;
+
+    bool deauth = (subtype == 0x0C);
+    bool broadcast = memcmp(frame + 4, "\xFF\xFF\xFF\xFF\xFF\xFF", 6) == 0;
+    // Encrypted under PMF; 0 (reserved) stands in for unknown
+    uint16_t reason = (frame[1] & 0x40) ? 0 : (frame[24] | (frame[25] << 8));
+
+    dd->frames++;
+    if (deauth) dd->deauth++;
+    else dd->disassoc++;
+    if (broadcast) dd->broadcast++;
+
+    DeauthTrack* src = trackFor(dd, dd->sources, &dd->source_index, macToKey(frame + 10), now);
+    int score = spoofIndicators(src, frame, rssi, now);
+    recordFrame(src, frame, deauth, broadcast, reason, channel, now);
+    if (score > 0) {
+        dd->spoof_indicators += score;
+        for (int i = 0; i < score; i++) windowAdd(&src->spoof, now);
+        int spoof = windowSum(&src->spoof, now);
+        if (spoof >= DD_SPOOF_SCORE &&
+            (!src->spoof_alert_at || now - src->spoof_alert_at >= DD_SPOOF_HOLDOFF_MS)) {
+            src->spoof_alert_at = now ? now : 1;
+            raiseAlert(dd, DA_SPOOFED, true, src, spoof);
+        }
+    }
+    updateFlood(dd, src, true, now);
+
+    DeauthTrack* bss = trackFor(dd, dd->bssids, &dd->bssid_index, macToKey(frame + 16), now);
+    recordFrame(bss, frame, deauth, broadcast, reason, channel, now);
+    updateFlood(dd, bss, false, now);
+}
+
+void deauthTick(DeauthDetector* dd, unsigned long now) {
+    for (size_t i = 0; i < dd->bssids.size(); i++) {
+        if (dd->bssids[i].flooding) updateFlood(dd, &dd->bssids[i], false, now);
+    }
+    for (size_t i = 0; i < dd->sources.size(); i++) {
+        if (dd->sources[i].flooding) updateFlood(dd, &dd->sources[i], true, now);
+    }
+}
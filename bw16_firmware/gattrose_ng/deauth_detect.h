@@ -0,0 +1,126 @@
+#ifndef GATTROSE_DEAUTH_DETECT_H
+#define GATTROSE_DEAUTH_DETECT_H
+
+#include <stdint.h>
+#include "mac_util.h"
+#include "mac_index.h"
+#include "fixed_table.h"
+
+/*
+ * Deauthentication / disassociation flood detection. Portable.
+ *
+ * Every deauth and disassoc frame is counted twice: against the BSSID it
+ * names (addr3) and against the transmitter address it claims (addr2).
+ * Counts are kept in sliding windows of DD_BUCKETS one-second buckets.
+ *
+ *   - BSSID window reaches the threshold  -> FLOOD      (someone is being kicked)
+ *   - source window reaches the threshold -> SRC_FLOOD  (who is doing the kicking)
+ *   - either drops below half of it       -> FLOOD_END  (from deauthTick())
+ *   - a source's spoofing indicators reach DD_SPOOF_SCORE within the
+ *     window -> SPOOFED
+ *
+ * The addresses in these frames are trivially forged, so each frame is
+ * also scored for signs that the claimed source did not send it: signal
+ * strength far from the source's running mean, sequence numbers that
+ * repeat or run backwards, a cleartext frame for a BSSID known to use PMF,
+ * or a reserved reason code.
+ *
+ * Tables hold the DD_MAX_TRACKED most recent BSSIDs and sources; when full,
+ * the entry idle longest (and not flooding) is replaced. Alerts go out
+ * through onDeauthAlert(). Not thread-safe: feed it from one task only.
+ */
+
+#define DD_MAX_TRACKED      64      // Per table (BSSIDs, sources)
+#define DD_INDEX_SLOTS      128     // Power of two, >= 2 * DD_MAX_TRACKED
+#define DD_BUCKETS          10
+#define DD_BUCKET_MS        1000    // Window = DD_BUCKETS * DD_BUCKET_MS
+#define DD_FLOOD_DEFAULT    30      // Frames per window
+#define DD_RSSI_SPREAD      20      // dB from a source's mean that suggests another transmitter
+#define DD_RSSI_MIN_FRAMES  4       // Frames needed before the mean is trusted
+#define DD_SEQ_GAP_MS       1000    // Only compare sequence numbers this close together
+#define DD_SPOOF_SCORE      5       // Indicators per window before alerting
+#define DD_SPOOF_HOLDOFF_MS 60000
+
+enum {
+    DA_FLOOD = 0,
+    DA_SRC_FLOOD,
+    DA_FLOOD_END,
+    DA_SPOOFED,
+    DA_TYPES
+};
+
+typedef struct {
+    uint16_t buckets[DD_BUCKETS];
+    uint32_t epoch;             // Bucket number (ms / DD_BUCKET_MS) of the newest bucket
+} DeauthWindow;
+
+typedef struct {
+    MacKey key;
+    DeauthWindow frames;
+    DeauthWindow spoof;         // Spoofing indicators
+    uint32_t deauth;            // Totals since the entry was created
+    uint32_t disassoc;
+    uint32_t broadcast;         // Sent to ff:ff:ff:ff:ff:ff
+    uint16_t last_reason;       // 0 if the frame was protected
+    uint8_t last_target[6];     // addr1 of the latest frame
+    uint8_t channel;
+    bool flooding;
+    uint16_t last_seq;
+    int16_t rssi_q4;            // Running mean, dBm * 16
+    uint16_t rssi_frames;
+    unsigned long last_at;
+    unsigned long spoof_alert_at;
+} DeauthTrack;
+
+typedef FixedTable<DeauthTrack, DD_MAX_TRACKED> DeauthTable;
+
+typedef struct {
+    uint8_t type;
+    bool source;                // mac is a transmitter rather than a BSSID
+    uint8_t mac[6];
+    uint8_t target[6];
+    uint8_t channel;
+    uint16_t count;             // Frames (or indicators, for SPOOFED) in the window
+    uint16_t reason;            // Latest reason code, 0 if the frame was protected
+} DeauthAlert;
+
+typedef struct {
+    DeauthTable bssids;
+    DeauthTable sources;
+    MacIndexSlot bssid_slots[DD_INDEX_SLOTS];
+    MacIndexSlot source_slots[DD_INDEX_SLOTS];
+    MacIndex bssid_index;
+    MacIndex source_index;
+
+    bool active;
+    uint16_t flood_threshold;   // Frames per window, DD_FLOOD_DEFAULT unless set
+
+    uint32_t frames;            // Deauth + disassoc checked
+    uint32_t deauth;
+    uint32_t disassoc;
+    uint32_t broadcast;
+    uint32_t spoof_indicators;
+    uint32_t evicted;
+    uint32_t alerts[DA_TYPES];
+} DeauthDetector;
+
+void deauthInit(DeauthDetector* dd);
+void deauthClear(DeauthDetector* dd);
+
+// Counts a deauth or disassoc frame; other frames are ignored. channel is
+// the radio's at reception.
+void deauthCheckFrame(DeauthDetector* dd, const uint8_t* frame, int len, int rssi, int channel,
+                      unsigned long now);
+
+// Ends floods that have died down. Call about once per DD_BUCKET_MS.
+void deauthTick(DeauthDetector* dd, unsigned long now);
+
+// Frames in the entry's window as of now. Doesn't modify the entry.
+int deauthWindowCount(const DeauthTrack* t, unsigned long now);
+
+const char* deauthAlertName(int type);
+
+// Platform hook: a flood started or ended, or a source looks spoofed
+void onDeauthAlert(const DeauthAlert* alert);
+
+#endif
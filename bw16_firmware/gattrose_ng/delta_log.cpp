@@ -0,0 +1,107 @@
+#include "delta_log.h"
+#include <string.h>
+#include <atomic>
+
+#define DELTA_LOG_MASK (DELTA_LOG_SLOTS - 1)
+
+DeltaLog deltaLog;
+
+void deltaInit(DeltaLog* dl) {
+    memset(dl->log, 0, sizeof(dl->log));
+    dl->version.store(0, std::memory_order_relaxed);
+    dl->base = 0;
+    dl->rssi_threshold = DELTA_RSSI_DEFAULT;
+    memset(dl->net_rssi, 0, sizeof(dl->net_rssi));
+    memset(dl->client_rssi, 0, sizeof(dl->client_rssi));
+    dl->changes = 0;
+    dl->suppressed = 0;
+    dl->resets = 0;
+}
+
+// The slot's version is cleared while it is rewritten, so a reader that
+// copied it meanwhile sees the mismatch (deltaAt)
+static void logChange(DeltaLog* dl, char table, char op, int index, MacKey key) {
+    uint32_t version = dl->version.load(std::memory_order_relaxed) + 1;
+    DeltaChange& c = dl->log[version & DELTA_LOG_MASK];
+    c.version = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+    c.op = op;
+    c.table = table;
+    c.index = index;
+    c.key = key;
+    std::atomic_thread_fence(std::memory_order_release);
+    c.version = version;
+    dl->version.store(version, std::memory_order_release);
+    dl->changes++;
+    onTableChange(&c);
+}
+
+static int8_t* reportedRssi(DeltaLog* dl, char table, int index) {
+    if (table == DELTA_NETWORK) return index < MAX_NETWORKS ? &dl->net_rssi[index] : NULL;
+    return index < MAX_CLIENTS ? &dl->client_rssi[index] : NULL;
+}
+
+// ============== Recording ==============
+
+void deltaRecord(DeltaLog* dl, char table, char op, int index, MacKey key) {
+    if (op == DELTA_INSERT) {
+        int8_t* last = reportedRssi(dl, table, index);
+        if (last) {
+            *last = table == DELTA_NETWORK ? networks[index].rssi : clients[index].rssi;
+        }
+    }
+    logChange(dl, table, op, index, key);
+}
+
+bool deltaRssi(DeltaLog* dl, char table, int index, MacKey key, int rssi) {
+    int8_t* last = reportedRssi(dl, table, index);
+    if (!last) return false;
+    int moved = rssi > *last ? rssi - *last : *last - rssi;
+    if (moved < dl->rssi_threshold) {
+        dl->suppressed++;
+        return false;
+    }
+    *last = rssi;
+    logChange(dl, table, DELTA_UPDATE, index, key);
+    return true;
+}
+
+void deltaReset(DeltaLog* dl, char table) {
+    dl->resets++;
+    logChange(dl, table, DELTA_RESET, -1, 0);
+    dl->base = dl->version.load(std::memory_order_relaxed);
+}
+
+// ============== Replay ==============
+
+bool deltaCanReplay(const DeltaLog* dl, uint32_t since) {
+    uint32_t latest = dl->version.load(std::memory_order_acquire);
+    return since >= dl->base && since <= latest && latest - since <= DELTA_LOG_SLOTS;
+}
+
+bool deltaAt(const DeltaLog* dl, uint32_t version, DeltaChange* out) {
+    uint32_t latest = dl->version.load(std::memory_order_acquire);
+    if (version == 0 || version > latest || latest - version >= DELTA_LOG_SLOTS) return false;
+    const volatile DeltaChange* c = &dl->log[version & DELTA_LOG_MASK];
+    out->version = c->version;
+    out->op = c->op;
+    out->table = c->table;
+    out->index = c->index;
+    out->key = c->key;
+    // Still the same change once copied: the writer hadn't started on the slot
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return out->version == version && c->version == version;
+}
+
+bool deltaSuperseded(const DeltaLog* dl, const DeltaChange* c, uint32_t until) {
+    if (c->op == DELTA_RESET) return false;
+    DeltaChange later;
+    for (uint32_t v = c->version + 1; v <= until; v++) {
+        if (!deltaAt(dl, v, &later)) continue;
+        if (later.table != c->table || later.index != c->index || later.key != c->key) continue;
+        // The record may come back at this index; the host still needs the eviction
+        if (c->op == DELTA_EVICT && later.op == DELTA_INSERT) continue;
+        return true;
+    }
+    return false;
+}
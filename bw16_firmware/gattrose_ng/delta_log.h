@@ -0,0 +1,91 @@
+#ifndef GATTROSE_DELTA_LOG_H
+#define GATTROSE_DELTA_LOG_H
+
+#include <stdint.h>
+#include <atomic>
+#include "mac_util.h"
+#include "net_tables.h"
+
+/*
+ * Change log over the network and client tables. Portable.
+ *
+ * net_tables reports every insert and eviction, and every RSSI move of at
+ * least rssi_threshold dB from the value last reported for that record.
+ * Each change takes the next table version and is passed to onTableChange()
+ * for subscribers. The last DELTA_LOG_SLOTS changes are kept, so a host that
+ * missed some can replay from the last version it applied. Going back
+ * further, or across a rebuild that renumbers records (clear, sort), needs a
+ * full snapshot instead. Versions start from 0 at boot.
+ *
+ * Not thread-safe for writers: it is only written through net_tables, so
+ * from the one task that changes the tables (the capture worker on the
+ * BW16). That keeps versions gap-free and in order. A change's slot is
+ * filled before version moves on to it, and readers copy a change and then
+ * check its slot wasn't reused meanwhile, so a reader on another task gets
+ * either the whole change or a miss.
+ */
+
+#define DELTA_LOG_SLOTS         256     // Must be a power of two
+#define DELTA_RSSI_DEFAULT      6       // dB an RSSI has to move to be reported
+
+// Change kinds and tables, as sent on the wire
+#define DELTA_INSERT            '+'
+#define DELTA_UPDATE            '~'
+#define DELTA_EVICT             '-'
+#define DELTA_RESET             '!'     // Table rebuilt; index -1, key 0
+#define DELTA_NETWORK           'n'
+#define DELTA_CLIENT            'c'
+
+typedef struct {
+    uint32_t version;
+    char op;                    // DELTA_INSERT / UPDATE / EVICT / RESET
+    char table;                 // DELTA_NETWORK / CLIENT
+    int16_t index;              // Table position
+    MacKey key;                 // BSSID or client MAC, still valid after eviction
+} DeltaChange;
+
+typedef struct {
+    DeltaChange log[DELTA_LOG_SLOTS];
+    std::atomic<uint32_t> version;      // Latest change, 0 before the first
+    uint32_t base;              // Version of the last reset; replays can't start before it
+    uint8_t rssi_threshold;
+    int8_t net_rssi[MAX_NETWORKS];      // RSSI as last reported, per record
+    int8_t client_rssi[MAX_CLIENTS];
+
+    uint32_t changes;           // Logged changes (inserts, updates, evictions)
+    uint32_t suppressed;        // RSSI moves under the threshold
+    uint32_t resets;            // Rebuilds
+} DeltaLog;
+
+extern DeltaLog deltaLog;
+
+void deltaInit(DeltaLog* dl);
+
+// Logs an insert or eviction of the record at index
+void deltaRecord(DeltaLog* dl, char table, char op, int index, MacKey key);
+
+// Logs an update if rssi moved at least rssi_threshold from the last
+// reported value. Returns true if it did.
+bool deltaRssi(DeltaLog* dl, char table, int index, MacKey key, int rssi);
+
+// The table was cleared or renumbered. Logs a DELTA_RESET; nothing before
+// it can be replayed.
+void deltaReset(DeltaLog* dl, char table);
+
+// True if every change after version since is still in the log
+bool deltaCanReplay(const DeltaLog* dl, uint32_t since);
+
+// Copies the change with this version into out. False if it has left the
+// log, including while it was being copied.
+bool deltaAt(const DeltaLog* dl, uint32_t version, DeltaChange* out);
+
+// True if a change after c, up to version until, is about the same record
+// at the same index, so a replay can skip c: insert and update records carry
+// the current state. An eviction is never skipped in favour of an insert.
+// A later change that has left the log counts as not covering c.
+bool deltaSuperseded(const DeltaLog* dl, const DeltaChange* c, uint32_t until);
+
+// Platform hook: a change was logged
+void onTableChange(const DeltaChange* change);
+
+#endif
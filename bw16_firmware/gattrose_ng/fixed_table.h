@@ -0,0 +1,37 @@
+#ifndef GATTROSE_FIXED_TABLE_H
+#define GATTROSE_FIXED_TABLE_H
+
+#include <stddef.h>
+#include <type_traits>
+
+/*
+ * Fixed-capacity array with the subset of the std::vector interface the
+ * sketch uses. Storage is inline, so a global FixedTable never touches the
+ * heap; element types must be POD so copies and swaps are plain memcpy.
+ */
+template <typename T, size_t N>
+class FixedTable {
+    static_assert(std::is_trivially_copyable<T>::value, "FixedTable holds POD records only");
+
+public:
+    size_t size() const { return count; }
+    size_t capacity() const { return N; }
+    bool full() const { return count >= N; }
+
+    T& operator[](size_t i) { return items[i]; }
+    const T& operator[](size_t i) const { return items[i]; }
+
+    bool push_back(const T& item) {
+        if (count >= N) return false;
+        items[count++] = item;
+        return true;
+    }
+
+    void clear() { count = 0; }
+
+private:
+    T items[N];
+    size_t count = 0;
+};
+
+#endif
@@ -0,0 +1,351 @@
+#include "frame_parser.h"
+#include "net_tables.h"
+#include "platform.h"
+#include "log.h"
+#include "ie_parser.h"
+#include <string.h>
+
+std::vector<PMKIDEntry> pmkidList;
+std::vector<HandshakeEntry> handshakeList;
+bool pmkidCaptureActive = false;
+bool handshakeCaptureActive = false;
+
+unsigned long dataFrameCount = 0;
+unsigned long unmatchedBssidCount = 0;
+unsigned long probeCount = 0;
+unsigned long assocCount = 0;
+unsigned long authCount = 0;
+
+void processFrame(uint8_t* frame, int len, int rssi, uint8_t* bssid) {
+    if (len < 24) return;
+
+    uint8_t frameType = frame[0] & 0x0C;  // Bits 2-3 = type
+    uint8_t frameSubtype = (frame[0] >> 4) & 0x0F;  // Bits 4-7 = subtype
+
+    // Data frames (type=2, so frameType & 0x0C == 0x08)
+    if (frameType == 0x08) {
+        processDataFrame(frame, len, rssi, bssid);
+
+        // Process EAPOL frames for PMKID and handshake capture
+        if (pmkidCaptureActive || handshakeCaptureActive) {
+            processEAPOL(frame, len, rssi);
+        }
+    }
+    // Management frames (type=0, so frameType & 0x0C == 0x00)
+    else if (frameType == 0x00) {
+        switch (frameSubtype) {
+            case 0x00:  // Association Request - client joining AP
+            case 0x02:  // Reassociation Request - client roaming
+            case 0x04:  // Probe Request - client scanning
+            case 0x0B:  // Authentication - client authenticating
+                processManagementFrame(frame, len, rssi, frameSubtype);
+                break;
+        }
+    }
+}
+
+// Process management frames (probe req, assoc req, reassoc req, auth)
+void processManagementFrame(uint8_t* frame, int len, int rssi, uint8_t subtype) {
+    if (len < 24) return;
+
+    // For management frames: addr1=DA, addr2=SA(client), addr3=BSSID
+    uint8_t* clientMac = frame + 10;  // Source address (client)
+    uint8_t* bssid = frame + 16;      // BSSID (AP)
+
+    // Skip broadcast/multicast source
+    if (clientMac[0] & 0x01) return;
+
+    // Track frame types
+    if (subtype == 0x04) probeCount++;
+    else if (subtype == 0x00 || subtype == 0x02) assocCount++;
+    else if (subtype == 0x0B) authCount++;
+
+    // Every probe with an SSID element is reported, known client or not;
+    // the SSID is "" for a wildcard probe
+    char probedSSID[33] = {0};
+    IeElement ie;
+    if (subtype == 0x04 && ieFind(frame + 24, len - 24, IE_SSID, &ie) && ie.len <= 32) {
+        memcpy(probedSSID, ie.data, ie.len);
+        onProbeSsid(clientMac, probedSSID, rssi);
+    }
+
+    // Check if we already know this client
+    MacKey clientKey = macToKey(clientMac);
+    int known = findClient(clientKey);
+    if (known >= 0) {
+        setClientRssi(known, rssi);
+        touchClient(known, platformMillis());
+        return;
+    }
+
+    // Find AP by BSSID (for assoc/reassoc/auth frames)
+    int apIndex = -1;
+    if (subtype != 0x04) {  // Not a probe request (probes go to broadcast BSSID)
+        apIndex = findNetwork(macToKey(bssid));
+    } else if (probedSSID[0]) {
+        // For directed probes, match the SSID against known networks
+        for (size_t i = 0; i < networks.size(); i++) {
+            if (!networks[i].vacant && strcmp(networks[i].ssid, probedSSID) == 0) {
+                apIndex = i;
+                break;
+            }
+        }
+    }
+
+    // Add new client, evicting the least recently seen one if full
+    WiFiClient_t cli;
+    memcpy(cli.mac, clientMac, 6);
+    cli.key = clientKey;
+    cli.rssi = rssi;
+    cli.ap_index = apIndex;
+    cli.last_seen = platformMillis();
+
+    int idx = addClient(cli);
+    if (idx >= 0) onClientAdded(idx);
+}
+
+void processDataFrame(uint8_t* frame, int len, int rssi, uint8_t* bssidFromInfo) {
+    if (len < 24) return;
+
+    dataFrameCount++;
+
+    uint8_t* addr1 = frame + 4;
+    uint8_t* addr2 = frame + 10;
+
+    uint8_t toDS = (frame[1] & 0x01);
+    uint8_t fromDS = (frame[1] & 0x02) >> 1;
+
+    uint8_t* clientMac;
+    uint8_t* bssid;
+
+    if (toDS && !fromDS) {
+        // Client -> AP: addr1=BSSID, addr2=client, addr3=DA
+        clientMac = addr2;
+        bssid = addr1;
+    } else if (!toDS && fromDS) {
+        // AP -> Client: addr1=client, addr2=BSSID, addr3=SA
+        clientMac = addr1;
+        bssid = addr2;
+    } else {
+        return;
+    }
+
+    // Use BSSID from frame if not provided via userdata
+    if (!bssidFromInfo) {
+        bssidFromInfo = bssid;
+    }
+
+    // Skip broadcast/multicast
+    if (clientMac[0] & 0x01) return;
+
+    // Find AP by BSSID
+    int apIndex = findNetwork(macToKey(bssidFromInfo));
+    if (apIndex < 0) {
+        unmatchedBssidCount++;
+        return;
+    }
+    networks[apIndex].last_seen = platformMillis();
+
+    // Check if client already known
+    MacKey clientKey = macToKey(clientMac);
+    int known = findClient(clientKey);
+    if (known >= 0) {
+        setClientRssi(known, rssi);
+        touchClient(known, platformMillis());
+        return;
+    }
+
+    // Add new client, evicting the least recently seen one if full
+    WiFiClient_t cli;
+    memcpy(cli.mac, clientMac, 6);
+    cli.key = clientKey;
+    cli.rssi = rssi;
+    cli.ap_index = apIndex;
+    cli.last_seen = platformMillis();
+
+    int idx = addClient(cli);
+    if (idx >= 0) onClientAdded(idx);
+}
+
+// --- EAPOL Processing for PMKID/Handshake ---
+
+// EAPOL-Key body: version(1) type(1) length(2) descriptor(1) key_info(2)
+// key_len(2) replay(8) nonce(32) iv(16) rsc(8) id(8) mic(16) data_len(2)
+#define EAPOL_KEY_HDR_LEN 99
+
+void processEAPOL(uint8_t* frame, int len, int rssi) {
+    (void)rssi;
+
+    // EAPOL frames have ethertype 0x888e
+    // In 802.11 data frames, check for LLC/SNAP header followed by 0x888e
+
+    if (len < 34) return;  // Too short
+
+    // Find EAPOL in frame (after 802.11 header + LLC/SNAP)
+    // LLC/SNAP: AA AA 03 00 00 00 88 8E
+    uint8_t* eapol_start = NULL;
+    for (int i = 24; i < len - 8; i++) {
+        if (frame[i] == 0xAA && frame[i+1] == 0xAA &&
+            frame[i+2] == 0x03 && frame[i+5] == 0x00 &&
+            frame[i+6] == 0x88 && frame[i+7] == 0x8E) {
+            eapol_start = frame + i + 8;
+            break;
+        }
+    }
+
+    if (!eapol_start) return;
+
+    // Everything below reads fixed EAPOL-Key offsets, so the whole key
+    // header has to be present
+    int eapol_avail = len - (int)(eapol_start - frame);
+    if (eapol_avail < EAPOL_KEY_HDR_LEN) return;
+
+    // EAPOL-Key frame structure
+    // Byte 0: version
+    // Byte 1: type (3 = key)
+    // Bytes 2-3: length
+    // Byte 4: descriptor type (2 = RSN)
+    // Bytes 5-6: key info
+
+    if (eapol_start[1] != 0x03) return;  // Not EAPOL-Key
+
+    uint16_t key_info = (eapol_start[5] << 8) | eapol_start[6];
+    bool is_mic_set = (key_info & 0x0100) != 0;
+    bool is_ack_set = (key_info & 0x0080) != 0;
+    bool is_install = (key_info & 0x0040) != 0;
+
+    // Get addresses
+    uint8_t* addr1 = frame + 4;
+    uint8_t* addr2 = frame + 10;
+    uint8_t toDS = (frame[1] & 0x01);
+    uint8_t fromDS = (frame[1] & 0x02) >> 1;
+
+    uint8_t* ap_mac;
+    uint8_t* client_mac;
+    if (toDS && !fromDS) {
+        client_mac = addr2;
+        ap_mac = addr1;
+    } else if (!toDS && fromDS) {
+        client_mac = addr1;
+        ap_mac = addr2;
+    } else {
+        return;
+    }
+
+    // Determine message number
+    int msg_num = 0;
+    if (is_ack_set && !is_mic_set) msg_num = 1;
+    else if (!is_ack_set && is_mic_set && !is_install) msg_num = 2;
+    else if (is_ack_set && is_mic_set && is_install) msg_num = 3;
+    else if (!is_ack_set && is_mic_set && !is_install) msg_num = 4;
+
+    if (msg_num == 0) return;
+
+    // Find network SSID
+    const char* ssid = "";
+    int apIndex = findNetwork(macToKey(ap_mac));
+    if (apIndex >= 0) {
+        ssid = networks[apIndex].ssid;
+    }
+
+    LOG_DEBUG("EAPOL M%d from %s", msg_num, ssid);
+
+    int key_data_len = (eapol_start[97] << 8) | eapol_start[98];
+    bool key_data_cut = false;
+    if (key_data_len > eapol_avail - EAPOL_KEY_HDR_LEN) {
+        key_data_len = eapol_avail - EAPOL_KEY_HDR_LEN;  // Snapshot cut it short
+        key_data_cut = true;
+    }
+
+    // PMKID extraction from Message 1
+    if (pmkidCaptureActive && msg_num == 1) {
+        // PMKID is in RSN IE at end of EAPOL-Key frame
+        // Look for RSN IE (tag 0x30) with PMKID
+        uint8_t* key_data = eapol_start + EAPOL_KEY_HDR_LEN;
+
+        for (int i = 0; i + 22 <= key_data_len; i++) {
+            // Look for PMKID KDE: 0xDD 0x14 0x00 0x0F 0xAC 0x04 + 16 bytes PMKID
+            if (key_data[i] == 0xDD && key_data[i+1] == 0x14 &&
+                key_data[i+2] == 0x00 && key_data[i+3] == 0x0F &&
+                key_data[i+4] == 0xAC && key_data[i+5] == 0x04) {
+
+                // Found PMKID!
+                PMKIDEntry entry;
+                memcpy(entry.pmkid, key_data + i + 6, 16);
+                memcpy(entry.ap_mac, ap_mac, 6);
+                memcpy(entry.client_mac, client_mac, 6);
+                strncpy(entry.ssid, ssid, 32);
+                entry.ssid[32] = '\0';
+                entry.valid = true;
+
+                // Check for duplicate
+                bool exists = false;
+                for (size_t j = 0; j < pmkidList.size(); j++) {
+                    if (memcmp(pmkidList[j].pmkid, entry.pmkid, 16) == 0) {
+                        exists = true;
+                        break;
+                    }
+                }
+
+                if (!exists && pmkidList.size() < 20) {
+                    pmkidList.push_back(entry);
+                    onEapolCaptured('h', ssid);
+                    LOG_INFO("PMKID captured for %s", ssid);
+                }
+                break;
+            }
+        }
+    }
+
+    // Handshake capture
+    if (handshakeCaptureActive && msg_num >= 1 && msg_num <= 4) {
+        // Find or create handshake entry
+        HandshakeEntry* hs = NULL;
+        for (size_t i = 0; i < handshakeList.size(); i++) {
+            if (memcmp(handshakeList[i].ap_mac, ap_mac, 6) == 0 &&
+                memcmp(handshakeList[i].client_mac, client_mac, 6) == 0) {
+                hs = &handshakeList[i];
+                break;
+            }
+        }
+
+        if (!hs && handshakeList.size() < 10) {
+            HandshakeEntry newEntry;
+            memset(&newEntry, 0, sizeof(newEntry));
+            memcpy(newEntry.ap_mac, ap_mac, 6);
+            memcpy(newEntry.client_mac, client_mac, 6);
+            strncpy(newEntry.ssid, ssid, 32);
+            handshakeList.push_back(newEntry);
+            hs = &handshakeList[handshakeList.size() - 1];
+        }
+
+        if (hs && !hs->complete) {
+            hs->msg_mask |= (1 << (msg_num - 1));
+
+            // Extract nonces from messages
+            if (msg_num == 1 || msg_num == 3) {
+                // ANonce at offset 17-48
+                memcpy(hs->anonce, eapol_start + 17, 32);
+            }
+            if (msg_num == 2) {
+                // SNonce at offset 17-48
+                memcpy(hs->snonce, eapol_start + 17, 32);
+                // MIC at offset 81-96
+                memcpy(hs->mic, eapol_start + 81, 16);
+                // Store EAPOL frame for cracking
+                int eapol_len = EAPOL_KEY_HDR_LEN + key_data_len;
+                if (!key_data_cut && eapol_len < 256) {
+                    memcpy(hs->eapol_frame, eapol_start, eapol_len);
+                    hs->eapol_len = eapol_len;
+                }
+            }
+
+            // Check if complete (have M1+M2 or M2+M3)
+            if ((hs->msg_mask & 0x03) == 0x03 || (hs->msg_mask & 0x06) == 0x06) {
+                hs->complete = true;
+                onEapolCaptured('H', ssid);
+                LOG_INFO("Handshake captured for %s", ssid);
+            }
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef GATTROSE_FRAME_PARSER_H
+#define GATTROSE_FRAME_PARSER_H
+
+#include <stdint.h>
+#include <vector>
+
+/*
+ * 802.11 frame parsing for client discovery and EAPOL capture. Portable -
+ * everything platform-specific goes through platform.h, so the same code
+ * runs in the capture worker on the BW16 and in the host replay tools.
+ *
+ * Frames start at the 802.11 header (no radiotap) and len is the number of
+ * bytes actually available. Not thread-safe: call from one task only.
+ */
+
+typedef struct {
+    uint8_t pmkid[16];
+    uint8_t ap_mac[6];
+    uint8_t client_mac[6];
+    char ssid[33];
+    bool valid;
+} PMKIDEntry;
+
+typedef struct {
+    uint8_t ap_mac[6];
+    uint8_t client_mac[6];
+    char ssid[33];
+    uint8_t anonce[32];
+    uint8_t snonce[32];
+    uint8_t mic[16];
+    uint8_t eapol_frame[256];
+    uint16_t eapol_len;
+    uint8_t msg_mask;  // Bits: msg1=0x01, msg2=0x02, msg3=0x04, msg4=0x08
+    bool complete;
+} HandshakeEntry;
+
+extern std::vector<PMKIDEntry> pmkidList;
+extern std::vector<HandshakeEntry> handshakeList;
+extern bool pmkidCaptureActive;
+extern bool handshakeCaptureActive;
+
+// Frame counters (for debug)
+extern unsigned long dataFrameCount;
+extern unsigned long unmatchedBssidCount;
+extern unsigned long probeCount;
+extern unsigned long assocCount;
+extern unsigned long authCount;
+
+// Dispatches on frame type. bssid is the driver-supplied BSSID, or NULL to
+// take it from the header.
+void processFrame(uint8_t* frame, int len, int rssi, uint8_t* bssid);
+
+void processManagementFrame(uint8_t* frame, int len, int rssi, uint8_t subtype);
+void processDataFrame(uint8_t* frame, int len, int rssi, uint8_t* bssidFromInfo);
+void processEAPOL(uint8_t* frame, int len, int rssi);
+
+#endif
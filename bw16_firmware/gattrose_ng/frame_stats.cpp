@@ -0,0 +1,64 @@
+#include "frame_stats.h"
+
+void frameStatsClear(FrameStats* fs) {
+    for (int c = 0; c < CHAN_SLOTS; c++) {
+        FrameStatsChan* ch = &fs->chans[c];
+        for (int i = 0; i < FS_TYPES; i++) ch->frames[i].store(0, std::memory_order_relaxed);
+        for (int i = 0; i < FS_RSSI_BINS; i++) ch->rssi_hist[i].store(0, std::memory_order_relaxed);
+        ch->bytes.store(0, std::memory_order_relaxed);
+    }
+    fs->unknown_channel.store(0, std::memory_order_relaxed);
+}
+
+static inline int frameCategory(uint8_t fc) {
+    uint8_t type = (fc >> 2) & 0x03;
+    uint8_t subtype = (fc >> 4) & 0x0F;
+
+    if (type == 2) return FS_DATA;
+    if (type == 1) return FS_CTRL;
+    if (type != 0) return FS_MGMT_OTHER;   // Reserved / extension
+
+    switch (subtype) {
+        case 0x08: return FS_BEACON;
+        case 0x04: return FS_PROBE_REQ;
+        case 0x05: return FS_PROBE_RESP;
+        case 0x00: case 0x01: case 0x02: case 0x03: case 0x0B:
+            return FS_AUTH_ASSOC;
+        case 0x0A: case 0x0C:
+            return FS_DEAUTH;
+        default:
+            return FS_MGMT_OTHER;
+    }
+}
+
+static inline int rssiBin(int rssi) {
+    int bin = (rssi + 100) / 10;
+    if (rssi < -100) bin = 0;
+    if (bin >= FS_RSSI_BINS) bin = FS_RSSI_BINS - 1;
+    return bin;
+}
+
+void frameStatsRecord(FrameStats* fs, int channel, uint8_t fc, uint32_t len, int rssi) {
+    int slot = chanToSlot(channel);
+    if (slot < 0) {
+        fs->unknown_channel.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    FrameStatsChan* ch = &fs->chans[slot];
+    ch->frames[frameCategory(fc)].fetch_add(1, std::memory_order_relaxed);
+    ch->rssi_hist[rssiBin(rssi)].fetch_add(1, std::memory_order_relaxed);
+    ch->bytes.fetch_add(len, std::memory_order_relaxed);
+}
+
+void frameStatsSnapshot(FrameStats* fs, int slot, FrameStatsSnapshot* out) {
+    FrameStatsChan* ch = &fs->chans[slot];
+    out->total = 0;
+    for (int i = 0; i < FS_TYPES; i++) {
+        out->frames[i] = ch->frames[i].load(std::memory_order_relaxed);
+        out->total += out->frames[i];
+    }
+    for (int i = 0; i < FS_RSSI_BINS; i++) {
+        out->rssi_hist[i] = ch->rssi_hist[i].load(std::memory_order_relaxed);
+    }
+    out->bytes = ch->bytes.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,58 @@
+#ifndef GATTROSE_FRAME_STATS_H
+#define GATTROSE_FRAME_STATS_H
+
+#include <stdint.h>
+#include <atomic>
+#include "channel_sched.h"
+
+/*
+ * Per-channel frame counters for spectrum-occupancy surveys.
+ *
+ * Updated from the promiscuous callback with relaxed atomic increments, so
+ * readers never block the radio path. A snapshot is a plain copy and may be
+ * a few frames out of step between fields, which is fine for telemetry.
+ * Channels are indexed by the channel_sched slot mapping.
+ */
+
+enum {
+    FS_BEACON = 0,
+    FS_PROBE_REQ,
+    FS_PROBE_RESP,
+    FS_AUTH_ASSOC,          // Auth, (re)assoc request/response
+    FS_DEAUTH,              // Deauth and disassoc
+    FS_MGMT_OTHER,
+    FS_CTRL,
+    FS_DATA,
+    FS_TYPES
+};
+
+// RSSI bins 10 dB wide: <-90, -90..-81, ..., -40..-31, >=-30
+#define FS_RSSI_BINS 8
+
+typedef struct {
+    std::atomic<uint32_t> frames[FS_TYPES];
+    std::atomic<uint32_t> rssi_hist[FS_RSSI_BINS];
+    std::atomic<uint32_t> bytes;
+} FrameStatsChan;
+
+typedef struct {
+    FrameStatsChan chans[CHAN_SLOTS];
+    std::atomic<uint32_t> unknown_channel;  // Frames while on an unmapped channel
+} FrameStats;
+
+// Plain copy of one channel for reporting
+typedef struct {
+    uint32_t frames[FS_TYPES];
+    uint32_t rssi_hist[FS_RSSI_BINS];
+    uint32_t bytes;
+    uint32_t total;         // Sum of frames[]
+} FrameStatsSnapshot;
+
+void frameStatsClear(FrameStats* fs);
+
+// Classifies by the 802.11 frame control byte and counts it
+void frameStatsRecord(FrameStats* fs, int channel, uint8_t fc, uint32_t len, int rssi);
+
+void frameStatsSnapshot(FrameStats* fs, int slot, FrameStatsSnapshot* out);
+
+#endif
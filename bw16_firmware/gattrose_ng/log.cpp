@@ -0,0 +1,22 @@
+#include "log.h"
+#include <stdarg.h>
+#include <stdio.h>
+
+static const char levelTags[] = "-EWID";
+
+void logWrite(int level, const char* fmt, ...) {
+    char line[LOG_LINE_MAX];
+    line[0] = levelTags[(level >= 0 && level <= LOG_LEVEL_DEBUG) ? level : 0];
+    line[1] = ' ';
+
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line + 2, sizeof(line) - 4, fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+
+    size_t len = 2 + ((size_t)n < sizeof(line) - 4 ? (size_t)n : sizeof(line) - 5);
+    line[len++] = '\r';
+    line[len++] = '\n';
+    logEmit(level, line, len);
+}
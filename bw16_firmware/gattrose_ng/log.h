@@ -0,0 +1,43 @@
+#ifndef GATTROSE_LOG_H
+#define GATTROSE_LOG_H
+
+#include <stddef.h>
+
+/*
+ * Leveled debug logging, compiled out below LOG_LEVEL.
+ *
+ *   LOG_INFO("Found %d networks", count);
+ *
+ * Formatting is printf-style and deferred to logWrite(), so a call site only
+ * passes its arguments. A disabled level still type-checks its format but
+ * sits in a dead branch: the arguments are never evaluated and no code is
+ * emitted. Lines go to logEmit(), which the platform provides; the sketch
+ * queues them for the USB port without blocking.
+ */
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4       // Per-frame and per-hop chatter
+
+// Change to raise or lower what gets built in
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_LINE_MAX 128        // Longer lines are cut
+
+void logWrite(int level, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+// Platform hook: one formatted line, newline included
+void logEmit(int level, const char* line, size_t len);
+
+#define LOG_AT(level, ...) do { if (LOG_LEVEL >= (level)) logWrite((level), __VA_ARGS__); } while (0)
+
+#define LOG_ERROR(...)  LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(...)   LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(...)   LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...)  LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+#endif
@@ -0,0 +1,94 @@
+#include "mac_index.h"
+
+static inline uint32_t macHash(MacKey key) {
+    // Fibonacci hashing - OUI bytes are highly correlated, so mix before masking
+    return (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+static inline bool slotMatches(const MacIndexSlot* s, MacKey key) {
+    return s->key_lo == (uint32_t)key && s->key_hi == (uint16_t)(key >> 32);
+}
+
+static inline MacKey slotKey(const MacIndexSlot* s) {
+    return ((MacKey)s->key_hi << 32) | s->key_lo;
+}
+
+void macIndexInit(MacIndex* idx, MacIndexSlot* slots, uint16_t capacity) {
+    idx->slots = slots;
+    idx->capacity = capacity;
+    macIndexClear(idx);
+}
+
+void macIndexClear(MacIndex* idx) {
+    for (uint16_t i = 0; i < idx->capacity; i++) {
+        idx->slots[i].value = MAC_INDEX_EMPTY;
+    }
+    idx->count = 0;
+}
+
+int macIndexFind(const MacIndex* idx, MacKey key) {
+    uint16_t mask = idx->capacity - 1;
+    uint16_t i = macHash(key) & mask;
+
+    for (uint16_t probes = 0; probes < idx->capacity; probes++) {
+        const MacIndexSlot* s = &idx->slots[i];
+        if (s->value == MAC_INDEX_EMPTY) return MAC_INDEX_EMPTY;
+        if (slotMatches(s, key)) return s->value;
+        i = (i + 1) & mask;
+    }
+    return MAC_INDEX_EMPTY;
+}
+
+bool macIndexInsert(MacIndex* idx, MacKey key, int16_t value) {
+    uint16_t mask = idx->capacity - 1;
+    uint16_t i = macHash(key) & mask;
+
+    for (uint16_t probes = 0; probes < idx->capacity; probes++) {
+        MacIndexSlot* s = &idx->slots[i];
+        if (s->value == MAC_INDEX_EMPTY) {
+            s->key_lo = (uint32_t)key;
+            s->key_hi = (uint16_t)(key >> 32);
+            s->value = value;
+            idx->count++;
+            return true;
+        }
+        if (slotMatches(s, key)) {
+            s->value = value;
+            return true;
+        }
+        i = (i + 1) & mask;
+    }
+    return false;
+}
+
+bool macIndexErase(MacIndex* idx, MacKey key) {
+    uint16_t mask = idx->capacity - 1;
+    uint16_t i = macHash(key) & mask;
+    uint16_t probes = 0;
+
+    while (true) {
+        if (probes++ >= idx->capacity) return false;
+        MacIndexSlot* s = &idx->slots[i];
+        if (s->value == MAC_INDEX_EMPTY) return false;
+        if (slotMatches(s, key)) break;
+        i = (i + 1) & mask;
+    }
+
+    // Backward-shift: pull later entries of the cluster into the hole if
+    // their home slot isn't between the hole and their current position
+    uint16_t hole = i;
+    uint16_t j = (i + 1) & mask;
+    while (idx->slots[j].value != MAC_INDEX_EMPTY) {
+        uint16_t home = macHash(slotKey(&idx->slots[j])) & mask;
+        bool movable = (hole <= j) ? (home <= hole || home > j)
+                                   : (home <= hole && home > j);
+        if (movable) {
+            idx->slots[hole] = idx->slots[j];
+            hole = j;
+        }
+        j = (j + 1) & mask;
+    }
+    idx->slots[hole].value = MAC_INDEX_EMPTY;
+    idx->count--;
+    return true;
+}
@@ -0,0 +1,41 @@
+#ifndef GATTROSE_MAC_INDEX_H
+#define GATTROSE_MAC_INDEX_H
+
+#include <stdint.h>
+#include "mac_util.h"
+
+/*
+ * Fixed-capacity open-addressing hash index: MacKey -> table position.
+ *
+ * Linear probing with backward-shift deletion, so there are no tombstones
+ * and lookups stay short after heavy churn. Slot storage is supplied by the
+ * caller (normally a static array) and never reallocated. Size capacity to
+ * at least twice the number of entries.
+ */
+
+#define MAC_INDEX_EMPTY -1
+
+typedef struct {
+    uint32_t key_lo;
+    uint16_t key_hi;
+    int16_t value;          // MAC_INDEX_EMPTY or caller's table position
+} MacIndexSlot;
+
+typedef struct {
+    MacIndexSlot* slots;
+    uint16_t capacity;      // Power of two
+    uint16_t count;
+} MacIndex;
+
+void macIndexInit(MacIndex* idx, MacIndexSlot* slots, uint16_t capacity);
+void macIndexClear(MacIndex* idx);
+
+// Returns the stored value, or MAC_INDEX_EMPTY if key isn't present
+int macIndexFind(const MacIndex* idx, MacKey key);
+
+// Inserts or overwrites. Returns false only if the index is full.
+bool macIndexInsert(MacIndex* idx, MacKey key, int16_t value);
+
+bool macIndexErase(MacIndex* idx, MacKey key);
+
+#endif
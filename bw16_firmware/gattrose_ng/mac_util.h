@@ -0,0 +1,38 @@
+#ifndef GATTROSE_MAC_UTIL_H
+#define GATTROSE_MAC_UTIL_H
+
+#include <stdint.h>
+
+/*
+ * MAC/BSSID identity as a packed 48-bit integer (first octet in the high
+ * byte). Used for all table keys so the frame path compares integers and
+ * never builds strings; hex formatting happens only when a record is sent.
+ */
+typedef uint64_t MacKey;
+
+#define MAC_STR_LEN 18  // "AA:BB:CC:DD:EE:FF" + '\0'
+
+static inline MacKey macToKey(const uint8_t* mac) {
+    return ((MacKey)mac[0] << 40) | ((MacKey)mac[1] << 32) |
+           ((MacKey)mac[2] << 24) | ((MacKey)mac[3] << 16) |
+           ((MacKey)mac[4] << 8)  |  (MacKey)mac[5];
+}
+
+static inline void keyToMac(MacKey key, uint8_t* mac) {
+    for (int i = 5; i >= 0; i--) {
+        mac[i] = key & 0xFF;
+        key >>= 8;
+    }
+}
+
+// Uppercase colon-separated hex into out[MAC_STR_LEN]
+static inline void formatMac(char* out, const uint8_t* mac) {
+    static const char hex[] = "0123456789ABCDEF";
+    for (int i = 0; i < 6; i++) {
+        out[i * 3] = hex[mac[i] >> 4];
+        out[i * 3 + 1] = hex[mac[i] & 0x0F];
+        out[i * 3 + 2] = (i < 5) ? ':' : '\0';
+    }
+}
+
+#endif
@@ -0,0 +1,163 @@
+#include "net_survey.h"
+#include "net_tables.h"
+#include <string.h>
+
+void surveyInit(NetSurvey* sv) {
+    memset(sv, 0, sizeof(*sv));
+}
+
+// ============== Security ==============
+
+#define AKM_SAE     (IE_BIT(IE_AKM_SAE) | IE_BIT(IE_AKM_FT_SAE) | IE_BIT(IE_AKM_SAE_EXT) | \
+                     IE_BIT(IE_AKM_FT_SAE_EXT) | IE_BIT(IE_AKM_OWE))
+#define AKM_EAP     (IE_BIT(IE_AKM_8021X) | IE_BIT(IE_AKM_FT_8021X) | IE_BIT(IE_AKM_8021X_SHA256) | \
+                     IE_BIT(IE_AKM_SUITE_B))
+#define AKM_EAP192  IE_BIT(IE_AKM_SUITE_B_192)
+#define CIPHER_AES  (IE_BIT(IE_CIPHER_CCMP) | IE_BIT(IE_CIPHER_GCMP) | IE_BIT(IE_CIPHER_GCMP256) | \
+                     IE_BIT(IE_CIPHER_CCMP256))
+
+static uint32_t cipherBits(uint16_t pairwise) {
+    uint32_t bits = 0;
+    if (pairwise & IE_BIT(IE_CIPHER_TKIP)) bits |= SV_SEC_TKIP;
+    if (pairwise & CIPHER_AES) bits |= SV_SEC_AES;
+    return bits;
+}
+
+uint32_t surveySecurity(uint16_t capability, const IeBeacon* b) {
+    uint32_t bits = 0;
+    if (b->has_rsn) {
+        uint32_t akms = b->rsn.akms;
+        bits |= cipherBits(b->rsn.pairwise);
+        if (akms & (AKM_SAE | AKM_EAP192)) bits |= SV_SEC_WPA3;
+        if (akms & (AKM_EAP | AKM_EAP192)) bits |= SV_SEC_ENTERPRISE;
+        // PSK, 802.1X or an AKM we don't classify
+        if ((akms & ~(AKM_SAE | AKM_EAP192)) || akms == 0) bits |= SV_SEC_WPA2;
+        if (b->rsn.mfp_required) bits |= SV_SEC_CMAC;
+    }
+    if (b->has_wpa) {
+        bits |= SV_SEC_WPA | cipherBits(b->wpa.pairwise);
+        if (b->wpa.akms & AKM_EAP) bits |= SV_SEC_ENTERPRISE;
+    }
+    if (bits == 0 && (capability & 0x0010)) bits = SV_SEC_WEP;
+    return bits;
+}
+
+bool securityHasPmf(uint32_t security) {
+    if (security == SV_SEC_UNKNOWN) return false;
+    if (security & SV_SEC_CMAC) return true;
+    // WPA3 requires PMF, but transition mode still lets WPA2 clients in without
+    return (security & SV_SEC_WPA3) && !(security & SV_SEC_WPA2);
+}
+
+const char* securityName(uint32_t security) {
+    static const char* const names[2][5] = {
+        {"WPA", "WPA2", "WPA/WPA2", "WPA3", "WPA2/WPA3"},
+        {"WPA-EAP", "WPA2-EAP", "WPA/WPA2-EAP", "WPA3-EAP", "WPA2/WPA3-EAP"},
+    };
+    if (security == SV_SEC_UNKNOWN) return "Unknown";
+    int eap = (security & SV_SEC_ENTERPRISE) ? 1 : 0;
+    bool wpa = security & SV_SEC_WPA, wpa2 = security & SV_SEC_WPA2, wpa3 = security & SV_SEC_WPA3;
+    if (wpa3) return names[eap][wpa2 ? 4 : 3];
+    if (wpa2) return names[eap][wpa ? 2 : 1];
+    if (wpa) return names[eap][0];
+    return (security & SV_SEC_WEP) ? "WEP" : "Open";
+}
+
+// ============== Inventory ==============
+
+int surveyFrame(NetSurvey* sv, const uint8_t* frame, int len, int rssi, int channel,
+                unsigned long now, int* index) {
+    if (index) *index = -1;
+    if (len < 36) return SV_IGNORED;
+    uint8_t subtype = (frame[0] >> 4) & 0x0F;
+    if ((frame[0] & 0x0C) != 0x00 || (subtype != 0x08 && subtype != 0x05)) return SV_IGNORED;
+    sv->frames++;
+
+    const uint8_t* bssid = frame + 16;
+    uint16_t capability = frame[34] | (frame[35] << 8);
+    IeBeacon b;
+    ieParseBeacon(frame + 36, len - 36, &b);
+
+    // Nearby 2.4 GHz channels overhear each other, so trust the frame first
+    int apChannel = ieBeaconChannel(&b);
+    if (!apChannel) apChannel = channel;
+    if (chanToSlot(apChannel) < 0) return SV_IGNORED;
+    uint32_t security = surveySecurity(capability, &b);
+    bool pmf = securityHasPmf(security);
+    uint8_t phy = (b.phy.ht ? NET_PHY_HT : 0) | (b.phy.vht ? NET_PHY_VHT : 0) |
+                  (b.phy.he ? NET_PHY_HE : 0);
+
+    int idx = findNetwork(macToKey(bssid));
+    if (idx >= 0) {
+        WiFiNetwork& net = networks[idx];
+        setNetworkRssi(idx, rssi);
+        net.last_seen = now;
+        setNetworkChannel(net, apChannel);
+        net.is_5ghz = (apChannel >= 36);
+        // A snapshot cut short may have lost the RSN element; keep what we had
+        if (!b.truncated) {
+            net.security = security;
+            net.has_pmf = pmf;
+            net.phy = phy;
+            net.streams = b.phy.streams;
+            net.width_mhz = b.phy.width_mhz;
+        }
+        // A probe response names a hidden network; a beacon only unhides it
+        if (!b.hidden) {
+            memcpy(net.ssid, b.ssid, sizeof(net.ssid));
+            if (subtype == 0x08) net.hidden = false;
+        } else if (subtype == 0x08) {
+            net.hidden = true;
+        }
+        if (index) *index = idx;
+        sv->updated++;
+        return SV_UPDATED;
+    }
+
+    WiFiNetwork net = {};
+    memcpy(net.ssid, b.ssid, sizeof(net.ssid));
+    memcpy(net.bssid, bssid, 6);
+    net.bssid_key = macToKey(bssid);
+    net.rssi = rssi;
+    net.channel = apChannel;
+    net.security = security;
+    net.is_5ghz = (apChannel >= 36);
+    net.has_pmf = pmf;
+    net.hidden = b.hidden;
+    net.phy = phy;
+    net.streams = b.phy.streams;
+    net.width_mhz = b.phy.width_mhz;
+    net.last_seen = now;
+    idx = addNetwork(net);
+    if (idx < 0) {
+        sv->full++;
+        return SV_FULL;
+    }
+    if (index) *index = idx;
+    sv->added++;
+    onNetworkAdded(idx);
+    return SV_ADDED;
+}
+
+int surveyAge(NetSurvey* sv, unsigned long now) {
+    int retired = ageNetworks(now, NETWORK_MAX_AGE_MS);
+    sv->retired += retired;
+    return retired;
+}
+
+// ============== Discovery Sweep ==============
+
+int surveySweepNext(NetSurvey* sv, const ChanSched* sched, unsigned long now, uint32_t* dwell_ms) {
+    if (sched->active > 0 && sv->sweeps > 0 && now - sv->sweep_at < SV_SWEEP_INTERVAL_MS) return 0;
+
+    for (int n = 0; n < CHAN_SLOTS; n++) {
+        int slot = sv->sweep_slot;
+        sv->sweep_slot = (slot + 1) % CHAN_SLOTS;
+        if (sched->slots[slot].ap_count > 0) continue;     // The scheduler visits those
+        sv->sweep_at = now;
+        sv->sweeps++;
+        *dwell_ms = SV_SWEEP_DWELL_MS;
+        return chanSlotToChannel(slot);
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+#ifndef GATTROSE_NET_SURVEY_H
+#define GATTROSE_NET_SURVEY_H
+
+#include <stdint.h>
+#include "channel_sched.h"
+#include "ie_parser.h"
+
+/*
+ * Passive network inventory from beacons and probe responses. Portable.
+ *
+ * While promiscuous mode runs, every beacon and probe response adds its
+ * BSSID to the network table or refreshes the entry: SSID, channel, RSSI,
+ * last seen, security and PHY (from ie_parser). The active scan has to stop
+ * promiscuous mode; this doesn't, so client tracking carries on while the
+ * inventory fills.
+ *
+ * The hop scheduler only visits channels that already have APs. To find
+ * APs elsewhere, surveySweepNext() slips a short visit to one of the other
+ * channels in between, round robin; with no APs known it sweeps them all.
+ * Networks not heard from for NETWORK_MAX_AGE_MS are retired by
+ * surveyAge(). Not thread-safe: call from the task that owns the tables,
+ * the capture worker on the BW16. The sketch skips aging while a scan is
+ * being folded in: promiscuous mode is stopped then, so nothing is heard.
+ */
+
+#define SV_SWEEP_INTERVAL_MS    1000    // Between discovery visits while APs are known
+#define SV_SWEEP_DWELL_MS       150     // Long enough for a 102.4 ms beacon interval
+
+// Security bits, the same as the SDK's rtw_security_t so records built
+// from beacons read like active scan results
+#define SV_SEC_WEP              0x00000001
+#define SV_SEC_TKIP             0x00000002
+#define SV_SEC_AES              0x00000004
+#define SV_SEC_CMAC             0x00000010  // PMF required
+#define SV_SEC_WPA              0x00200000
+#define SV_SEC_WPA2             0x00400000
+#define SV_SEC_WPA3             0x00800000
+#define SV_SEC_ENTERPRISE       0x02000000  // 802.1X AKM
+#define SV_SEC_UNKNOWN          0xFFFFFFFF  // The SDK's RTW_SECURITY_UNKNOWN
+
+enum { SV_IGNORED, SV_ADDED, SV_UPDATED, SV_FULL };
+
+typedef struct {
+    bool active;
+    uint8_t sweep_slot;             // Next channel slot to consider for a sweep
+    unsigned long sweep_at;         // Start of the last sweep visit
+
+    uint32_t frames;                // Beacons and probe responses seen
+    uint32_t added;
+    uint32_t updated;
+    uint32_t full;                  // New BSSIDs the table had no room for
+    uint32_t retired;
+    uint32_t sweeps;
+} NetSurvey;
+
+void surveyInit(NetSurvey* sv);
+
+// Adds or refreshes the network a beacon or probe response describes.
+// channel is the radio's at reception. Returns SV_*; *index (if given) is
+// the network's table index, or -1.
+int surveyFrame(NetSurvey* sv, const uint8_t* frame, int len, int rssi, int channel,
+                unsigned long now, int* index);
+
+// Security bits (SV_SEC_*) from a beacon's capability and decoded elements
+uint32_t surveySecurity(uint16_t capability, const IeBeacon* b);
+
+// True if every client must use protected management frames, so forged
+// deauths can't reach them
+bool securityHasPmf(uint32_t security);
+
+// "Open", "WEP", "WPA2", "WPA2/WPA3", "WPA2-EAP", ... for SV_SEC_* bits,
+// whether from a beacon or the SDK's scan
+const char* securityName(uint32_t security);
+
+// Channel to visit for discovery instead of the scheduler's pick, or 0 if
+// none is due. *dwell_ms is set when a channel is returned.
+int surveySweepNext(NetSurvey* sv, const ChanSched* sched, unsigned long now, uint32_t* dwell_ms);
+
+// Retires networks not heard from for NETWORK_MAX_AGE_MS. Returns how many.
+int surveyAge(NetSurvey* sv, unsigned long now);
+
+// Platform hook: a network was added to the table at networkIndex
+void onNetworkAdded(int networkIndex);
+
+#endif
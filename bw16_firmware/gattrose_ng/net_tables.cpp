@@ -0,0 +1,313 @@
+#include "net_tables.h"
+#include "delta_log.h"
+
+FixedTable<WiFiNetwork, MAX_NETWORKS> networks;
+FixedTable<WiFiClient_t, MAX_CLIENTS> clients;
+
+// Hash indexes beside the networks/clients tables (MacKey -> table position)
+static MacIndexSlot networkIndexSlots[NETWORK_INDEX_SLOTS];
+static MacIndexSlot clientIndexSlots[CLIENT_INDEX_SLOTS];
+MacIndex networkIndex;
+MacIndex clientIndex;
+
+ChanSched chanSched;
+unsigned long newClientTotal = 0;
+unsigned long clientTtlMs = CLIENT_TTL_DEFAULT_MS;
+ClientTableStats clientStats;
+
+// Recency list over live clients, and a free list of vacant slots threaded
+// through lru_next
+static int16_t clientLruHead = -1;      // Least recently seen
+static int16_t clientLruTail = -1;      // Most recently seen
+static int16_t clientFreeHead = -1;
+static int clientActive = 0;
+
+void netTablesInit() {
+    macIndexInit(&networkIndex, networkIndexSlots, NETWORK_INDEX_SLOTS);
+    macIndexInit(&clientIndex, clientIndexSlots, CLIENT_INDEX_SLOTS);
+    chanSchedInit(&chanSched);
+    deltaInit(&deltaLog);
+}
+
+int findClient(MacKey key) {
+    return macIndexFind(&clientIndex, key);
+}
+
+int findNetwork(MacKey bssid) {
+    return macIndexFind(&networkIndex, bssid);
+}
+
+static void lruUnlink(int idx) {
+    WiFiClient_t& c = clients[idx];
+    if (c.lru_prev >= 0) clients[c.lru_prev].lru_next = c.lru_next;
+    else clientLruHead = c.lru_next;
+    if (c.lru_next >= 0) clients[c.lru_next].lru_prev = c.lru_prev;
+    else clientLruTail = c.lru_prev;
+}
+
+static void lruAppend(int idx) {
+    WiFiClient_t& c = clients[idx];
+    c.lru_prev = clientLruTail;
+    c.lru_next = -1;
+    if (clientLruTail >= 0) clients[clientLruTail].lru_next = idx;
+    else clientLruHead = idx;
+    clientLruTail = idx;
+}
+
+int addClient(WiFiClient_t& cli) {
+    if (clientFreeHead < 0) {
+        if (clients.full()) {
+            if (clientLruHead < 0) return -1;
+            evictClient(clientLruHead);
+            clientStats.evicted_lru++;
+        } else {
+            clients.push_back(cli);
+            clients[clients.size() - 1].vacant = true;
+            clients[clients.size() - 1].lru_next = -1;
+            clientFreeHead = clients.size() - 1;
+        }
+    }
+    int idx = clientFreeHead;
+    clientFreeHead = clients[idx].lru_next;
+
+    cli.vacant = false;
+    cli.prev_in_ap = -1;
+    cli.next_in_ap = -1;
+    if (cli.ap_index >= 0) {
+        cli.next_in_ap = networks[cli.ap_index].first_client;
+    }
+    clients[idx] = cli;
+    lruAppend(idx);
+
+    if (cli.ap_index >= 0) {
+        WiFiNetwork& net = networks[cli.ap_index];
+        if (net.first_client >= 0) clients[net.first_client].prev_in_ap = idx;
+        net.first_client = idx;
+        net.client_count++;
+    }
+
+    macIndexInsert(&clientIndex, cli.key, idx);
+    clientActive++;
+    newClientTotal++;
+    deltaRecord(&deltaLog, DELTA_CLIENT, DELTA_INSERT, idx, cli.key);
+    return idx;
+}
+
+void touchClient(int index, unsigned long now) {
+    clients[index].last_seen = now;
+    if (index == clientLruTail) return;
+    lruUnlink(index);
+    lruAppend(index);
+}
+
+void evictClient(int index) {
+    WiFiClient_t& c = clients[index];
+    if (c.vacant) return;
+
+    if (c.ap_index >= 0) {
+        WiFiNetwork& net = networks[c.ap_index];
+        if (c.prev_in_ap >= 0) clients[c.prev_in_ap].next_in_ap = c.next_in_ap;
+        else net.first_client = c.next_in_ap;
+        if (c.next_in_ap >= 0) clients[c.next_in_ap].prev_in_ap = c.prev_in_ap;
+        net.client_count--;
+    }
+
+    lruUnlink(index);
+    macIndexErase(&clientIndex, c.key);
+
+    c.vacant = true;
+    c.ap_index = -1;
+    c.next_in_ap = -1;
+    c.prev_in_ap = -1;
+    c.lru_prev = -1;
+    c.lru_next = clientFreeHead;
+    clientFreeHead = index;
+    clientActive--;
+    deltaRecord(&deltaLog, DELTA_CLIENT, DELTA_EVICT, index, c.key);
+}
+
+int ageClients(unsigned long now) {
+    if (clientTtlMs == 0) return 0;
+    int evicted = 0;
+    while (clientLruHead >= 0 && now - clients[clientLruHead].last_seen > clientTtlMs) {
+        evictClient(clientLruHead);
+        evicted++;
+    }
+    clientStats.evicted_ttl += evicted;
+    return evicted;
+}
+
+// Appends a network. Retired slots are only reused once the table is full,
+// so a host holding an old index is unlikely to hit a different AP.
+int addNetwork(WiFiNetwork& net) {
+    net.ssid[32] = '\0';
+    net.first_client = -1;
+    net.client_count = 0;
+    net.vacant = false;
+
+    int idx;
+    if (networks.push_back(net)) {
+        idx = networks.size() - 1;
+    } else {
+        for (idx = 0; idx < (int)networks.size(); idx++) {
+            if (networks[idx].vacant) break;
+        }
+        if (idx == (int)networks.size()) return -1;
+        networks[idx] = net;
+    }
+
+    macIndexInsert(&networkIndex, net.bssid_key, idx);
+    chanSchedAddAp(&chanSched, net.channel);
+    deltaRecord(&deltaLog, DELTA_NETWORK, DELTA_INSERT, idx, net.bssid_key);
+    return idx;
+}
+
+// Drops an AP from lookups but keeps its slot. Its clients stay in the
+// client table as unassociated.
+void retireNetwork(int index) {
+    WiFiNetwork& net = networks[index];
+    macIndexErase(&networkIndex, net.bssid_key);
+    chanSchedRemoveAp(&chanSched, net.channel);
+
+    int c = net.first_client;
+    while (c >= 0) {
+        int next = clients[c].next_in_ap;
+        clients[c].ap_index = -1;
+        clients[c].next_in_ap = -1;
+        clients[c].prev_in_ap = -1;
+        c = next;
+    }
+    net.first_client = -1;
+    net.client_count = 0;
+    net.vacant = true;
+    deltaRecord(&deltaLog, DELTA_NETWORK, DELTA_EVICT, index, net.bssid_key);
+}
+
+int ageNetworks(unsigned long now, unsigned long maxAge) {
+    int retired = 0;
+    for (size_t i = 0; i < networks.size(); i++) {
+        if (!networks[i].vacant && now - networks[i].last_seen > maxAge) {
+            retireNetwork(i);
+            retired++;
+        }
+    }
+    return retired;
+}
+
+bool isActiveNetwork(int index) {
+    return index >= 0 && index < (int)networks.size() && !networks[index].vacant;
+}
+
+int activeNetworkCount() {
+    int count = 0;
+    for (size_t i = 0; i < networks.size(); i++) {
+        if (!networks[i].vacant) count++;
+    }
+    return count;
+}
+
+bool isActiveClient(int index) {
+    return index >= 0 && index < (int)clients.size() && !clients[index].vacant;
+}
+
+int activeClientCount() {
+    return clientActive;
+}
+
+void clearClients() {
+    clients.clear();
+    macIndexClear(&clientIndex);
+    clientLruHead = -1;
+    clientLruTail = -1;
+    clientFreeHead = -1;
+    clientActive = 0;
+    for (size_t i = 0; i < networks.size(); i++) {
+        networks[i].first_client = -1;
+        networks[i].client_count = 0;
+    }
+    deltaReset(&deltaLog, DELTA_CLIENT);
+}
+
+void clearNetworks() {
+    networks.clear();
+    macIndexClear(&networkIndex);
+    chanSchedClearAps(&chanSched);
+    deltaReset(&deltaLog, DELTA_NETWORK);
+}
+
+// Moves an existing network to another channel, keeping the hop set in step
+void setNetworkChannel(WiFiNetwork& net, int channel) {
+    if (net.channel == channel) return;
+    chanSchedRemoveAp(&chanSched, net.channel);
+    chanSchedAddAp(&chanSched, channel);
+    net.channel = channel;
+}
+
+void setNetworkRssi(int index, int rssi) {
+    networks[index].rssi = rssi;
+    deltaRssi(&deltaLog, DELTA_NETWORK, index, networks[index].bssid_key, rssi);
+}
+
+void setClientRssi(int index, int rssi) {
+    clients[index].rssi = rssi;
+    deltaRssi(&deltaLog, DELTA_CLIENT, index, clients[index].key, rssi);
+}
+
+// Positions change when the table is reordered (sortNetworks). Client
+// lists travel with their network record; only the back-references move.
+// Retired slots stay out of the index so their AP can be added again.
+void rebuildNetworkIndex() {
+    macIndexClear(&networkIndex);
+    for (size_t i = 0; i < networks.size(); i++) {
+        if (networks[i].vacant) continue;
+        macIndexInsert(&networkIndex, networks[i].bssid_key, i);
+        for (int c = networks[i].first_client; c >= 0; c = clients[c].next_in_ap) {
+            clients[c].ap_index = i;
+        }
+    }
+}
+
+void sortNetworks() {
+    // Simple bubble sort - small list so OK
+    for (size_t i = 0; i < networks.size(); i++) {
+        for (size_t j = i + 1; j < networks.size(); j++) {
+            bool swap = false;
+
+            // Retired slots go last
+            if (networks[i].vacant != networks[j].vacant) {
+                swap = networks[i].vacant;
+            }
+            // Priority: named > hidden
+            else if (networks[i].hidden && !networks[j].hidden) {
+                swap = true;
+            }
+            // Then: has clients > no clients
+            else if (!networks[i].hidden && !networks[j].hidden) {
+                if (networks[i].client_count == 0 && networks[j].client_count > 0) {
+                    swap = true;
+                }
+                // Then: no PMF > has PMF (attackable first)
+                else if (networks[i].client_count == networks[j].client_count) {
+                    if (networks[i].has_pmf && !networks[j].has_pmf) {
+                        swap = true;
+                    }
+                    // Finally: by signal strength
+                    else if (networks[i].has_pmf == networks[j].has_pmf) {
+                        if (networks[i].rssi < networks[j].rssi) {
+                            swap = true;
+                        }
+                    }
+                }
+            }
+
+            if (swap) {
+                WiFiNetwork temp = networks[i];
+                networks[i] = networks[j];
+                networks[j] = temp;
+            }
+        }
+    }
+
+    rebuildNetworkIndex();
+    deltaReset(&deltaLog, DELTA_NETWORK);     // Indices moved
+}
@@ -0,0 +1,124 @@
+#ifndef GATTROSE_NET_TABLES_H
+#define GATTROSE_NET_TABLES_H
+
+#include <stdint.h>
+#include "mac_util.h"
+#include "mac_index.h"
+#include "fixed_table.h"
+#include "channel_sched.h"
+
+/*
+ * Network and client tables plus the indexes and channel set that follow
+ * them. Portable - see platform.h.
+ *
+ * Records are POD so the fixed tables can copy, sort and serialize them
+ * without touching the heap. Keep the indexes in sync by going through the
+ * functions below rather than writing the tables directly; they also feed
+ * the change log (delta_log.h).
+ */
+
+#define MAX_NETWORKS 128
+#define MAX_CLIENTS 1024
+#define NETWORK_INDEX_SLOTS 256     // Power of two, >= 2 * MAX_NETWORKS
+#define CLIENT_INDEX_SLOTS 2048     // Power of two, >= 2 * MAX_CLIENTS
+
+#define NET_PHY_HT  0x01     // 802.11n
+#define NET_PHY_VHT 0x02     // 802.11ac
+#define NET_PHY_HE  0x04     // 802.11ax
+
+typedef struct {
+    char ssid[33];       // SSID max 32 chars + null
+    uint8_t bssid[6];
+    MacKey bssid_key;    // Packed bssid, used for lookups
+    int16_t rssi;
+    uint8_t channel;
+    uint32_t security;
+    bool is_5ghz;
+    bool has_pmf;        // Protected Management Frames - can't deauth
+    bool hidden;         // Hidden/empty SSID
+    uint8_t phy;         // NET_PHY_* from beacons, 0 if unknown (scan results)
+    uint8_t streams;     // Most spatial streams advertised, 0 if unknown
+    uint16_t width_mhz;  // Operating channel width, 0 if unknown
+    int client_count;
+    int16_t first_client;   // Head of this AP's client list (index into clients), -1 = none
+    unsigned long last_seen;    // Last scan result or matched frame
+    bool vacant;         // Retired by a merge scan; slot kept so other indices don't shift
+} WiFiNetwork;
+
+typedef struct {
+    uint8_t mac[6];
+    MacKey key;          // Packed mac, used for lookups
+    int8_t rssi;
+    int ap_index;
+    int16_t next_in_ap;  // Next client of the same AP, -1 = end of list
+    int16_t prev_in_ap;  // Previous client of the same AP, -1 = list head
+    int16_t lru_prev;    // Toward least recently seen, -1 = oldest
+    int16_t lru_next;    // Toward most recently seen (next free slot if vacant), -1 = end
+    unsigned long last_seen;
+    bool vacant;         // Evicted; slot waits on the free list
+} WiFiClient_t;
+
+// Clients not seen for this long are aged out; 0 disables aging. Once the
+// table is full, each new client evicts the least recently seen one.
+#define CLIENT_TTL_DEFAULT_MS   600000
+#define CLIENT_AGE_INTERVAL_MS  1000    // How often the owner should call ageClients()
+
+// Merge scans and the passive survey retire APs not heard from for this long
+#define NETWORK_MAX_AGE_MS      300000
+
+typedef struct {
+    uint32_t evicted_lru;   // Pushed out by a new client while full
+    uint32_t evicted_ttl;   // Aged out by ageClients()
+} ClientTableStats;
+
+extern FixedTable<WiFiNetwork, MAX_NETWORKS> networks;
+extern FixedTable<WiFiClient_t, MAX_CLIENTS> clients;
+extern MacIndex networkIndex;
+extern MacIndex clientIndex;
+extern ChanSched chanSched;             // Channel set follows the network table
+extern unsigned long newClientTotal;    // Clients ever added
+extern unsigned long clientTtlMs;
+extern ClientTableStats clientStats;
+
+void netTablesInit();
+
+int findClient(MacKey key);
+int findNetwork(MacKey bssid);
+
+// Adds a client and, if cli.ap_index is set, links it into that AP's list.
+// Reuses an evicted slot, or evicts the least recently seen client if the
+// table is full, so it only fails for a zero-sized table.
+int addClient(WiFiClient_t& cli);
+
+// Marks a client as seen now (most recently used). O(1).
+void touchClient(int index, unsigned long now);
+
+// Removes a client from its AP's list, the LRU order and the index. O(1).
+// The slot is kept (vacant) so other client positions don't move.
+void evictClient(int index);
+
+// Evicts clients older than clientTtlMs, oldest first. Returns how many.
+int ageClients(unsigned long now);
+int addNetwork(WiFiNetwork& net);
+void retireNetwork(int index);
+
+// Retires networks whose last_seen is older than maxAge. Returns how many.
+int ageNetworks(unsigned long now, unsigned long maxAge);
+void setNetworkChannel(WiFiNetwork& net, int channel);
+
+// Sets a record's RSSI; delta_log reports it once it has moved far enough
+void setNetworkRssi(int index, int rssi);
+void setClientRssi(int index, int rssi);
+void clearClients();
+void clearNetworks();
+
+bool isActiveNetwork(int index);
+int activeNetworkCount();
+bool isActiveClient(int index);
+int activeClientCount();
+
+// Named networks with clients first, then by RSSI. Renumbers networks.
+void sortNetworks();
+void rebuildNetworkIndex();
+
+#endif
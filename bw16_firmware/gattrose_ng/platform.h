@@ -0,0 +1,27 @@
+#ifndef GATTROSE_PLATFORM_H
+#define GATTROSE_PLATFORM_H
+
+#include <stdint.h>
+
+/*
+ * Platform shim for the portable core (net_tables, frame_parser).
+ *
+ * The core never touches Arduino, FreeRTOS or the radio directly; it calls
+ * these hooks instead, plus logEmit() from log.h and onRogueAlert() from
+ * rogue_detect.h. The sketch implements them on the BW16 and
+ * host/platform_host.cpp implements them for the Linux replay tools.
+ */
+
+// Monotonic milliseconds
+unsigned long platformMillis();
+
+// A client was added to the client table at clientIndex
+void onClientAdded(int clientIndex);
+
+// A probe request was seen from mac; ssid is "" for a wildcard probe
+void onProbeSsid(const uint8_t* mac, const char* ssid, int rssi);
+
+// A PMKID ('h') or full handshake ('H') was captured for ssid
+void onEapolCaptured(char type, const char* ssid);
+
+#endif
@@ -0,0 +1,194 @@
+#include "probe_stats.h"
+#include "mac_util.h"
+#include <math.h>
+#include <string.h>
+
+// ============== Hashing ==============
+
+// splitmix64 finalizer: spreads every input bit over the whole word
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static uint64_t hashSsid(const char* ssid) {
+    uint64_t h = 0xCBF29CE484222325ULL;     // FNV-1a 64
+    for (const char* p = ssid; *p; p++) {
+        h ^= (uint8_t)*p;
+        h *= 0x100000001B3ULL;
+    }
+    return mix64(h);
+}
+
+// ============== HyperLogLog ==============
+
+static void hllAdd(uint8_t* regs, int bits, uint64_t h) {
+    uint32_t idx = h >> (64 - bits);
+    uint64_t rest = h << bits;
+    uint8_t rank = rest ? __builtin_clzll(rest) + 1 : 64 - bits + 1;
+    if (rank > regs[idx]) regs[idx] = rank;
+}
+
+static uint32_t hllEstimate(const uint8_t* regs, int bits) {
+    int m = 1 << bits;
+    double alpha = (m == 16) ? 0.673 : (m == 32) ? 0.697 : (m == 64) ? 0.709
+                 : 0.7213 / (1.0 + 1.079 / m);
+    double sum = 0;
+    int zeros = 0;
+    for (int i = 0; i < m; i++) {
+        sum += ldexp(1.0, -regs[i]);
+        if (regs[i] == 0) zeros++;
+    }
+    double e = alpha * m * m / sum;
+    // Small cardinalities: linear counting is far more accurate
+    if (e <= 2.5 * m && zeros > 0) e = m * log((double)m / zeros);
+    return (uint32_t)(e + 0.5);
+}
+
+// ============== Bloom Filter ==============
+
+// Sets the pair's bits; true if any was clear, i.e. the pair is new
+static bool bloomAdd(ProbeStats* ps, uint64_t h) {
+    uint32_t h1 = h, h2 = (h >> 32) | 1;
+    bool fresh = false;
+    for (uint32_t i = 0; i < PS_BLOOM_HASHES; i++) {
+        uint32_t bit = (h1 + i * h2) % PS_BLOOM_BITS;
+        uint8_t mask = 1 << (bit & 7);
+        if (!(ps->bloom[bit >> 3] & mask)) {
+            ps->bloom[bit >> 3] |= mask;
+            ps->bloom_set++;
+            fresh = true;
+        }
+    }
+    return fresh;
+}
+
+int probeStatsBloomFill(const ProbeStats* ps) {
+    return (int)((uint64_t)ps->bloom_set * 100 / PS_BLOOM_BITS);
+}
+
+// ============== Count-Min and Top-K ==============
+
+static uint32_t cmsAdd(ProbeStats* ps, uint64_t h) {
+    uint32_t h1 = h, h2 = (h >> 32) | 1;
+    uint32_t est = UINT32_MAX;
+    for (uint32_t d = 0; d < PS_CMS_DEPTH; d++) {
+        uint32_t& c = ps->cms[d][(h1 + d * h2) % PS_CMS_WIDTH];
+        if (c < UINT32_MAX) c++;
+        if (c < est) est = c;
+    }
+    return est;
+}
+
+static void topUpdate(ProbeStats* ps, const char* ssid, uint64_t h, uint32_t est) {
+    int minIdx = -1;
+    for (int i = 0; i < ps->top_count; i++) {
+        if (ps->top[i].hash == h) {
+            ps->top[i].devices = est;
+            return;
+        }
+        if (minIdx < 0 || ps->top[i].devices < ps->top[minIdx].devices) minIdx = i;
+    }
+
+    int slot;
+    if (ps->top_count < PS_TOP_K) slot = ps->top_count++;
+    else if (est > ps->top[minIdx].devices) slot = minIdx;
+    else return;
+
+    strncpy(ps->top[slot].ssid, ssid, 32);
+    ps->top[slot].ssid[32] = '\0';
+    ps->top[slot].hash = h;
+    ps->top[slot].devices = est;
+}
+
+int probeStatsTop(const ProbeStats* ps, ProbeTopEntry* out, int max) {
+    int n = ps->top_count < max ? ps->top_count : max;
+    bool taken[PS_TOP_K] = {false};
+    for (int k = 0; k < n; k++) {
+        int best = -1;
+        for (int i = 0; i < ps->top_count; i++) {
+            if (!taken[i] && (best < 0 || ps->top[i].devices > ps->top[best].devices)) best = i;
+        }
+        taken[best] = true;
+        out[k] = ps->top[best];
+    }
+    return n;
+}
+
+// ============== Windows ==============
+
+static ProbeWindow* currentWindow(ProbeStats* ps, unsigned long now) {
+    uint32_t epoch = now / PS_WINDOW_MS;
+    ProbeWindow* w = &ps->windows[epoch % PS_WINDOWS];
+    if (w->epoch != epoch) {
+        memset(w, 0, sizeof(*w));
+        w->epoch = epoch;
+    }
+    return w;
+}
+
+bool probeStatsWindow(const ProbeStats* ps, int ago, unsigned long now,
+                      uint32_t* probes, uint32_t* devices) {
+    uint32_t epoch = now / PS_WINDOW_MS;
+    if (ago < 0 || ago >= PS_WINDOWS || (uint32_t)ago > epoch) return false;
+    epoch -= ago;
+    if (epoch < ps->started_at / PS_WINDOW_MS) return false;
+
+    const ProbeWindow* w = &ps->windows[epoch % PS_WINDOWS];
+    if (w->epoch != epoch) {
+        // No probes in that window (or it was never written)
+        *probes = 0;
+        *devices = 0;
+        return true;
+    }
+    *probes = w->probes;
+    *devices = hllEstimate(w->hll, PS_WIN_HLL_BITS);
+    return true;
+}
+
+// ============== Recording ==============
+
+void probeStatsClear(ProbeStats* ps, unsigned long now) {
+    memset(ps, 0, sizeof(*ps));
+    ps->started_at = now;
+    // Epoch 0 is a real window; mark every slot as belonging to none
+    for (int i = 0; i < PS_WINDOWS; i++) ps->windows[i].epoch = UINT32_MAX;
+}
+
+bool probeStatsRecord(ProbeStats* ps, const uint8_t* mac, const char* ssid, unsigned long now) {
+    uint64_t macHash = mix64(macToKey(mac));
+    ps->probes++;
+    hllAdd(ps->device_hll, PS_HLL_BITS, macHash);
+
+    ProbeWindow* w = currentWindow(ps, now);
+    w->probes++;
+    hllAdd(w->hll, PS_WIN_HLL_BITS, macHash);
+
+    if (!ssid[0]) return false;
+    ps->directed++;
+    uint64_t ssidHash = hashSsid(ssid);
+    hllAdd(ps->ssid_hll, PS_HLL_BITS, ssidHash);
+
+    if (probeStatsBloomFill(ps) >= PS_BLOOM_MAX_FILL) {
+        memset(ps->bloom, 0, sizeof(ps->bloom));
+        ps->bloom_set = 0;
+        ps->bloom_resets++;
+    }
+    if (!bloomAdd(ps, mix64(macHash ^ ssidHash))) return false;
+
+    ps->pairs++;
+    topUpdate(ps, ssid, ssidHash, cmsAdd(ps, ssidHash));
+    return true;
+}
+
+uint32_t probeStatsDevices(const ProbeStats* ps) {
+    return hllEstimate(ps->device_hll, PS_HLL_BITS);
+}
+
+uint32_t probeStatsSsids(const ProbeStats* ps) {
+    return hllEstimate(ps->ssid_hll, PS_HLL_BITS);
+}
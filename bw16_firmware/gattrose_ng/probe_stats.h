@@ -0,0 +1,89 @@
+#ifndef GATTROSE_PROBE_STATS_H
+#define GATTROSE_PROBE_STATS_H
+
+#include <stdint.h>
+
+/*
+ * Probe request analytics in fixed memory, for occupancy surveys that run
+ * for hours. Portable.
+ *
+ *   - Bloom filter over (device MAC, SSID) pairs: says whether a pair is
+ *     new, so each device counts once per SSID
+ *   - HyperLogLog over MACs and over SSIDs: distinct devices and SSIDs
+ *     since the last clear (~6.5% standard error)
+ *   - Count-min sketch keyed by SSID, bumped once per new pair, with a
+ *     top-K list: the SSIDs most devices are probing for
+ *   - A ring of PS_WINDOWS time windows, each with a probe count and a
+ *     small HyperLogLog of devices (~13% error)
+ *
+ * Nothing grows with traffic. Once the Bloom filter is PS_BLOOM_MAX_FILL
+ * percent full it is cleared (counted in bloom_resets), after which pairs
+ * already seen count once more towards their SSID.
+ *
+ * Wildcard probes (empty SSID) count as traffic and devices only. Not
+ * thread-safe for writers; the read functions don't modify the state.
+ */
+
+#define PS_HLL_BITS         8
+#define PS_HLL_REGS         (1 << PS_HLL_BITS)
+#define PS_WIN_HLL_BITS     6
+#define PS_WIN_HLL_REGS     (1 << PS_WIN_HLL_BITS)
+#define PS_BLOOM_BITS       65536   // 8 KB
+#define PS_BLOOM_HASHES     4
+#define PS_BLOOM_MAX_FILL   50      // Percent of bits set before a reset
+#define PS_CMS_DEPTH        4
+#define PS_CMS_WIDTH        256
+#define PS_TOP_K            16
+#define PS_WINDOWS          24
+#define PS_WINDOW_MS        300000  // 24 x 5 min = 2 hours of history
+
+typedef struct {
+    char ssid[33];
+    uint64_t hash;
+    uint32_t devices;           // Count-min estimate, never under the true count
+} ProbeTopEntry;
+
+typedef struct {
+    uint32_t epoch;             // now / PS_WINDOW_MS this window covers
+    uint32_t probes;
+    uint8_t hll[PS_WIN_HLL_REGS];
+} ProbeWindow;
+
+typedef struct {
+    uint8_t bloom[PS_BLOOM_BITS / 8];
+    uint32_t bloom_set;         // Bits set
+    uint8_t device_hll[PS_HLL_REGS];
+    uint8_t ssid_hll[PS_HLL_REGS];
+    uint32_t cms[PS_CMS_DEPTH][PS_CMS_WIDTH];
+    ProbeTopEntry top[PS_TOP_K];
+    uint8_t top_count;
+    ProbeWindow windows[PS_WINDOWS];    // Indexed by epoch % PS_WINDOWS
+
+    uint32_t probes;
+    uint32_t directed;          // Probes naming an SSID
+    uint32_t pairs;             // New (device, SSID) pairs
+    uint32_t bloom_resets;
+    unsigned long started_at;
+} ProbeStats;
+
+void probeStatsClear(ProbeStats* ps, unsigned long now);
+
+// Records one probe request. ssid is "" for a wildcard probe. Returns true
+// if the device hasn't been seen probing for this SSID before.
+bool probeStatsRecord(ProbeStats* ps, const uint8_t* mac, const char* ssid, unsigned long now);
+
+uint32_t probeStatsDevices(const ProbeStats* ps);
+uint32_t probeStatsSsids(const ProbeStats* ps);
+
+// Fill of the Bloom filter in percent
+int probeStatsBloomFill(const ProbeStats* ps);
+
+// Window 'ago' windows before the current one (0 = current). Returns false
+// if it has no data (never reached, or already overwritten).
+bool probeStatsWindow(const ProbeStats* ps, int ago, unsigned long now,
+                      uint32_t* probes, uint32_t* devices);
+
+// Copies the top SSIDs, most devices first. Returns how many.
+int probeStatsTop(const ProbeStats* ps, ProbeTopEntry* out, int max);
+
+#endif
@@ -0,0 +1,73 @@
+#include "proto.h"
+#include <string.h>
+
+void protoBufInit(ProtoBuf* pb, uint8_t* buf, uint16_t cap) {
+    pb->buf = buf;
+    pb->cap = cap;
+    pb->len = 0;
+    pb->overflow = false;
+}
+
+void protoPutU8(ProtoBuf* pb, uint8_t v) {
+    if (pb->len >= pb->cap) {
+        pb->overflow = true;
+        return;
+    }
+    pb->buf[pb->len++] = v;
+}
+
+void protoPutU16(ProtoBuf* pb, uint16_t v) {
+    protoPutU8(pb, v & 0xFF);
+    protoPutU8(pb, v >> 8);
+}
+
+void protoPutU32(ProtoBuf* pb, uint32_t v) {
+    protoPutU16(pb, v & 0xFFFF);
+    protoPutU16(pb, v >> 16);
+}
+
+void protoPutBytes(ProtoBuf* pb, const void* data, uint16_t len) {
+    if (pb->len + len > pb->cap) {
+        pb->overflow = true;
+        return;
+    }
+    memcpy(pb->buf + pb->len, data, len);
+    pb->len += len;
+}
+
+/*
+ * CRC16-CCITT (false), bitwise. Frames are short enough that a 512 byte
+ * lookup table isn't worth the flash.
+ */
+uint16_t crc16Ccitt(const uint8_t* data, size_t len, uint16_t crc) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+size_t protoEncodeFrame(uint8_t* out, size_t cap, char type, const uint8_t* payload, uint16_t len,
+                        uint16_t req_id) {
+    size_t header = PROTO_HEADER_LEN + (req_id ? PROTO_ID_LEN : 0);
+    size_t total = header + len + PROTO_CRC_LEN;
+    if (len > PROTO_MAX_PAYLOAD || total > cap) return 0;
+
+    size_t pos = 0;
+    out[pos++] = req_id ? PROTO_SYNC_ID : PROTO_SYNC;
+    out[pos++] = (uint8_t)type;
+    if (req_id) {
+        out[pos++] = req_id & 0xFF;
+        out[pos++] = req_id >> 8;
+    }
+    out[pos++] = len & 0xFF;
+    out[pos++] = len >> 8;
+    if (len) memcpy(out + header, payload, len);
+
+    uint16_t crc = crc16Ccitt(out + 1, header - 1 + len);
+    out[header + len] = crc & 0xFF;
+    out[header + len + 1] = crc >> 8;
+    return total;
+}
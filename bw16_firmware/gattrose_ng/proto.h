@@ -0,0 +1,59 @@
+#ifndef GATTROSE_PROTO_H
+#define GATTROSE_PROTO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Compact binary response framing (negotiated with "iB", see PROTOCOL.md)
+ *
+ *   [SYNC 0xA5] [type] [len lo] [len hi] [payload...] [crc lo] [crc hi]
+ *
+ * Responses to a command sent with a request ID use a second sync byte and
+ * carry the ID after the type:
+ *
+ *   [SYNC 0xA6] [type] [id lo] [id hi] [len lo] [len hi] [payload...] [crc lo] [crc hi]
+ *
+ * CRC16-CCITT (poly 0x1021, init 0xFFFF) covers everything between the sync
+ * byte and the CRC. Multi-byte integers are little-endian. Commands from
+ * the host are always STX/ETX text; only responses change format.
+ */
+
+#define PROTO_SYNC          0xA5
+#define PROTO_SYNC_ID       0xA6
+#define PROTO_HEADER_LEN    4
+#define PROTO_ID_LEN        2
+#define PROTO_CRC_LEN       2
+#define PROTO_MAX_PAYLOAD   240
+#define PROTO_MAX_FRAME     (PROTO_HEADER_LEN + PROTO_ID_LEN + PROTO_MAX_PAYLOAD + PROTO_CRC_LEN)
+
+// Network record flags
+#define PROTO_NET_5GHZ      0x01
+#define PROTO_NET_PMF       0x02
+#define PROTO_NET_HIDDEN    0x04
+#define PROTO_NET_HT        0x08
+#define PROTO_NET_VHT       0x10
+#define PROTO_NET_HE        0x20
+
+// Fixed-size little-endian writer over a caller-owned buffer
+typedef struct {
+    uint8_t* buf;
+    uint16_t cap;
+    uint16_t len;
+    bool overflow;
+} ProtoBuf;
+
+void protoBufInit(ProtoBuf* pb, uint8_t* buf, uint16_t cap);
+void protoPutU8(ProtoBuf* pb, uint8_t v);
+void protoPutU16(ProtoBuf* pb, uint16_t v);
+void protoPutU32(ProtoBuf* pb, uint32_t v);
+void protoPutBytes(ProtoBuf* pb, const void* data, uint16_t len);
+
+uint16_t crc16Ccitt(const uint8_t* data, size_t len, uint16_t crc = 0xFFFF);
+
+// Wraps payload into a complete frame, with the ID if req_id isn't 0.
+// Returns frame size, 0 if it won't fit.
+size_t protoEncodeFrame(uint8_t* out, size_t cap, char type, const uint8_t* payload, uint16_t len,
+                        uint16_t req_id = 0);
+
+#endif
@@ -0,0 +1,249 @@
+#include "rogue_detect.h"
+#include "ie_parser.h"
+#include <string.h>
+
+static const char* const alertNames[RA_TYPES] = {
+    "NEW_AP",
+    "EVIL_TWIN",
+    "SSID_CHANGED",
+    "CHANNEL_CHANGED",
+    "SECURITY_CHANGED",
+    "INTERVAL_CHANGED",
+    "SEQ_ANOMALY",
+};
+
+const char* rogueAlertName(int type) {
+    if (type < 0 || type >= RA_TYPES) return "?";
+    return alertNames[type];
+}
+
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME  16777619u
+
+static uint32_t fnv1a(uint32_t h, const uint8_t* data, int len) {
+    for (int i = 0; i < len; i++) {
+        h ^= data[i];
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+// SSIDs share the MacKey index type; the hash sits in the low bits
+static MacKey ssidKey(const char* ssid) {
+    return fnv1a(FNV_OFFSET, (const uint8_t*)ssid, strlen(ssid)) | ((MacKey)1 << 40);
+}
+
+void rogueInit(RogueDetector* rd) {
+    macIndexInit(&rd->bssid_index, rd->bssid_slots, RD_INDEX_SLOTS);
+    macIndexInit(&rd->ssid_index, rd->ssid_slots, RD_INDEX_SLOTS);
+    macIndexInit(&rd->alerted_index, rd->alerted_slots, RD_ALERTED_SLOTS);
+    rogueClearBaseline(rd);
+    rd->active = false;
+}
+
+void rogueClearBaseline(RogueDetector* rd) {
+    rd->baseline.clear();
+    macIndexClear(&rd->bssid_index);
+    macIndexClear(&rd->ssid_index);
+    memset(rd->track, 0, sizeof(rd->track));
+    memset(rd->recent, 0, sizeof(rd->recent));
+    macIndexClear(&rd->alerted_index);
+    memset(rd->alerts, 0, sizeof(rd->alerts));
+    rd->tokens = RD_ALERT_BURST;
+    rd->refill_at = 0;
+    rd->frames_checked = 0;
+    rd->suppressed = 0;
+    rd->alerted_resets = 0;
+}
+
+void rogueStartMonitoring(RogueDetector* rd) {
+    memset(rd->recent, 0, sizeof(rd->recent));
+    macIndexClear(&rd->alerted_index);
+    rd->active = true;
+}
+
+bool rogueAddBaseline(RogueDetector* rd, const uint8_t* bssid, const char* ssid, int channel) {
+    MacKey key = macToKey(bssid);
+    int idx = macIndexFind(&rd->bssid_index, key);
+    if (idx < 0) {
+        RogueBaselineEntry e = {};
+        if (!rd->baseline.push_back(e)) return false;
+        idx = rd->baseline.size() - 1;
+        macIndexInsert(&rd->bssid_index, key, idx);
+    }
+
+    RogueBaselineEntry& e = rd->baseline[idx];
+    e.bssid = key;
+    strncpy(e.ssid, ssid, 32);
+    e.ssid[32] = '\0';
+    e.channel = channel;
+    e.fp_known = false;
+    memset(&rd->track[idx], 0, sizeof(RogueTrack));
+    if (e.ssid[0]) macIndexInsert(&rd->ssid_index, ssidKey(e.ssid), idx);
+    return true;
+}
+
+static bool isUnknownApAlert(uint8_t type) {
+    return type == RA_NEW_AP || type == RA_EVIL_TWIN;
+}
+
+// Rate limiting: once per session for unknown BSSIDs, a per (BSSID, type)
+// holdoff for baseline ones, then a global token bucket. Only an alert that
+// goes out is remembered, so one cut off by the bucket comes back later.
+static bool alertAllowed(RogueDetector* rd, MacKey bssid, uint8_t type, unsigned long now) {
+    int reported = 0;
+    if (isUnknownApAlert(type)) {
+        int seen = macIndexFind(&rd->alerted_index, bssid);
+        if (seen != MAC_INDEX_EMPTY) reported = seen;
+        if (reported & (1 << type)) return false;
+    }
+
+    int oldest = 0;
+    for (int i = 0; i < RD_RECENT_ALERTS && !isUnknownApAlert(type); i++) {
+        RogueRecentAlert& r = rd->recent[i];
+        if (r.at && r.bssid == bssid && r.type == type && now - r.at < RD_ALERT_HOLDOFF_MS) {
+            return false;
+        }
+        if (r.at < rd->recent[oldest].at) oldest = i;
+    }
+
+    unsigned long refills = (now - rd->refill_at) / RD_ALERT_REFILL_MS;
+    if (refills > 0) {
+        rd->tokens = (rd->tokens + refills > RD_ALERT_BURST) ? RD_ALERT_BURST : rd->tokens + refills;
+        rd->refill_at = now;
+    }
+    if (rd->tokens == 0) return false;
+    rd->tokens--;
+
+    if (isUnknownApAlert(type)) {
+        if (!reported && rd->alerted_index.count >= RD_MAX_ALERTED) {
+            macIndexClear(&rd->alerted_index);
+            rd->alerted_resets++;
+        }
+        macIndexInsert(&rd->alerted_index, bssid, reported | (1 << type));
+        return true;
+    }
+    rd->recent[oldest].bssid = bssid;
+    rd->recent[oldest].type = type;
+    rd->recent[oldest].at = now ? now : 1;
+    return true;
+}
+
+static void raiseAlert(RogueDetector* rd, uint8_t type, const uint8_t* bssid, const char* ssid,
+                       int channel, uint32_t expected, uint32_t observed, unsigned long now) {
+    if (!alertAllowed(rd, macToKey(bssid), type, now)) {
+        rd->suppressed++;
+        return;
+    }
+    rd->alerts[type]++;
+
+    RogueAlert a;
+    a.type = type;
+    memcpy(a.bssid, bssid, 6);
+    memcpy(a.ssid, ssid, sizeof(a.ssid));
+    a.channel = channel;
+    a.expected = expected;
+    a.observed = observed;
+    onRogueAlert(&a);
+}
+
+// Sequence numbers from one transmitter only move forward. Two radios
+// beaconing the same BSSID make them repeat or jump back.
+static bool seqAnomaly(RogueTrack& t, uint16_t seq, unsigned long now) {
+    bool anomaly = false;
+    if (t.last_seq_at && now - t.last_seq_at < RD_SEQ_GAP_MS) {
+        uint16_t delta = (seq - t.last_seq) & 0x0FFF;
+        anomaly = (delta == 0 || delta > 2048);
+    }
+    t.last_seq = seq;
+    t.last_seq_at = now ? now : 1;
+    if (!anomaly) return false;
+
+    if (t.anomalies == 0 || now - t.window_start > RD_SEQ_WINDOW_MS) {
+        t.window_start = now;
+        t.anomalies = 0;
+    }
+    if (++t.anomalies < RD_SEQ_ANOMALIES) return false;
+    t.anomalies = 0;
+    return true;
+}
+
+void rogueCheckFrame(RogueDetector* rd, const uint8_t* frame, int len, int channel, unsigned long now) {
+    if (!rd->active || len < 36) return;
+    uint8_t subtype = (frame[0] >> 4) & 0x0F;
+    if ((frame[0] & 0x0C) != 0x00 || (subtype != 0x08 && subtype != 0x05)) return;
+    rd->frames_checked++;
+
+    const uint8_t* bssid = frame + 16;
+    bool retry = (frame[1] & 0x08) != 0;
+    uint16_t seq = (frame[22] | (frame[23] << 8)) >> 4;
+    uint16_t interval = frame[32] | (frame[33] << 8);
+    uint16_t capability = (frame[34] | (frame[35] << 8)) & RD_CAP_MASK;
+
+    char ssid[33] = {0};
+    bool ssidHidden = true;
+    int dsChannel = 0;
+    int htChannel = 0;
+    uint32_t secHash = 0;
+
+    IeIter it;
+    IeElement ie;
+    ieIterInit(&it, frame + 36, len - 36);
+    while (ieNext(&it, &ie)) {
+        if (ie.id == IE_SSID && ie.len <= 32) {
+            memcpy(ssid, ie.data, ie.len);
+            for (int i = 0; i < ie.len; i++) {
+                if (ie.data[i]) ssidHidden = false;
+            }
+        } else if (ie.id == IE_DS_PARAMS && ie.len >= 1) {
+            dsChannel = ie.data[0];
+        } else if (ie.id == IE_HT_OP && ie.len >= 1) {
+            htChannel = ie.data[0];     // Primary channel
+        } else if (ie.id == IE_RSN || ieIsVendor(&ie, 0x00, 0x50, 0xF2, 0x01)) {
+            // Hashed raw: any change to ciphers, AKMs or capabilities counts
+            secHash = fnv1a(secHash ? secHash : FNV_OFFSET, ie.data, ie.len);
+        }
+    }
+    // Nearby 2.4 GHz channels overhear each other, so trust the frame first
+    int apChannel = dsChannel ? dsChannel : (htChannel ? htChannel : channel);
+
+    int idx = macIndexFind(&rd->bssid_index, macToKey(bssid));
+    if (idx < 0) {
+        int twin = ssidHidden ? -1 : macIndexFind(&rd->ssid_index, ssidKey(ssid));
+        if (twin >= 0 && strcmp(rd->baseline[twin].ssid, ssid) == 0) {
+            raiseAlert(rd, RA_EVIL_TWIN, bssid, ssid, apChannel, 0, 0, now);
+        } else {
+            raiseAlert(rd, RA_NEW_AP, bssid, ssid, apChannel, 0, 0, now);
+        }
+        return;
+    }
+
+    RogueBaselineEntry& e = rd->baseline[idx];
+    const char* name = ssidHidden ? e.ssid : ssid;
+
+    // Hidden networks blank their SSID in beacons, so only compare two real ones
+    if (!ssidHidden && e.ssid[0] && strcmp(e.ssid, ssid) != 0) {
+        raiseAlert(rd, RA_SSID_CHANGED, bssid, ssid, apChannel, 0, 0, now);
+    }
+    if (apChannel != e.channel) {
+        raiseAlert(rd, RA_CHANNEL_CHANGED, bssid, name, apChannel, e.channel, apChannel, now);
+    }
+
+    if (!e.fp_known) {
+        e.capability = capability;
+        e.beacon_interval = interval;
+        e.sec_hash = secHash;
+        e.fp_known = true;
+    } else {
+        if (capability != e.capability || secHash != e.sec_hash) {
+            raiseAlert(rd, RA_SECURITY_CHANGED, bssid, name, apChannel, e.capability, capability, now);
+        }
+        if (interval != e.beacon_interval) {
+            raiseAlert(rd, RA_INTERVAL_CHANGED, bssid, name, apChannel, e.beacon_interval, interval, now);
+        }
+    }
+
+    if (!retry && seqAnomaly(rd->track[idx], seq, now)) {
+        raiseAlert(rd, RA_SEQ_ANOMALY, bssid, name, apChannel, 0, seq, now);
+    }
+}
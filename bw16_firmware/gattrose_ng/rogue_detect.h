@@ -0,0 +1,133 @@
+#ifndef GATTROSE_ROGUE_DETECT_H
+#define GATTROSE_ROGUE_DETECT_H
+
+#include <stdint.h>
+#include "mac_util.h"
+#include "mac_index.h"
+#include "fixed_table.h"
+
+/*
+ * Rogue AP / evil-twin detection on the passive beacon stream. Portable.
+ *
+ * A baseline of trusted APs is taken from a scan. Every beacon and probe
+ * response seen afterwards is checked as it arrives:
+ *   - unknown BSSID advertising a baseline SSID      -> EVIL_TWIN
+ *   - unknown BSSID otherwise                        -> NEW_AP
+ *   - baseline BSSID with a different SSID / channel -> SSID_CHANGED / CHANNEL_CHANGED
+ *   - capability or RSN/WPA IEs differ               -> SECURITY_CHANGED
+ *   - beacon interval differs                        -> INTERVAL_CHANGED
+ *   - sequence numbers repeating or running backwards -> SEQ_ANOMALY
+ *     (a second transmitter using the same BSSID)
+ *
+ * A scan does not report capability, security IEs or beacon interval, so
+ * that fingerprint is learned from the first frame seen per baseline AP.
+ * Lookups go through hash indexes on BSSID and SSID hash. Alerts go out
+ * through onRogueAlert(), overall through a token bucket. An unknown BSSID
+ * raises NEW_AP or EVIL_TWIN once per monitoring session: a busy area has
+ * far more of them than a holdoff list could hold. Up to RD_MAX_ALERTED are
+ * remembered; past that the set starts over. Alerts about baseline APs come
+ * at most once per BSSID and type per RD_ALERT_HOLDOFF_MS.
+ *
+ * Not thread-safe: check frames from one task only.
+ */
+
+#define RD_MAX_BASELINE     128
+#define RD_INDEX_SLOTS      256     // Power of two, >= 2 * RD_MAX_BASELINE
+#define RD_RECENT_ALERTS    32      // Holdoff memory, oldest replaced first
+#define RD_MAX_ALERTED      256     // Unknown BSSIDs remembered as already reported
+#define RD_ALERTED_SLOTS    512     // Power of two, >= 2 * RD_MAX_ALERTED
+#define RD_ALERT_HOLDOFF_MS 60000
+#define RD_ALERT_BURST      8       // Token bucket size
+#define RD_ALERT_REFILL_MS  500     // One token per interval
+#define RD_SEQ_GAP_MS       1000    // Only compare sequence numbers this close together
+#define RD_SEQ_WINDOW_MS    10000
+#define RD_SEQ_ANOMALIES    3       // Anomalies within the window before alerting
+
+// Capability bits that belong to the AP's configuration (ESS, IBSS, privacy)
+#define RD_CAP_MASK         0x0013
+
+enum {
+    RA_NEW_AP = 0,
+    RA_EVIL_TWIN,
+    RA_SSID_CHANGED,
+    RA_CHANNEL_CHANGED,
+    RA_SECURITY_CHANGED,
+    RA_INTERVAL_CHANGED,
+    RA_SEQ_ANOMALY,
+    RA_TYPES
+};
+
+typedef struct {
+    MacKey bssid;
+    char ssid[33];
+    uint8_t channel;
+    bool fp_known;              // Fingerprint below has been learned
+    uint16_t capability;        // Masked with RD_CAP_MASK
+    uint16_t beacon_interval;   // TU
+    uint32_t sec_hash;          // FNV-1a over RSN and WPA IE bodies, 0 if neither
+} RogueBaselineEntry;
+
+// Per-baseline-AP state that only matters while monitoring
+typedef struct {
+    uint16_t last_seq;
+    unsigned long last_seq_at;
+    unsigned long window_start;
+    uint8_t anomalies;
+} RogueTrack;
+
+typedef struct {
+    uint8_t type;
+    uint8_t bssid[6];
+    char ssid[33];
+    uint8_t channel;            // Where the frame said it was
+    uint32_t expected;          // Baseline value for *_CHANGED, else 0
+    uint32_t observed;
+} RogueAlert;
+
+typedef struct {
+    MacKey bssid;
+    uint8_t type;
+    unsigned long at;
+} RogueRecentAlert;
+
+typedef struct {
+    FixedTable<RogueBaselineEntry, RD_MAX_BASELINE> baseline;
+    RogueTrack track[RD_MAX_BASELINE];
+    MacIndexSlot bssid_slots[RD_INDEX_SLOTS];
+    MacIndexSlot ssid_slots[RD_INDEX_SLOTS];
+    MacIndex bssid_index;
+    MacIndex ssid_index;        // Keyed by ssidKey(), value is any AP with that SSID
+
+    RogueRecentAlert recent[RD_RECENT_ALERTS];
+    MacIndexSlot alerted_slots[RD_ALERTED_SLOTS];
+    MacIndex alerted_index;     // Unknown BSSIDs reported this session, value = 1 << type
+    uint8_t tokens;
+    unsigned long refill_at;
+
+    bool active;
+    uint32_t frames_checked;
+    uint32_t alerts[RA_TYPES];  // Raised
+    uint32_t suppressed;        // Held off or over the rate limit
+    uint32_t alerted_resets;    // Times the reported set filled up and started over
+} RogueDetector;
+
+void rogueInit(RogueDetector* rd);
+void rogueClearBaseline(RogueDetector* rd);
+
+// Turns checking on and starts a new session: unknown BSSIDs reported
+// before are reported again
+void rogueStartMonitoring(RogueDetector* rd);
+
+// Adds or updates a trusted AP. Returns false if the baseline is full.
+bool rogueAddBaseline(RogueDetector* rd, const uint8_t* bssid, const char* ssid, int channel);
+
+// Checks a beacon or probe response; other frames are ignored. channel is
+// the radio's, used when the frame carries no DS or HT operation IE.
+void rogueCheckFrame(RogueDetector* rd, const uint8_t* frame, int len, int channel, unsigned long now);
+
+const char* rogueAlertName(int type);
+
+// Platform hook: an alert passed rate limiting
+void onRogueAlert(const RogueAlert* alert);
+
+#endif
@@ -0,0 +1,61 @@
+#include "trace.h"
+
+static const char* const traceSiteNames[TRACE_SITES] = {
+    "promisc_cb",
+    "capture_frame",
+    "hop_iter",
+    "net_list",
+    "scan_task",
+};
+
+const char* traceSiteName(int site) {
+    if (site < 0 || site >= TRACE_SITES) return "?";
+    return traceSiteNames[site];
+}
+
+#ifdef GATTROSE_TRACE
+
+#include <string.h>
+
+#define DEMCR_REG       (*(volatile uint32_t*)0xE000EDFC)
+#define DEMCR_TRCENA    (1UL << 24)
+#define DWT_CTRL_REG    (*(volatile uint32_t*)0xE0001000)
+#define DWT_CYCCNTENA   (1UL << 0)
+#define DWT_NOCYCCNT    (1UL << 25)
+
+TraceStat traceStats[TRACE_SITES];
+
+bool traceInit() {
+    traceClear();
+    DEMCR_REG |= DEMCR_TRCENA;
+    if (DWT_CTRL_REG & DWT_NOCYCCNT) return false;
+    DWT_CYCCNT_REG = 0;
+    DWT_CTRL_REG |= DWT_CYCCNTENA;
+    return true;
+}
+
+void traceClear() {
+    memset(traceStats, 0, sizeof(traceStats));
+    for (int i = 0; i < TRACE_SITES; i++) traceStats[i].min = UINT32_MAX;
+}
+
+// Masks interrupts rather than taking a FreeRTOS critical section, so it is
+// also safe from the promiscuous callback's context
+void traceRecord(int site, uint32_t cycles) {
+    // floor(log4(cycles)) from the bit length
+    int bucket = cycles ? (31 - __builtin_clz(cycles)) / 2 : 0;
+
+    uint32_t primask;
+    __asm volatile ("mrs %0, primask\n\tcpsid i" : "=r" (primask) :: "memory");
+
+    TraceStat& s = traceStats[site];
+    s.count++;
+    s.total += cycles;
+    if (cycles < s.min) s.min = cycles;
+    if (cycles > s.max) s.max = cycles;
+    s.hist[bucket]++;
+
+    __asm volatile ("msr primask, %0" :: "r" (primask) : "memory");
+}
+
+#endif
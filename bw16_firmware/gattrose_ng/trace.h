@@ -0,0 +1,107 @@
+#ifndef GATTROSE_TRACE_H
+#define GATTROSE_TRACE_H
+
+#include <stdint.h>
+
+// Uncomment to time the sites below with the DWT cycle counter
+// #define GATTROSE_TRACE
+
+/*
+ * Cycle-counter tracing for hot paths on the KM4 (Cortex-M33).
+ *
+ * Each site keeps count, min, max, total and a histogram in a static table;
+ * the 't' command dumps it. A site may be timed from several tasks (command
+ * handlers run on the dispatcher and the slow worker), so traceRecord()
+ * updates a site with interrupts masked; a dump racing an update may still
+ * be one sample off. Without GATTROSE_TRACE the macros expand to nothing.
+ *
+ * Deltas are 32-bit: a single span must stay under 2^32 cycles (~21 s at
+ * 200 MHz). Pause a span across blocking waits so it measures work only.
+ */
+
+enum TraceSite {
+    TRACE_PROMISC_CB = 0,       // promiscCallback, per frame
+    TRACE_CAPTURE_FRAME,        // Capture worker, per frame parsed
+    TRACE_HOP_ITER,             // channelHopTaskFunc, per hop minus the dwell
+    TRACE_NET_LIST,             // sendNetworkList
+    TRACE_SCAN_TASK,            // scanNetworksTask minus waits on the radio
+    TRACE_SITES
+};
+
+// Bucket i counts spans of [4^i, 4^(i+1)) cycles; bucket 0 also takes 0
+#define TRACE_BUCKETS   16
+#define TRACE_CPU_HZ    200000000UL     // KM4 core clock, for converting cycles
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t hist[TRACE_BUCKETS];
+} TraceStat;
+
+const char* traceSiteName(int site);
+
+#ifdef GATTROSE_TRACE
+
+#define DWT_CYCCNT_REG  (*(volatile uint32_t*)0xE0001004)
+
+extern TraceStat traceStats[TRACE_SITES];
+
+// Enables the cycle counter. Returns false if the core has none.
+bool traceInit();
+void traceClear();
+void traceRecord(int site, uint32_t cycles);
+
+static inline uint32_t traceCycles() {
+    return DWT_CYCCNT_REG;
+}
+
+// Times from construction to end() or scope exit, minus paused stretches
+class TraceSpan {
+public:
+    explicit TraceSpan(int site) : site_(site), acc_(0), start_(traceCycles()), state_(RUNNING) {}
+    ~TraceSpan() { end(); }
+
+    void pause() {
+        if (state_ != RUNNING) return;
+        acc_ += traceCycles() - start_;
+        state_ = PAUSED;
+    }
+
+    void resume() {
+        if (state_ != PAUSED) return;
+        start_ = traceCycles();
+        state_ = RUNNING;
+    }
+
+    void end() {
+        pause();
+        if (state_ != PAUSED) return;
+        traceRecord(site_, acc_);
+        state_ = DONE;
+    }
+
+private:
+    enum { RUNNING, PAUSED, DONE };
+    int site_;
+    uint32_t acc_;
+    uint32_t start_;
+    uint8_t state_;
+};
+
+#define TRACE_SPAN(var, site)   TraceSpan var(site)
+#define TRACE_PAUSE(var)        var.pause()
+#define TRACE_RESUME(var)       var.resume()
+#define TRACE_END(var)          var.end()
+
+#else
+
+#define TRACE_SPAN(var, site)
+#define TRACE_PAUSE(var)
+#define TRACE_RESUME(var)
+#define TRACE_END(var)
+
+#endif
+
+#endif
@@ -0,0 +1,116 @@
+#include "tx_ring.h"
+#include <string.h>
+
+#define TX_RING_MASK (TX_RING_SLOTS - 1)
+
+void txRingInit(TxRing* ring) {
+    for (uint32_t i = 0; i < TX_RING_SLOTS; i++) {
+        ring->slots[i].seq.store(i, std::memory_order_relaxed);
+        ring->slots[i].msg_len = 0;
+    }
+    ring->head.store(0, std::memory_order_relaxed);
+    ring->tail = 0;
+    ring->high_water.store(0, std::memory_order_relaxed);
+    ring->drops.store(0, std::memory_order_relaxed);
+}
+
+bool txRingPush(TxRing* ring, const TxPart* parts, int count) {
+    size_t total = 0;
+    for (int i = 0; i < count; i++) total += parts[i].len;
+    if (total == 0) return true;
+    if (total > TX_RING_MAX_MSG) {
+        ring->drops.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    uint32_t need = (total + TX_SLOT_SIZE - 1) / TX_SLOT_SIZE;
+    uint32_t pos = ring->head.load(std::memory_order_relaxed);
+
+    // Reserve [pos, pos + need). The consumer frees slots in order, so if the
+    // last slot of the run is free for this lap, every slot before it is too.
+    for (;;) {
+        uint32_t last = pos + need - 1;
+        uint32_t seq = ring->slots[last & TX_RING_MASK].seq.load(std::memory_order_acquire);
+        int32_t dif = (int32_t)(seq - last);
+
+        if (dif == 0) {
+            if (ring->head.compare_exchange_weak(pos, pos + need, std::memory_order_relaxed)) {
+                break;
+            }
+            // pos reloaded by the failed CAS
+        } else if (dif < 0) {
+            ring->drops.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = ring->head.load(std::memory_order_relaxed);
+        }
+    }
+
+    // Copy parts across the reserved slots
+    uint32_t slot = 0;
+    size_t off = 0;
+    for (int i = 0; i < count; i++) {
+        const uint8_t* src = (const uint8_t*)parts[i].data;
+        size_t left = parts[i].len;
+        while (left > 0) {
+            TxSlot* s = &ring->slots[(pos + slot) & TX_RING_MASK];
+            size_t n = TX_SLOT_SIZE - off;
+            if (n > left) n = left;
+            memcpy(s->data + off, src, n);
+            src += n;
+            left -= n;
+            off += n;
+            if (off == TX_SLOT_SIZE) {
+                off = 0;
+                slot++;
+            }
+        }
+    }
+    ring->slots[pos & TX_RING_MASK].msg_len = total;
+
+    // Publish
+    for (uint32_t k = 0; k < need; k++) {
+        ring->slots[(pos + k) & TX_RING_MASK].seq.store(pos + k + 1, std::memory_order_release);
+    }
+
+    // Occupancy is approximate (tail is read racily) but good enough for a stat
+    uint32_t used = (pos + need) - *(volatile uint32_t*)&ring->tail;
+    uint32_t hw = ring->high_water.load(std::memory_order_relaxed);
+    while (used > hw && !ring->high_water.compare_exchange_weak(hw, used, std::memory_order_relaxed)) {
+    }
+    return true;
+}
+
+size_t txRingPop(TxRing* ring, uint8_t* out, size_t cap) {
+    uint32_t pos = ring->tail;
+    TxSlot* first = &ring->slots[pos & TX_RING_MASK];
+    if (first->seq.load(std::memory_order_acquire) != pos + 1) return 0;
+
+    size_t total = first->msg_len;
+    uint32_t need = (total + TX_SLOT_SIZE - 1) / TX_SLOT_SIZE;
+
+    // Don't consume a message until all of its slots are published
+    for (uint32_t k = 1; k < need; k++) {
+        uint32_t seq = ring->slots[(pos + k) & TX_RING_MASK].seq.load(std::memory_order_acquire);
+        if (seq != pos + k + 1) return 0;
+    }
+
+    size_t copied = 0;
+    for (uint32_t k = 0; k < need; k++) {
+        TxSlot* s = &ring->slots[(pos + k) & TX_RING_MASK];
+        size_t n = total - k * TX_SLOT_SIZE;
+        if (n > TX_SLOT_SIZE) n = TX_SLOT_SIZE;
+        if (copied + n <= cap) {
+            memcpy(out + copied, s->data, n);
+            copied += n;
+        }
+        s->seq.store(pos + k + TX_RING_SLOTS, std::memory_order_release);
+    }
+    *(volatile uint32_t*)&ring->tail = pos + need;
+
+    return copied;
+}
+
+uint32_t txRingUsed(TxRing* ring) {
+    return ring->head.load(std::memory_order_relaxed) - *(volatile uint32_t*)&ring->tail;
+}
@@ -0,0 +1,58 @@
+#ifndef GATTROSE_TX_RING_H
+#define GATTROSE_TX_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+/*
+ * Lock-free multi-producer / single-consumer message ring for serial output.
+ *
+ * Storage is a power-of-two array of fixed-size slots, each with a sequence
+ * number (Vyukov bounded queue). A message occupies one or more consecutive
+ * slots that a producer reserves with a single CAS, so messages from
+ * different producers never interleave. The consumer only pops a message
+ * once every slot in it has been published.
+ *
+ * Producers never block: if the ring is full the message is dropped and
+ * counted.
+ */
+
+#define TX_RING_SLOTS       128     // Must be a power of two
+#define TX_SLOT_SIZE        32
+#define TX_RING_MAX_MSG     ((TX_RING_SLOTS / 2) * TX_SLOT_SIZE)
+
+typedef struct {
+    std::atomic<uint32_t> seq;
+    uint16_t msg_len;               // Only meaningful in a message's first slot
+    uint8_t data[TX_SLOT_SIZE];
+} TxSlot;
+
+typedef struct {
+    TxSlot slots[TX_RING_SLOTS];
+    std::atomic<uint32_t> head;     // Next slot to reserve (producers)
+    uint32_t tail;                  // Next slot to pop (consumer only)
+
+    // Stats (reported by the 'i' command)
+    std::atomic<uint32_t> high_water;   // Max slots in use
+    std::atomic<uint32_t> drops;        // Messages dropped because ring was full
+} TxRing;
+
+// Scatter-gather piece of a message
+typedef struct {
+    const void* data;
+    size_t len;
+} TxPart;
+
+void txRingInit(TxRing* ring);
+
+// Enqueue the concatenation of parts as one message. Returns false if dropped.
+bool txRingPush(TxRing* ring, const TxPart* parts, int count);
+
+// Dequeue the next complete message into out. Returns its length, 0 if none.
+// Single consumer only.
+size_t txRingPop(TxRing* ring, uint8_t* out, size_t cap);
+
+uint32_t txRingUsed(TxRing* ring);
+
+#endif
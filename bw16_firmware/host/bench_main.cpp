@@ -0,0 +1,289 @@
+// gattrose_bench - throughput, allocation and latency numbers for the
+// frame-processing hot path (processFrame and the tables behind it).
+//
+//   gattrose_bench [--frames N] [file.pcap ...]
+//
+// Synthetic runs cover the data, management and probe paths with 10, 100
+// and 1000 clients already known. Each pcap given is replayed as a run of
+// its own. Every batch starts from the same table state so occupancy holds
+// steady across a run; the reset is not timed.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <new>
+#include <vector>
+#include "frame_builder.h"
+#include "pcap_reader.h"
+#include "platform_host.h"
+#include "net_tables.h"
+#include "frame_parser.h"
+#include "capture_ring.h"
+#include "net_survey.h"
+
+// ============== Allocation Counting ==============
+
+static unsigned long g_allocs = 0;
+
+#if defined(__GLIBC__)
+// Interpose the C allocator so operator new and any direct malloc are both seen
+extern "C" {
+void* __libc_malloc(size_t n);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* p, size_t n);
+
+void* malloc(size_t n) {
+    g_allocs++;
+    return __libc_malloc(n);
+}
+
+void* calloc(size_t n, size_t size) {
+    g_allocs++;
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* p, size_t n) {
+    g_allocs++;
+    return __libc_realloc(p, n);
+}
+}
+#else
+// Elsewhere only C++ allocations are counted
+void* operator new(size_t n) {
+    g_allocs++;
+    void* p = malloc(n ? n : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void* operator new[](size_t n) { return operator new(n); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+#endif
+
+// ============== Frame Pools ==============
+
+#define BENCH_NETWORKS  32
+#define BENCH_BATCH     128     // Frames per batch; 1 in 8 is from a new client
+
+typedef struct {
+    std::vector<uint8_t> data;
+    int rssi;
+} BenchFrame;
+
+typedef std::vector<BenchFrame> FramePool;
+
+static uint8_t apMac[BENCH_NETWORKS][6];
+
+static unsigned long long nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void poolAdd(FramePool& pool, const uint8_t* buf, int len, int rssi) {
+    BenchFrame f;
+    f.data.assign(buf, buf + std::min(len, CAPTURE_SNAP_LEN));
+    f.rssi = rssi;
+    pool.push_back(f);
+}
+
+static NetSurvey survey;
+
+static void seedNetworks() {
+    surveyInit(&survey);
+    netTablesInit();
+    clearNetworks();
+    uint8_t buf[256];
+    for (int i = 0; i < BENCH_NETWORKS; i++) {
+        fbMac(apMac[i], 0x02, 0xA0000 + i);
+        char ssid[16];
+        snprintf(ssid, sizeof(ssid), "net%02d", i);
+        int channel = (i < 16) ? 1 + (i % 11) : 36 + 4 * (i % 8);
+        surveyFrame(&survey, buf, fbBeacon(buf, apMac[i], ssid, channel), -40 - i, channel, 0, NULL);
+    }
+}
+
+// Client i belongs to network i % BENCH_NETWORKS
+static void populateClients(int count) {
+    clearClients();
+    for (int i = 0; i < count; i++) {
+        WiFiClient_t cli = {};
+        fbMac(cli.mac, 0x10, i);
+        cli.key = macToKey(cli.mac);
+        cli.rssi = -60;
+        cli.ap_index = findNetwork(macToKey(apMac[i % BENCH_NETWORKS]));
+        addClient(cli);
+    }
+}
+
+enum BenchPath { PATH_DATA, PATH_MGMT, PATH_PROBE };
+
+static void buildSyntheticPool(FramePool& pool, BenchPath path, int known) {
+    pool.clear();
+    uint8_t buf[256], sta[6], stray[6];
+    fbMac(stray, 0x02, 0xBEEF);
+
+    for (int j = 0; j < BENCH_BATCH; j++) {
+        bool fresh = (j % 8) == 7;
+        int id = fresh ? 0x100000 + j : (j * 7919) % known;
+        fbMac(sta, 0x10, id);
+        const uint8_t* bssid = apMac[id % BENCH_NETWORKS];
+        int rssi = -50 - (j % 30);
+        int len;
+
+        switch (path) {
+            case PATH_DATA:
+                if (j % 16 == 3) bssid = stray;     // AP we never saw
+                len = fbData(buf, sta, bssid, j & 1, 100);
+                break;
+            case PATH_MGMT:
+                len = (j & 1) ? fbAuth(buf, sta, bssid) : fbAssocReq(buf, sta, bssid);
+                break;
+            default: {
+                char ssid[16];
+                if (j % 3 == 0) snprintf(ssid, sizeof(ssid), "elsewhere%d", j);
+                else snprintf(ssid, sizeof(ssid), "net%02d", id % BENCH_NETWORKS);
+                len = fbProbeReq(buf, sta, ssid);
+                break;
+            }
+        }
+        poolAdd(pool, buf, len, rssi);
+    }
+}
+
+// ============== Measurement ==============
+
+typedef struct {
+    unsigned long frames;
+    double fps;
+    double allocs_per_frame;
+    unsigned long long p50_ns;
+    unsigned long long p99_ns;
+} BenchResult;
+
+static BenchResult runPool(FramePool& pool, void (*reset)(int), int arg, unsigned long minFrames) {
+    BenchResult r = {};
+    unsigned long batches = (minFrames + pool.size() - 1) / pool.size();
+    if (batches == 0) batches = 1;
+
+    // Throughput: one clock read per batch
+    unsigned long long elapsed = 0;
+    unsigned long allocs = 0;
+    for (unsigned long b = 0; b < batches; b++) {
+        reset(arg);
+        unsigned long a0 = g_allocs;
+        unsigned long long t0 = nowNs();
+        for (size_t i = 0; i < pool.size(); i++) {
+            processFrame(pool[i].data.data(), pool[i].data.size(), pool[i].rssi, NULL);
+        }
+        elapsed += nowNs() - t0;
+        allocs += g_allocs - a0;
+    }
+    r.frames = batches * pool.size();
+    r.fps = elapsed ? r.frames * 1e9 / elapsed : 0;
+    r.allocs_per_frame = (double)allocs / r.frames;
+
+    // Latency: a clock read around every frame, so these include timer cost
+    std::vector<unsigned long long> samples;
+    samples.reserve(r.frames);
+    for (unsigned long b = 0; b < batches; b++) {
+        reset(arg);
+        for (size_t i = 0; i < pool.size(); i++) {
+            unsigned long long t0 = nowNs();
+            processFrame(pool[i].data.data(), pool[i].data.size(), pool[i].rssi, NULL);
+            samples.push_back(nowNs() - t0);
+        }
+    }
+    std::sort(samples.begin(), samples.end());
+    r.p50_ns = samples[samples.size() / 2];
+    r.p99_ns = samples[samples.size() * 99 / 100];
+    return r;
+}
+
+static void printHeader() {
+    printf("%-16s %7s %9s %12s %11s %8s %8s\n",
+           "path", "clients", "frames", "frames/s", "allocs/frm", "p50 ns", "p99 ns");
+}
+
+static void printResult(const char* name, int clientCount, const BenchResult& r) {
+    printf("%-16.16s %7d %9lu %12.0f %11.3f %8llu %8llu\n",
+           name, clientCount, r.frames, r.fps, r.allocs_per_frame, r.p50_ns, r.p99_ns);
+}
+
+static void resetClients(int count) {
+    if (count > 0) populateClients(count);
+    else clearClients();
+}
+
+static bool benchPcap(const char* path, unsigned long minFrames) {
+    static PcapReader reader;
+    if (!pcapOpen(&reader, path)) {
+        fprintf(stderr, "%s: not a raw 802.11 or radiotap pcap\n", path);
+        return false;
+    }
+
+    // Beacons and probe responses seed the networks, as in gattrose_replay;
+    // the capture filter never hands them to the parser on the device
+    surveyInit(&survey);
+    netTablesInit();
+    clearNetworks();
+    FramePool pool;
+    PcapPacket pkt;
+    while (pcapNext(&reader, &pkt) > 0) {
+        if (surveyFrame(&survey, pkt.frame, pkt.len, pkt.rssi, pkt.channel, 0, NULL) != SV_IGNORED) continue;
+        poolAdd(pool, pkt.frame, pkt.len, pkt.rssi);
+    }
+    pcapClose(&reader);
+
+    if (pool.empty()) {
+        fprintf(stderr, "%s: no frames to replay\n", path);
+        return false;
+    }
+
+    const char* name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+    BenchResult r = runPool(pool, resetClients, 0, minFrames);
+    printResult(name, activeClientCount(), r);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    unsigned long minFrames = 200000;
+    int firstFile = 1;
+    for (; firstFile < argc && argv[firstFile][0] == '-'; firstFile++) {
+        if (strcmp(argv[firstFile], "--frames") == 0 && firstFile + 1 < argc) {
+            minFrames = strtoul(argv[++firstFile], NULL, 10);
+        } else {
+            fprintf(stderr, "usage: %s [--frames N] [file.pcap ...]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    static const struct { const char* name; BenchPath path; } paths[] = {
+        {"data", PATH_DATA},
+        {"mgmt", PATH_MGMT},
+        {"probe", PATH_PROBE},
+    };
+    static const int occupancy[] = {10, 100, 1000};
+
+    printHeader();
+    FramePool pool;
+    for (size_t p = 0; p < sizeof(paths) / sizeof(paths[0]); p++) {
+        for (size_t o = 0; o < sizeof(occupancy) / sizeof(occupancy[0]); o++) {
+            seedNetworks();
+            buildSyntheticPool(pool, paths[p].path, occupancy[o]);
+            BenchResult r = runPool(pool, resetClients, occupancy[o], minFrames);
+            printResult(paths[p].name, occupancy[o], r);
+        }
+    }
+
+    int rc = 0;
+    for (int f = firstFile; f < argc; f++) {
+        if (!benchPcap(argv[f], minFrames)) rc = 1;
+    }
+    return rc;
+}
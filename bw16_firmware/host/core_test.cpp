@@ -0,0 +1,1278 @@
+// Host tests for the firmware's portable core. Plain asserts, no framework;
+// exits non-zero on the first failing check.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "frame_builder.h"
+#include "pcap_reader.h"
+#include "platform_host.h"
+#include "net_tables.h"
+#include "frame_parser.h"
+#include "rogue_detect.h"
+#include "deauth_detect.h"
+#include "baseline_store.h"
+#include "probe_stats.h"
+#include "net_survey.h"
+#include "ie_parser.h"
+#include "cmd_queue.h"
+#include "proto.h"
+#include "delta_log.h"
+#include "mac_index.h"
+#include "tx_ring.h"
+#include "capture_ring.h"
+#include "channel_sched.h"
+#include "frame_stats.h"
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+        exit(1); \
+    } \
+} while (0)
+
+static const uint8_t AP1[6] = {0x02, 0xAA, 0x00, 0x00, 0x00, 0x01};
+static const uint8_t AP2[6] = {0x02, 0xAA, 0x00, 0x00, 0x00, 0x02};
+
+static void reset() {
+    netTablesInit();
+    clearNetworks();
+    clearClients();
+    hostResetEvents();
+    pmkidList.clear();
+    handshakeList.clear();
+    pmkidCaptureActive = false;
+    handshakeCaptureActive = false;
+}
+
+static NetSurvey survey;
+
+static void seedTwoNetworks() {
+    uint8_t buf[256];
+    surveyInit(&survey);
+    CHECK(surveyFrame(&survey, buf, fbBeacon(buf, AP1, "alpha", 6), -40, 6, 0, NULL) == SV_ADDED);
+    CHECK(surveyFrame(&survey, buf, fbBeacon(buf, AP2, "beta", 36), -60, 36, 0, NULL) == SV_ADDED);
+    CHECK(activeNetworkCount() == 2);
+}
+
+// Every AP's list must match its client_count and link both ways
+static void checkClientLists() {
+    int linked = 0;
+    for (size_t n = 0; n < networks.size(); n++) {
+        if (networks[n].vacant) continue;
+        int count = 0, prev = -1;
+        for (int c = networks[n].first_client; c >= 0; c = clients[c].next_in_ap) {
+            CHECK(!clients[c].vacant);
+            CHECK(clients[c].ap_index == (int)n);
+            CHECK(clients[c].prev_in_ap == prev);
+            prev = c;
+            count++;
+        }
+        CHECK(count == networks[n].client_count);
+        linked += count;
+    }
+    int attached = 0;
+    for (size_t i = 0; i < clients.size(); i++) {
+        if (isActiveClient(i) && clients[i].ap_index >= 0) attached++;
+    }
+    CHECK(linked == attached);
+}
+
+static void testDataFramesAddClients() {
+    reset();
+    seedTwoNetworks();
+    uint8_t buf[256], sta[6];
+    fbMac(sta, 0x10, 1);
+
+    processFrame(buf, fbData(buf, sta, AP1, true, 40), -55, NULL);
+    CHECK(clients.size() == 1);
+    CHECK(clients[0].ap_index == findNetwork(macToKey(AP1)));
+    CHECK(networks[clients[0].ap_index].client_count == 1);
+    CHECK(hostEvents.clients_added == 1);
+
+    // Same client again, other direction: updated, not duplicated
+    processFrame(buf, fbData(buf, sta, AP1, false, 40), -50, NULL);
+    CHECK(clients.size() == 1);
+    CHECK(clients[0].rssi == -50);
+
+    // Unknown BSSID is counted and ignored
+    uint8_t other[6];
+    fbMac(other, 0x20, 9);
+    unsigned long unmatched = unmatchedBssidCount;
+    processFrame(buf, fbData(buf, sta, other, true, 40), -50, NULL);
+    CHECK(unmatchedBssidCount == unmatched + 1);
+    CHECK(clients.size() == 1);
+}
+
+static void testProbeAndAssoc() {
+    reset();
+    seedTwoNetworks();
+    uint8_t buf[256], sta1[6], sta2[6];
+    fbMac(sta1, 0x10, 1);
+    fbMac(sta2, 0x10, 2);
+
+    processFrame(buf, fbProbeReq(buf, sta1, "beta"), -70, NULL);
+    CHECK(hostEvents.probe_ssids == 1);
+    CHECK(clients.size() == 1);
+    CHECK(clients[0].ap_index == findNetwork(macToKey(AP2)));
+
+    processFrame(buf, fbAssocReq(buf, sta2, AP1), -70, NULL);
+    CHECK(clients.size() == 2);
+    CHECK(clients[1].ap_index == findNetwork(macToKey(AP1)));
+
+    // Known clients and wildcard probes are still reported
+    processFrame(buf, fbProbeReq(buf, sta1, "gamma"), -70, NULL);
+    processFrame(buf, fbProbeReq(buf, sta2, ""), -70, NULL);
+    CHECK(hostEvents.probe_ssids == 3);
+    CHECK(clients.size() == 2);
+}
+
+static void testRetireAndSortKeepLinks() {
+    reset();
+    seedTwoNetworks();
+    uint8_t buf[256], sta[6];
+    for (int i = 0; i < 5; i++) {
+        fbMac(sta, 0x10, i);
+        processFrame(buf, fbData(buf, sta, AP2, true, 10), -50, NULL);
+    }
+
+    // AP2 has clients and so sorts first; back-references must follow
+    sortNetworks();
+    int ap2 = findNetwork(macToKey(AP2));
+    CHECK(ap2 == 0);
+    for (size_t i = 0; i < clients.size(); i++) CHECK(clients[i].ap_index == ap2);
+
+    retireNetwork(ap2);
+    CHECK(activeNetworkCount() == 1);
+    CHECK(findNetwork(macToKey(AP2)) < 0);
+    for (size_t i = 0; i < clients.size(); i++) CHECK(clients[i].ap_index == -1);
+    checkClientLists();
+
+    // A sort moves the retired slot last and keeps it out of lookups, so
+    // the AP is added afresh when heard again
+    sortNetworks();
+    CHECK(networks[1].vacant && findNetwork(macToKey(AP2)) < 0);
+    CHECK(findNetwork(macToKey(AP1)) == 0);
+    uint8_t beacon[256];
+    CHECK(surveyFrame(&survey, beacon, fbBeacon(beacon, AP2, "beta", 36), -60, 36, 0, NULL) == SV_ADDED);
+    CHECK(activeNetworkCount() == 2);
+}
+
+static void addTestClient(uint32_t id, const uint8_t* ap, unsigned long now) {
+    WiFiClient_t cli = {};
+    fbMac(cli.mac, 0x10, id);
+    cli.key = macToKey(cli.mac);
+    cli.ap_index = ap ? findNetwork(macToKey(ap)) : -1;
+    cli.last_seen = now;
+    CHECK(addClient(cli) >= 0);
+}
+
+static void testClientLruEviction() {
+    reset();
+    seedTwoNetworks();
+    memset(&clientStats, 0, sizeof(clientStats));
+    for (int i = 0; i < MAX_CLIENTS; i++) addTestClient(i, (i & 1) ? AP2 : AP1, i);
+    CHECK(activeClientCount() == MAX_CLIENTS);
+    checkClientLists();
+
+    // Client 0 is seen again, so client 1 is now the least recent
+    uint8_t mac[6];
+    fbMac(mac, 0x10, 0);
+    touchClient(findClient(macToKey(mac)), MAX_CLIENTS);
+    fbMac(mac, 0x10, 1);
+    int oldSlot = findClient(macToKey(mac));
+
+    addTestClient(5000, AP1, MAX_CLIENTS + 1);
+    CHECK(activeClientCount() == MAX_CLIENTS);
+    CHECK(clientStats.evicted_lru == 1);
+    CHECK(findClient(macToKey(mac)) < 0);
+    fbMac(mac, 0x10, 0);
+    CHECK(findClient(macToKey(mac)) >= 0);
+    fbMac(mac, 0x10, 5000);
+    CHECK(findClient(macToKey(mac)) == oldSlot);
+    CHECK(clients.size() == MAX_CLIENTS);
+    checkClientLists();
+
+    // Frames from new MACs keep getting in once the table is full
+    uint8_t buf[256];
+    fbMac(mac, 0x10, 6000);
+    processFrame(buf, fbData(buf, mac, AP2, true, 20), -50, NULL);
+    CHECK(findClient(macToKey(mac)) >= 0);
+    CHECK(clientStats.evicted_lru == 2);
+    checkClientLists();
+}
+
+static void testClientTtl() {
+    reset();
+    seedTwoNetworks();
+    memset(&clientStats, 0, sizeof(clientStats));
+    clientTtlMs = 60000;
+    for (int i = 0; i < 6; i++) addTestClient(i, (i & 1) ? AP1 : NULL, 0);
+
+    // A frame from client 3 at t=50s keeps it alive
+    uint8_t buf[256], mac[6];
+    fbMac(mac, 0x10, 3);
+    hostSetMillis(50000);
+    processFrame(buf, fbData(buf, mac, AP1, true, 20), -50, NULL);
+
+    CHECK(ageClients(59000) == 0);
+    CHECK(ageClients(70000) == 5);
+    CHECK(activeClientCount() == 1);
+    CHECK(clientStats.evicted_ttl == 5);
+    CHECK(findClient(macToKey(mac)) >= 0);
+    CHECK(networks[findNetwork(macToKey(AP1))].client_count == 1);
+    checkClientLists();
+
+    // Vacated slots are reused before the table grows
+    size_t slots = clients.size();
+    addTestClient(100, AP2, 70000);
+    CHECK(clients.size() == slots);
+    checkClientLists();
+
+    clientTtlMs = 0;
+    CHECK(ageClients(10000000) == 0);
+    clientTtlMs = CLIENT_TTL_DEFAULT_MS;
+    hostSetMillis(0);
+}
+
+static void testPmkidAndTruncation() {
+    reset();
+    seedTwoNetworks();
+    pmkidCaptureActive = true;
+    uint8_t buf[256], sta[6], pmkid[16];
+    fbMac(sta, 0x10, 7);
+    for (int i = 0; i < 16; i++) pmkid[i] = 0xC0 + i;
+
+    int len = fbEapolM1(buf, sta, AP1, pmkid);
+    processFrame(buf, len, -40, NULL);
+    CHECK(pmkidList.size() == 1);
+    CHECK(memcmp(pmkidList[0].pmkid, pmkid, 16) == 0);
+    CHECK(strcmp(pmkidList[0].ssid, "alpha") == 0);
+    CHECK(hostEvents.pmkids == 1);
+
+    // Every truncation of the frame must be handled without reading past len
+    pmkidList.clear();
+    for (int cut = 0; cut < len; cut++) processFrame(buf, cut, -40, NULL);
+    CHECK(pmkidList.empty());
+}
+
+static void testRogueDetector() {
+    static RogueDetector rd;
+    rogueInit(&rd);
+    CHECK(rogueAddBaseline(&rd, AP1, "alpha", 6));
+    CHECK(rogueAddBaseline(&rd, AP2, "beta", 36));
+    hostResetEvents();
+    uint8_t buf[256], ap3[6], ap4[6];
+    fbMac(ap3, 0x02, 3);
+    fbMac(ap4, 0x02, 4);
+
+    // Nothing is checked until monitoring is on
+    rogueCheckFrame(&rd, buf, fbBeacon(buf, ap3, "alpha", 6), 6, 1000);
+    CHECK(rd.frames_checked == 0);
+    rd.active = true;
+
+    // First sight of a baseline AP only learns its fingerprint
+    int len = fbBeacon(buf, AP1, "alpha", 6);
+    rogueCheckFrame(&rd, buf, len, 6, 1000);
+    CHECK(hostEvents.rogue_alerts == 0);
+
+    rogueCheckFrame(&rd, buf, fbBeacon(buf, ap3, "alpha", 6), 6, 1000);
+    CHECK(rd.alerts[RA_EVIL_TWIN] == 1);
+    rogueCheckFrame(&rd, buf, fbBeacon(buf, ap4, "gamma", 1), 1, 1000);
+    CHECK(rd.alerts[RA_NEW_AP] == 1);
+
+    // Same AP and type again is held off
+    rogueCheckFrame(&rd, buf, fbBeacon(buf, ap3, "alpha", 6), 6, 2000);
+    CHECK(rd.alerts[RA_EVIL_TWIN] == 1);
+    CHECK(rd.suppressed == 1);
+
+    // Downgrade: privacy bit dropped
+    len = fbBeacon(buf, AP1, "alpha", 6);
+    buf[34] = 0x01;
+    rogueCheckFrame(&rd, buf, len, 6, 3000);
+    CHECK(rd.alerts[RA_SECURITY_CHANGED] == 1);
+    CHECK(rd.alerts[RA_SSID_CHANGED] == 0);
+
+    // The DS parameter set wins over the radio channel
+    rogueCheckFrame(&rd, buf, fbBeacon(buf, AP2, "beta", 36), 40, 3000);
+    CHECK(rd.alerts[RA_CHANNEL_CHANGED] == 0);
+    rogueCheckFrame(&rd, buf, fbBeacon(buf, AP2, "beta", 44), 36, 3000);
+    CHECK(rd.alerts[RA_CHANNEL_CHANGED] == 1);
+    CHECK(rd.alerts[RA_INTERVAL_CHANGED] == 0);
+
+    // Two transmitters on AP2's BSSID interleave their sequence numbers
+    static const uint16_t seqs[] = {100, 2000, 101, 2001, 102, 2002, 103};
+    for (size_t i = 0; i < sizeof(seqs) / sizeof(seqs[0]); i++) {
+        len = fbBeacon(buf, AP2, "beta", 36);
+        fbSetSeq(buf, seqs[i]);
+        rogueCheckFrame(&rd, buf, len, 36, 20000 + i * 100);
+    }
+    CHECK(rd.alerts[RA_SEQ_ANOMALY] == 1);
+
+    // A steady sequence from one transmitter, including wrap, is fine
+    static RogueDetector quiet;
+    rogueInit(&quiet);
+    CHECK(rogueAddBaseline(&quiet, AP2, "beta", 36));
+    quiet.active = true;
+    for (int i = 0; i < 20; i++) {
+        len = fbBeacon(buf, AP2, "beta", 36);
+        fbSetSeq(buf, (4090 + i) & 0x0FFF);
+        rogueCheckFrame(&quiet, buf, len, 36, 10000 + i * 100);
+    }
+    CHECK(quiet.alerts[RA_SEQ_ANOMALY] == 0);
+
+    // A burst of new APs is cut off by the token bucket
+    rogueInit(&quiet);
+    quiet.active = true;
+    uint8_t mac[6];
+    for (int i = 0; i < 3 * RD_ALERT_BURST; i++) {
+        fbMac(mac, 0x06, i);
+        rogueCheckFrame(&quiet, buf, fbBeacon(buf, mac, "spam", 1), 1, 50000);
+    }
+    CHECK(quiet.alerts[RA_NEW_AP] == RD_ALERT_BURST);
+    CHECK(quiet.suppressed == 2 * RD_ALERT_BURST);
+
+    // Unknown APs report once per session, however many there are; the ones
+    // the bucket cut off report once it refills
+    const int many = 2 * RD_RECENT_ALERTS;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < many; i++) {
+            fbMac(mac, 0x06, i);
+            rogueCheckFrame(&quiet, buf, fbBeacon(buf, mac, "spam", 1), 1, 60000 + pass * 100000 + i * 1000);
+        }
+    }
+    CHECK(quiet.alerts[RA_NEW_AP] == many);
+
+    // A new session reports them again
+    rogueStartMonitoring(&quiet);
+    fbMac(mac, 0x06, 0);
+    rogueCheckFrame(&quiet, buf, fbBeacon(buf, mac, "spam", 1), 1, 300000);
+    CHECK(quiet.alerts[RA_NEW_AP] == many + 1);
+
+    // The reported set starts over once full
+    for (int i = 1; i <= RD_MAX_ALERTED; i++) {
+        fbMac(mac, 0x07, i);
+        rogueCheckFrame(&quiet, buf, fbBeacon(buf, mac, "spam", 1), 1, 400000 + i * 1000);
+    }
+    CHECK(quiet.alerted_resets == 1);
+    CHECK(quiet.alerted_index.count == 1);
+
+    // Every truncation must be handled without reading past len
+    len = fbBeacon(buf, ap4, "gamma", 1);
+    for (int cut = 0; cut < len; cut++) rogueCheckFrame(&rd, buf, cut, 1, 90000);
+}
+
+static void testDeauthFlood() {
+    reset();
+    seedTwoNetworks();
+    static DeauthDetector dd;
+    deauthInit(&dd);
+    dd.active = true;
+    static const uint8_t bcast[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    uint8_t buf[256];
+
+    // Ordinary roaming noise stays below the threshold
+    for (int i = 0; i < 5; i++) {
+        int len = fbDeauth(buf, AP1, bcast, AP1, 7);
+        fbSetSeq(buf, 10 + i);
+        deauthCheckFrame(&dd, buf, len, -40, 6, 1000 + i * 100);
+    }
+    CHECK(hostEvents.deauth_alerts == 0);
+    CHECK(dd.deauth == 5 && dd.broadcast == 5);
+
+    // A steady storm from one radio: flood on the BSSID and its source, not spoofed
+    for (int i = 0; i < DD_FLOOD_DEFAULT; i++) {
+        int len = fbDeauth(buf, AP1, bcast, AP1, 7, i & 1);
+        fbSetSeq(buf, 100 + i);
+        deauthCheckFrame(&dd, buf, len, -40, 6, 2000 + i * 10);
+    }
+    CHECK(dd.alerts[DA_FLOOD] == 1);
+    CHECK(dd.alerts[DA_SRC_FLOOD] == 1);
+    CHECK(dd.alerts[DA_SPOOFED] == 0);
+    CHECK(dd.disassoc == DD_FLOOD_DEFAULT / 2);
+    CHECK(dd.bssids.size() == 1 && dd.sources.size() == 1);
+
+    // The window slides: counts drop out after DD_BUCKETS seconds
+    CHECK(deauthWindowCount(&dd.bssids[0], 2500) == 5 + DD_FLOOD_DEFAULT);
+    CHECK(deauthWindowCount(&dd.bssids[0], 11500) == DD_FLOOD_DEFAULT);
+    CHECK(deauthWindowCount(&dd.bssids[0], 13000) == 0);
+    deauthTick(&dd, 5000);
+    CHECK(dd.alerts[DA_FLOOD_END] == 0);
+    deauthTick(&dd, 13000);
+    CHECK(dd.alerts[DA_FLOOD_END] == 2);
+    CHECK(!dd.bssids[0].flooding && !dd.sources[0].flooding);
+
+    // AP2 forged from two places: signal jumps and a repeating sequence number
+    for (int i = 0; i < 8; i++) {
+        uint8_t sta[6];
+        fbMac(sta, 0x10, i);
+        deauthCheckFrame(&dd, buf, fbDeauth(buf, AP2, sta, AP2, 3), (i & 1) ? -85 : -35, 36,
+                         20000 + i * 50);
+    }
+    CHECK(dd.alerts[DA_SPOOFED] == 1);
+    CHECK(dd.alerts[DA_FLOOD] == 1);
+
+    // Cleartext deauths for a PMF network with a reserved reason code
+    networks[findNetwork(macToKey(AP1))].has_pmf = true;
+    uint32_t before = dd.spoof_indicators;
+    deauthCheckFrame(&dd, buf, fbDeauth(buf, AP1, bcast, AP1, 0), -40, 6, 30000);
+    CHECK(dd.spoof_indicators == before + 2);
+    int len = fbDeauth(buf, AP1, bcast, AP1, 0);
+    buf[1] = 0x40;                  // Protected: neither applies
+    deauthCheckFrame(&dd, buf, len, -40, 6, 32000);
+    CHECK(dd.spoof_indicators == before + 2);
+
+    // Random sources fill the table and the oldest are replaced
+    for (int i = 0; i < 2 * DD_MAX_TRACKED; i++) {
+        uint8_t src[6];
+        fbMac(src, 0x06, i);
+        deauthCheckFrame(&dd, buf, fbDeauth(buf, src, bcast, AP1, 7), -50, 6, 40000 + i);
+    }
+    CHECK(dd.sources.size() == DD_MAX_TRACKED);
+    CHECK(dd.evicted == DD_MAX_TRACKED + 2);
+    CHECK(dd.alerts[DA_FLOOD] == 2);
+
+    // Every truncation must be handled without reading past len
+    len = fbDeauth(buf, AP2, bcast, AP2, 7);
+    for (int cut = 0; cut < len; cut++) deauthCheckFrame(&dd, buf, cut, -40, 36, 50000);
+}
+
+static void testBaselineStore() {
+    hostEraseStore();
+    static BaselineStore bs;
+    static RogueDetector rd, loaded;
+    baselineStoreInit(&bs);
+    rogueInit(&rd);
+    rogueInit(&loaded);
+    CHECK(!baselineLoad(&bs, &loaded));
+
+    // Baseline with one learned fingerprint, saved while monitoring
+    uint8_t buf[256], ap3[6];
+    fbMac(ap3, 0x02, 3);
+    CHECK(rogueAddBaseline(&rd, AP1, "alpha", 6));
+    CHECK(rogueAddBaseline(&rd, AP2, "", 36));
+    rd.active = true;
+    rogueCheckFrame(&rd, buf, fbBeacon(buf, AP1, "alpha", 6), 6, 1000);
+    CHECK(baselineSave(&bs, &rd) == BS_SAVED);
+    CHECK(bs.slot == 0 && bs.generation == 1);
+    CHECK(hostStoreErases == 1);
+
+    // Nothing changed, nothing written
+    CHECK(baselineSave(&bs, &rd) == BS_UNCHANGED);
+    CHECK(hostStoreErases == 1);
+
+    // A reboot restores the baseline, fingerprints and monitoring state
+    static BaselineStore boot;
+    baselineStoreInit(&boot);
+    CHECK(baselineLoad(&boot, &loaded));
+    CHECK(boot.slot == 0 && boot.generation == 1);
+    CHECK(loaded.active);
+    CHECK(loaded.baseline.size() == 2);
+    CHECK(strcmp(loaded.baseline[0].ssid, "alpha") == 0 && loaded.baseline[0].channel == 6);
+    CHECK(loaded.baseline[0].fp_known && loaded.baseline[0].capability == 0x11);
+    CHECK(loaded.baseline[0].beacon_interval == 100);
+    CHECK(!loaded.baseline[1].fp_known && loaded.baseline[1].ssid[0] == 0);
+    CHECK(baselineSave(&boot, &loaded) == BS_UNCHANGED);
+    hostResetEvents();
+    rogueCheckFrame(&loaded, buf, fbBeacon(buf, ap3, "alpha", 6), 6, 2000);
+    CHECK(loaded.alerts[RA_EVIL_TWIN] == 1);
+
+    // The next save goes to the other slot
+    CHECK(rogueAddBaseline(&rd, ap3, "gamma", 11));
+    CHECK(baselineSave(&bs, &rd) == BS_SAVED);
+    CHECK(bs.slot == 1 && bs.generation == 2);
+    baselineStoreInit(&boot);
+    CHECK(baselineLoad(&boot, &loaded) && loaded.baseline.size() == 3);
+
+    // A damaged newest record falls back to the previous one
+    hostStore[1][BS_HEADER_LEN + 3] ^= 0x40;
+    baselineStoreInit(&boot);
+    CHECK(baselineLoad(&boot, &loaded));
+    CHECK(boot.slot == 0 && loaded.baseline.size() == 2);
+    hostStore[1][BS_HEADER_LEN + 3] ^= 0x40;
+
+    // So does one whose header never made it to flash
+    CHECK(rogueAddBaseline(&rd, AP1, "alpha", 1));
+    CHECK(baselineSave(&bs, &rd) == BS_SAVED);
+    CHECK(bs.slot == 0 && bs.generation == 3);
+    memset(hostStore[0], 0xFF, BS_HEADER_LEN);
+    baselineStoreInit(&boot);
+    CHECK(baselineLoad(&boot, &loaded));
+    CHECK(boot.slot == 1 && boot.generation == 2);
+    CHECK(loaded.baseline.size() == 3 && loaded.baseline[0].channel == 6);
+
+    // The active flag alone is a change
+    rd.active = false;
+    CHECK(baselineSave(&bs, &rd) == BS_SAVED);
+    baselineStoreInit(&boot);
+    CHECK(baselineLoad(&boot, &loaded) && !loaded.active);
+
+    CHECK(baselineErase(&bs));
+    baselineStoreInit(&boot);
+    CHECK(!baselineLoad(&boot, &loaded));
+    CHECK(loaded.baseline.size() == 0);
+}
+
+static void testProbeStats() {
+    static ProbeStats ps;
+    probeStatsClear(&ps, 0);
+    uint8_t sta[6];
+
+    // Each (device, SSID) pair is new exactly once
+    fbMac(sta, 0x10, 1);
+    CHECK(probeStatsRecord(&ps, sta, "home", 1000));
+    CHECK(!probeStatsRecord(&ps, sta, "home", 2000));
+    CHECK(probeStatsRecord(&ps, sta, "work", 3000));
+    CHECK(!probeStatsRecord(&ps, sta, "", 4000));
+    CHECK(ps.probes == 4 && ps.directed == 3 && ps.pairs == 2);
+    CHECK(probeStatsDevices(&ps) == 1 && probeStatsSsids(&ps) == 2);
+
+    // Skewed crowd: SSID k is probed by 400 / (k + 1) devices, some
+    // devices probe twice. Estimates stay close, the top list is ordered.
+    probeStatsClear(&ps, 0);
+    char ssid[16];
+    uint32_t device = 0;
+    for (int k = 0; k < 40; k++) {
+        snprintf(ssid, sizeof(ssid), "net%02d", k);
+        for (int d = 0; d < 400 / (k + 1); d++) {
+            fbMac(sta, 0x20, device++);
+            probeStatsRecord(&ps, sta, ssid, 1000);
+            if (d % 4 == 0) probeStatsRecord(&ps, sta, ssid, 2000);
+        }
+    }
+    uint32_t devices = probeStatsDevices(&ps);
+    CHECK(devices > device * 85 / 100 && devices < device * 115 / 100);
+    uint32_t ssids = probeStatsSsids(&ps);
+    CHECK(ssids >= 36 && ssids <= 44);
+    CHECK(ps.pairs >= device * 99 / 100 && ps.pairs <= device);
+
+    ProbeTopEntry top[PS_TOP_K];
+    CHECK(probeStatsTop(&ps, top, PS_TOP_K) == PS_TOP_K);
+    CHECK(strcmp(top[0].ssid, "net00") == 0 && top[0].devices >= 400);
+    CHECK(strcmp(top[1].ssid, "net01") == 0 && top[1].devices >= 200);
+    for (int i = 1; i < PS_TOP_K; i++) CHECK(top[i].devices <= top[i - 1].devices);
+
+    // Windows: two busy ones with a quiet one between, then out of range
+    probeStatsClear(&ps, 0);
+    for (uint32_t i = 0; i < 50; i++) {
+        fbMac(sta, 0x30, i % 10);
+        probeStatsRecord(&ps, sta, "", 1000 + i);
+    }
+    for (uint32_t i = 0; i < 20; i++) {
+        fbMac(sta, 0x30, i);
+        probeStatsRecord(&ps, sta, "", 2 * PS_WINDOW_MS + i);
+    }
+    uint32_t probes;
+    unsigned long now = 2 * PS_WINDOW_MS + 100;
+    CHECK(probeStatsWindow(&ps, 0, now, &probes, &devices) && probes == 20);
+    CHECK(devices >= 17 && devices <= 23);
+    CHECK(probeStatsWindow(&ps, 1, now, &probes, &devices) && probes == 0 && devices == 0);
+    CHECK(probeStatsWindow(&ps, 2, now, &probes, &devices) && probes == 50);
+    CHECK(devices >= 9 && devices <= 11);
+    CHECK(!probeStatsWindow(&ps, 3, now, &probes, &devices));
+    CHECK(ps.directed == 0 && ps.pairs == 0);
+
+    // A window's slot is reused a full ring later
+    now = (2 + PS_WINDOWS) * PS_WINDOW_MS;
+    fbMac(sta, 0x30, 99);
+    probeStatsRecord(&ps, sta, "", now);
+    CHECK(probeStatsWindow(&ps, 0, now, &probes, &devices) && probes == 1);
+    CHECK(probeStatsWindow(&ps, PS_WINDOWS - 1, now, &probes, &devices) && probes == 0);
+
+    // The Bloom filter resets rather than saturating
+    probeStatsClear(&ps, 0);
+    for (uint32_t i = 0; i < 12000; i++) {
+        fbMac(sta, 0x40, i);
+        probeStatsRecord(&ps, sta, "flood", 1000);
+    }
+    CHECK(ps.bloom_resets >= 1);
+    CHECK(probeStatsBloomFill(&ps) < PS_BLOOM_MAX_FILL);
+}
+
+static void testIeParser() {
+    uint8_t buf[256];
+    IeIter it;
+    IeElement ie;
+
+    // Extension elements drop the extension id; a short tail is flagged
+    static const uint8_t heCap[20] = {IE_EXT_HE_CAP};
+    int len = fbIe(buf, IE_SSID, "x", 1);
+    len += fbIe(buf + len, IE_EXTENSION, heCap, sizeof(heCap));
+    ieIterInit(&it, buf, len + 3);
+    buf[len] = IE_DS_PARAMS;
+    buf[len + 1] = 5;
+    CHECK(ieNext(&it, &ie) && ie.id == IE_SSID && ie.len == 1 && ie.data[0] == 'x');
+    CHECK(ieNext(&it, &ie) && ie.id == IE_EXTENSION && ie.ext_id == IE_EXT_HE_CAP && ie.len == 19);
+    CHECK(!ieNext(&it, &ie) && it.truncated);
+    CHECK(!ieFind(buf, len + 3, IE_DS_PARAMS, &ie));
+    CHECK(ieMgmtOffset(0x08) == 36 && ieMgmtOffset(0x04) == 24 && ieMgmtOffset(0x0B) == -1);
+
+    // RSN with PSK + FT-PSK, CCMP + TKIP, MFP capable; then one cut after
+    // the group cipher, which takes the standard's defaults
+    static const uint8_t rsn[] = {1, 0, 0x00, 0x0F, 0xAC, 2,
+                                  2, 0, 0x00, 0x0F, 0xAC, 4, 0x00, 0x0F, 0xAC, 2,
+                                  2, 0, 0x00, 0x0F, 0xAC, 2, 0x00, 0x0F, 0xAC, 4, 0x80, 0x00};
+    IeRsn r;
+    fbIe(buf, IE_RSN, rsn, sizeof(rsn));
+    CHECK(ieFind(buf, 2 + sizeof(rsn), IE_RSN, &ie) && ieParseRsn(&ie, &r));
+    CHECK(r.group_cipher == IE_CIPHER_TKIP);
+    CHECK(r.pairwise == (IE_BIT(IE_CIPHER_CCMP) | IE_BIT(IE_CIPHER_TKIP)));
+    CHECK(r.akms == (IE_BIT(IE_AKM_PSK) | IE_BIT(IE_AKM_FT_PSK)));
+    CHECK(r.mfp_capable && !r.mfp_required);
+    fbIe(buf, IE_RSN, rsn, 6);
+    CHECK(ieFind(buf, 8, IE_RSN, &ie) && ieParseRsn(&ie, &r));
+    CHECK(r.pairwise == IE_BIT(IE_CIPHER_CCMP) && r.akms == IE_BIT(IE_AKM_8021X));
+
+    // WPA vendor element, 802.1X: WPA-EAP
+    static const uint8_t wpa[] = {0x00, 0x50, 0xF2, 0x01, 1, 0, 0x00, 0x50, 0xF2, 2,
+                                  1, 0, 0x00, 0x50, 0xF2, 2, 1, 0, 0x00, 0x50, 0xF2, 1};
+    IeBeacon b;
+    ieParseBeacon(buf, fbIe(buf, IE_VENDOR, wpa, sizeof(wpa)), &b);
+    CHECK(b.has_wpa && !b.has_rsn && b.hidden);
+    CHECK(surveySecurity(0x11, &b) == (SV_SEC_WPA | SV_SEC_TKIP | SV_SEC_ENTERPRISE));
+    CHECK(strcmp(securityName(surveySecurity(0x11, &b)), "WPA-EAP") == 0);
+
+    // HT 2 streams on a 40 MHz channel, VHT 3 streams at 160, HE 4 streams
+    uint8_t htCap[26] = {0}, htOp[22] = {0}, vhtCap[12] = {0}, vhtOp[5] = {0}, he[21] = {0};
+    htCap[3] = htCap[4] = 0xFF;
+    htOp[0] = 36;
+    htOp[1] = 0x05;
+    vhtCap[4] = 0xEA;               // Streams 1-3 supported, 4 not
+    vhtCap[5] = 0xFF;
+    vhtOp[0] = 1;
+    vhtOp[1] = 42;
+    vhtOp[2] = 50;
+    he[0] = IE_EXT_HE_CAP;
+    he[18] = 0xAA;                  // Streams 1-4
+    he[19] = 0xFF;
+    len = fbIe(buf, IE_HT_CAP, htCap, sizeof(htCap));
+    len += fbIe(buf + len, IE_HT_OP, htOp, sizeof(htOp));
+    ieParseBeacon(buf, len, &b);
+    CHECK(b.phy.ht && !b.phy.vht && b.phy.streams == 2 && b.phy.width_mhz == 40);
+    CHECK(ieBeaconChannel(&b) == 36);
+    len += fbIe(buf + len, IE_VHT_CAP, vhtCap, sizeof(vhtCap));
+    len += fbIe(buf + len, IE_VHT_OP, vhtOp, sizeof(vhtOp));
+    ieParseBeacon(buf, len, &b);
+    CHECK(b.phy.vht && !b.phy.he && b.phy.streams == 3 && b.phy.width_mhz == 160);
+    len += fbIe(buf + len, IE_EXTENSION, he, sizeof(he));
+    ieParseBeacon(buf, len, &b);
+    CHECK(b.phy.he && b.phy.streams == 4 && !b.truncated);
+
+    // Names and PMF from bits, whether a beacon's or the SDK's
+    CHECK(strcmp(securityName(0), "Open") == 0);
+    CHECK(strcmp(securityName(0x10000000), "Open") == 0);      // WPS, open
+    CHECK(strcmp(securityName(SV_SEC_WEP), "WEP") == 0);
+    CHECK(strcmp(securityName(0x00400006), "WPA2") == 0);
+    CHECK(strcmp(securityName(0x00600000), "WPA/WPA2") == 0);
+    CHECK(strcmp(securityName(0x00C00004), "WPA2/WPA3") == 0);
+    CHECK(strcmp(securityName(SV_SEC_WPA2 | SV_SEC_AES | SV_SEC_ENTERPRISE), "WPA2-EAP") == 0);
+    CHECK(strcmp(securityName(SV_SEC_UNKNOWN), "Unknown") == 0);
+    CHECK(securityHasPmf(0x00800004) && !securityHasPmf(0x00C00004));
+    CHECK(securityHasPmf(0x00400014) && !securityHasPmf(SV_SEC_UNKNOWN));
+
+    // A probe request's SSID is found wherever it sits
+    reset();
+    uint8_t sta[6];
+    fbMac(sta, 0x10, 7);
+    static const uint8_t bcast[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    static const uint8_t rates[4] = {0x82, 0x84, 0x8B, 0x96};
+    len = fbHeader(buf, 0x40, 0x00, bcast, sta, bcast);
+    len += fbIe(buf + len, 1, rates, sizeof(rates));
+    len += fbIe(buf + len, IE_SSID, "late", 4);
+    processFrame(buf, len, -60, NULL);
+    CHECK(hostEvents.probe_ssids == 1);
+}
+
+static void testNetSurvey() {
+    reset();
+    surveyInit(&survey);
+    uint8_t buf[256];
+    int idx;
+
+    // WPA2-PSK/CCMP, then the same AP moving channel and losing signal
+    static const uint8_t rsnPsk[] = {1, 0, 0x00, 0x0F, 0xAC, 4, 1, 0, 0x00, 0x0F, 0xAC, 4,
+                                     1, 0, 0x00, 0x0F, 0xAC, 2, 0x00, 0x00};
+    int len = fbBeacon(buf, AP1, "alpha", 6);
+    len += fbIe(buf + len, 48, rsnPsk, sizeof(rsnPsk));
+    CHECK(surveyFrame(&survey, buf, len, -40, 6, 1000, &idx) == SV_ADDED);
+    CHECK(hostEvents.networks_added == 1);
+    CHECK(networks[idx].security == (SV_SEC_WPA2 | SV_SEC_AES) && !networks[idx].has_pmf);
+    CHECK(chanSched.slots[chanToSlot(6)].ap_count == 1);
+
+    len = fbBeacon(buf, AP1, "alpha", 11);
+    len += fbIe(buf + len, 48, rsnPsk, sizeof(rsnPsk));
+    CHECK(surveyFrame(&survey, buf, len, -70, 10, 2000, &idx) == SV_UPDATED);
+    CHECK(networks[idx].channel == 11 && networks[idx].rssi == -70 && networks[idx].last_seen == 2000);
+    CHECK(chanSched.slots[chanToSlot(6)].ap_count == 0);
+    CHECK(chanSched.slots[chanToSlot(11)].ap_count == 1);
+    CHECK(activeNetworkCount() == 1 && hostEvents.networks_added == 1);
+
+    // SAE with PMF required; PSK + SAE transition mode; WEP; open
+    static const uint8_t rsnSae[] = {1, 0, 0x00, 0x0F, 0xAC, 4, 1, 0, 0x00, 0x0F, 0xAC, 4,
+                                     1, 0, 0x00, 0x0F, 0xAC, 8, 0xC0, 0x00};
+    static const uint8_t rsnMixed[] = {1, 0, 0x00, 0x0F, 0xAC, 4, 1, 0, 0x00, 0x0F, 0xAC, 4,
+                                       2, 0, 0x00, 0x0F, 0xAC, 2, 0x00, 0x0F, 0xAC, 8, 0x80, 0x00};
+    IeBeacon b;
+    ieParseBeacon(buf, 0, &b);
+    CHECK(surveySecurity(0x11, &b) == SV_SEC_WEP);
+    CHECK(surveySecurity(0x01, &b) == 0);
+    ieParseBeacon(buf, fbIe(buf, 48, rsnSae, sizeof(rsnSae)), &b);
+    CHECK(surveySecurity(0x11, &b) == (SV_SEC_WPA3 | SV_SEC_AES | SV_SEC_CMAC));
+    ieParseBeacon(buf, fbIe(buf, 48, rsnMixed, sizeof(rsnMixed)), &b);
+    CHECK(surveySecurity(0x11, &b) == (SV_SEC_WPA2 | SV_SEC_WPA3 | SV_SEC_AES));
+
+    // Hidden in beacons, named by a probe response, still flagged hidden
+    len = fbBeacon(buf, AP2, "", 36);
+    CHECK(surveyFrame(&survey, buf, len, -60, 36, 3000, &idx) == SV_ADDED);
+    CHECK(networks[idx].hidden && networks[idx].is_5ghz && networks[idx].has_pmf == false);
+    len = fbBeacon(buf, AP2, "beta", 36);
+    buf[0] = 0x50;
+    CHECK(surveyFrame(&survey, buf, len, -60, 36, 3500, &idx) == SV_UPDATED);
+    CHECK(strcmp(networks[idx].ssid, "beta") == 0 && networks[idx].hidden);
+
+    // Every truncation is handled without reading past len
+    len = fbBeacon(buf, AP1, "alpha", 11);
+    len += fbIe(buf + len, 48, rsnMixed, sizeof(rsnMixed));
+    for (int cut = 0; cut < len; cut++) surveyFrame(&survey, buf, cut, -40, 11, 4000, NULL);
+    CHECK(activeNetworkCount() == 2);
+
+    // Not heard from for NETWORK_MAX_AGE_MS: retired, slot kept
+    CHECK(surveyAge(&survey, 3500 + NETWORK_MAX_AGE_MS) == 0);
+    CHECK(surveyAge(&survey, 4000 + NETWORK_MAX_AGE_MS + 1) == 2);
+    CHECK(activeNetworkCount() == 0 && survey.retired == 2);
+
+    // A full table is counted, not overwritten
+    clearNetworks();
+    uint8_t ap[6];
+    for (int i = 0; i <= MAX_NETWORKS; i++) {
+        fbMac(ap, 0x02, 0x1000 + i);
+        int rc = surveyFrame(&survey, buf, fbBeacon(buf, ap, "crowd", 1 + i % 11), -80, 1, 5000, NULL);
+        CHECK(rc == (i < MAX_NETWORKS ? SV_ADDED : SV_FULL));
+    }
+    CHECK(survey.full == 1);
+}
+
+static void testSurveySweep() {
+    static ChanSched sched;
+    chanSchedInit(&sched);
+    NetSurvey sv;
+    surveyInit(&sv);
+    uint32_t dwell = 0;
+
+    // No APs known: every channel in turn, back to back
+    bool seen[CHAN_SLOTS] = {false};
+    for (int i = 0; i < CHAN_SLOTS; i++) {
+        int ch = surveySweepNext(&sv, &sched, 1000, &dwell);
+        CHECK(ch > 0 && dwell == SV_SWEEP_DWELL_MS);
+        CHECK(!seen[chanToSlot(ch)]);
+        seen[chanToSlot(ch)] = true;
+    }
+
+    // With APs known, one discovery visit per interval, never to their channels
+    chanSchedAddAp(&sched, 6);
+    chanSchedAddAp(&sched, 36);
+    unsigned long now = 10000;
+    CHECK(surveySweepNext(&sv, &sched, now, &dwell) > 0);
+    CHECK(surveySweepNext(&sv, &sched, now + 500, &dwell) == 0);
+    for (int i = 0; i < 2 * CHAN_SLOTS; i++) {
+        now += SV_SWEEP_INTERVAL_MS;
+        int ch = surveySweepNext(&sv, &sched, now, &dwell);
+        CHECK(ch > 0 && ch != 6 && ch != 36);
+    }
+}
+
+// Home slot of a key, as mac_index.cpp computes it
+static uint16_t macHome(MacKey key, uint16_t capacity) {
+    return (uint16_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & (capacity - 1);
+}
+
+// Keys from start on whose home slot is home
+static int keysWithHome(MacKey* out, int n, uint16_t home, uint16_t capacity, MacKey start) {
+    int found = 0;
+    for (MacKey k = start; found < n; k++) {
+        if (macHome(k, capacity) == home) out[found++] = k;
+    }
+    return found;
+}
+
+static void testMacIndex() {
+    static MacIndexSlot slots[16];
+    MacIndex idx;
+    macIndexInit(&idx, slots, 16);
+
+    // A probe chain of three keys sharing slot 5, and a fourth whose home
+    // is slot 6, displaced by the chain
+    MacKey chain[3], next;
+    keysWithHome(chain, 3, 5, 16, 0x020000000001ULL);
+    keysWithHome(&next, 1, 6, 16, 0x020000000001ULL);
+    for (int i = 0; i < 3; i++) CHECK(macIndexInsert(&idx, chain[i], i));
+    CHECK(macIndexInsert(&idx, next, 3));
+    CHECK(idx.count == 4 && slots[5].value == 0 && slots[8].value == 3);
+    CHECK(macIndexFind(&idx, 0x02DEADBEEF00ULL) == MAC_INDEX_EMPTY);
+
+    // Overwriting keeps the count
+    CHECK(macIndexInsert(&idx, chain[1], 7) && idx.count == 4 && macIndexFind(&idx, chain[1]) == 7);
+
+    // Erasing the chain's head shifts the rest back, the displaced key too
+    CHECK(macIndexErase(&idx, chain[0]));
+    CHECK(!macIndexErase(&idx, chain[0]));
+    CHECK(slots[5].value == 7 && slots[6].value == 2 && slots[7].value == 3);
+    CHECK(slots[8].value == MAC_INDEX_EMPTY);
+    CHECK(macIndexFind(&idx, chain[0]) == MAC_INDEX_EMPTY);
+    CHECK(macIndexFind(&idx, chain[2]) == 2 && macIndexFind(&idx, next) == 3);
+
+    // The displaced key is now at its home slot and must not move back
+    // over it when the chain shrinks again
+    CHECK(macIndexErase(&idx, chain[1]));
+    CHECK(slots[5].value == 2 && slots[6].value == 3 && slots[7].value == MAC_INDEX_EMPTY);
+    CHECK(macIndexFind(&idx, chain[2]) == 2 && macIndexFind(&idx, next) == 3 && idx.count == 2);
+
+    // Heavy churn leaves no stale entries behind
+    macIndexClear(&idx);
+    for (int round = 0; round < 200; round++) {
+        for (int i = 0; i < 8; i++) CHECK(macIndexInsert(&idx, 0x020000000000ULL + round * 8 + i, i));
+        for (int i = 0; i < 8; i += 2) CHECK(macIndexErase(&idx, 0x020000000000ULL + round * 8 + i));
+        for (int i = 0; i < 8; i++) {
+            int want = (i % 2) ? i : MAC_INDEX_EMPTY;
+            CHECK(macIndexFind(&idx, 0x020000000000ULL + round * 8 + i) == want);
+        }
+        for (int i = 1; i < 8; i += 2) CHECK(macIndexErase(&idx, 0x020000000000ULL + round * 8 + i));
+        CHECK(idx.count == 0);
+    }
+
+    // Only a completely full index refuses an insert
+    for (int i = 0; i < 16; i++) CHECK(macIndexInsert(&idx, 0x020000001000ULL + i, i));
+    CHECK(!macIndexInsert(&idx, 0x020000002000ULL, 0));
+    CHECK(macIndexInsert(&idx, 0x020000001000ULL, 99));
+}
+
+static void testTxRing() {
+    static TxRing ring;
+    static uint8_t out[TX_RING_MAX_MSG];
+    txRingInit(&ring);
+    CHECK(txRingPop(&ring, out, sizeof(out)) == 0);
+
+    // Parts are joined into one message spanning several slots
+    char head[] = "\x02#7n", body[70], tail[] = "\x03";
+    for (size_t i = 0; i < sizeof(body); i++) body[i] = 'a' + i % 26;
+    TxPart parts[3] = {{head, 4}, {body, sizeof(body)}, {tail, 1}};
+    CHECK(txRingPush(&ring, parts, 3));
+    CHECK(txRingUsed(&ring) == 3);
+    CHECK(txRingPop(&ring, out, sizeof(out)) == 75);
+    CHECK(memcmp(out, head, 4) == 0 && memcmp(out + 4, body, sizeof(body)) == 0 && out[74] == 0x03);
+    CHECK(txRingUsed(&ring) == 0);
+
+    // Messages straddling the end of the slot array come out whole, in order
+    static uint8_t msg[100];
+    for (int i = 0; i < 3 * TX_RING_SLOTS; i++) {
+        memset(msg, i, sizeof(msg));
+        TxPart one = {msg, (size_t)(60 + i % 40)};
+        CHECK(txRingPush(&ring, &one, 1));
+        if (i % 2 == 0) continue;
+        for (int k = i - 1; k <= i; k++) {
+            CHECK(txRingPop(&ring, out, sizeof(out)) == (size_t)(60 + k % 40));
+            CHECK(out[0] == (uint8_t)k && out[59 + k % 40] == (uint8_t)k);
+        }
+    }
+
+    // Full: two maximum-size messages take every slot, the next is dropped
+    txRingInit(&ring);
+    static uint8_t big[TX_RING_MAX_MSG + 1];
+    TxPart max = {big, TX_RING_MAX_MSG};
+    CHECK(txRingPush(&ring, &max, 1) && txRingPush(&ring, &max, 1));
+    CHECK(ring.high_water.load() == TX_RING_SLOTS);
+    TxPart small = {big, 1};
+    CHECK(!txRingPush(&ring, &small, 1) && ring.drops.load() == 1);
+    TxPart over = {big, TX_RING_MAX_MSG + 1};
+    CHECK(!txRingPush(&ring, &over, 1) && ring.drops.load() == 2);
+    CHECK(txRingPop(&ring, out, sizeof(out)) == TX_RING_MAX_MSG);
+    CHECK(txRingPush(&ring, &small, 1));
+}
+
+static void testCaptureRing() {
+    static CaptureRing ring;
+    captureRingInit(&ring);
+    CHECK(captureRingPeek(&ring) == NULL);
+
+    // Fill it: occupancy counts up, then reserve fails and counts a drop
+    for (int i = 0; i < CAPTURE_RING_SLOTS; i++) {
+        CaptureFrame* f = captureRingReserve(&ring);
+        CHECK(f);
+        f->data[0] = i;
+        CHECK(captureRingCommit(&ring) == (uint32_t)(i + 1));
+    }
+    CHECK(captureRingReserve(&ring) == NULL && ring.drops.load() == 1);
+    CHECK(ring.high_water.load() == CAPTURE_RING_SLOTS && captureRingUsed(&ring) == CAPTURE_RING_SLOTS);
+
+    // Drained oldest first; a freed slot is reusable straight away
+    const CaptureFrame* f = captureRingPeek(&ring);
+    CHECK(f && f->data[0] == 0);
+    captureRingRelease(&ring);
+    CHECK(captureRingReserve(&ring) != NULL);
+    captureRingCommit(&ring);
+    for (int i = 1; i <= CAPTURE_RING_SLOTS; i++) {
+        f = captureRingPeek(&ring);
+        CHECK(f && f->data[0] == (uint8_t)(i % CAPTURE_RING_SLOTS));
+        captureRingRelease(&ring);
+    }
+    CHECK(captureRingPeek(&ring) == NULL && captureRingUsed(&ring) == 0);
+
+    // High water is a maximum, not the current level
+    CHECK(captureRingReserve(&ring) != NULL && captureRingCommit(&ring) == 1);
+    CHECK(ring.high_water.load() == CAPTURE_RING_SLOTS && ring.drops.load() == 1);
+}
+
+static void testChannelSched() {
+    for (int slot = 0; slot < CHAN_SLOTS; slot++) CHECK(chanToSlot(chanSlotToChannel(slot)) == slot);
+    CHECK(chanToSlot(15) < 0 && chanToSlot(37) < 0 && chanToSlot(169) < 0);
+    CHECK(chanSlotToChannel(14) == 36 && chanSlotToChannel(34) == 149);
+
+    static ChanSched s;
+    chanSchedInit(&s);
+    uint32_t dwell = 0;
+    CHECK(chanSchedNext(&s, 0, &dwell) == 0);
+
+    // Channel 6 is busy, channel 1 quiet; both visited at 1000
+    chanSchedAddAp(&s, 1);
+    chanSchedAddAp(&s, 6);
+    chanSchedAddAp(&s, 6);
+    CHECK(s.active == 2);
+    chanSchedRecord(&s, 1, 1000, 1000, 10, 0);
+    chanSchedRecord(&s, 6, 1000, 1000, 500, 0);
+    CHECK(s.slots[chanToSlot(1)].weight == CHAN_WEIGHT_BASE + 10);
+    CHECK(s.slots[chanToSlot(6)].weight == CHAN_WEIGHT_BASE + 500);
+
+    // Equal gaps: the busy channel wins and gets the longest dwell
+    CHECK(chanSchedNext(&s, 2000, &dwell) == 6 && dwell == CHAN_DWELL_MAX_MS);
+
+    // Right after a visit to 6, the quiet channel's longer gap wins; its
+    // dwell scales with its weight relative to the busiest channel
+    chanSchedRecord(&s, 6, 5000, 1000, 500, 0);
+    CHECK(chanSchedNext(&s, 5010, &dwell) == 1);
+    CHECK(dwell == CHAN_DWELL_MIN_MS + (CHAN_DWELL_MAX_MS - CHAN_DWELL_MIN_MS) * 20 / 510);
+
+    // New clients weigh in on top of the frame rate
+    chanSchedRecord(&s, 1, 6000, 1000, 10, 1);
+    CHECK(s.slots[chanToSlot(1)].weight == CHAN_WEIGHT_BASE + 10 + CHAN_WEIGHT_CLIENT * 30);
+
+    // An unsampled channel is explored before sampled ones
+    chanSchedAddAp(&s, 36);
+    CHECK(chanSchedNext(&s, 6010, &dwell) == 36);
+    chanSchedRecord(&s, 36, 6010, 1000, 0, 0);
+
+    // A saturated channel still yields to one left for CHAN_REVISIT_MS
+    chanSchedRecord(&s, 6, 16000, 1000, 60000, 0);
+    CHECK(s.slots[chanToSlot(6)].weight == CHAN_WEIGHT_MAX);
+    CHECK(chanSchedNext(&s, 16100, &dwell) == 1);
+
+    // Removing the last AP on a channel unschedules it
+    chanSchedRemoveAp(&s, 1);
+    chanSchedRemoveAp(&s, 36);
+    chanSchedRemoveAp(&s, 6);
+    CHECK(s.active == 1 && chanSchedNext(&s, 16100, &dwell) == 6);
+    chanSchedClearAps(&s);
+    CHECK(s.active == 0 && chanSchedNext(&s, 16100, &dwell) == 0);
+    CHECK(s.slots[chanToSlot(6)].weight == CHAN_WEIGHT_MAX);  // Rates survive a rescan
+}
+
+static void testFrameStats() {
+    static FrameStats fs;
+    frameStatsClear(&fs);
+
+    // Categories from the frame control byte
+    static const struct { uint8_t fc; int cat; } kinds[] = {
+        {0x80, FS_BEACON}, {0x40, FS_PROBE_REQ}, {0x50, FS_PROBE_RESP},
+        {0xB0, FS_AUTH_ASSOC}, {0x00, FS_AUTH_ASSOC}, {0x20, FS_AUTH_ASSOC},
+        {0xC0, FS_DEAUTH}, {0xA0, FS_DEAUTH}, {0xD0, FS_MGMT_OTHER},
+        {0xD4, FS_CTRL}, {0x08, FS_DATA}, {0x88, FS_DATA}, {0x0C, FS_MGMT_OTHER},
+    };
+    int want[FS_TYPES] = {0};
+    for (size_t i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++) {
+        frameStatsRecord(&fs, 6, kinds[i].fc, 100, -50);
+        want[kinds[i].cat]++;
+    }
+    FrameStatsSnapshot snap;
+    frameStatsSnapshot(&fs, chanToSlot(6), &snap);
+    for (int i = 0; i < FS_TYPES; i++) CHECK(snap.frames[i] == (uint32_t)want[i]);
+    CHECK(snap.total == sizeof(kinds) / sizeof(kinds[0]) && snap.bytes == 100 * snap.total);
+
+    // RSSI bins are 10 dB wide, clamped at both ends
+    static const struct { int rssi; int bin; } bins[] = {
+        {-120, 0}, {-91, 0}, {-90, 1}, {-81, 1}, {-41, 5}, {-31, 6}, {-30, 7}, {-5, 7},
+    };
+    for (size_t i = 0; i < sizeof(bins) / sizeof(bins[0]); i++) {
+        frameStatsClear(&fs);
+        frameStatsRecord(&fs, 36, 0x80, 10, bins[i].rssi);
+        frameStatsSnapshot(&fs, chanToSlot(36), &snap);
+        CHECK(snap.rssi_hist[bins[i].bin] == 1);
+    }
+
+    // Frames on an unmapped channel are only counted
+    frameStatsRecord(&fs, 15, 0x80, 10, -50);
+    CHECK(fs.unknown_channel.load() == 1);
+}
+
+// Feeds a byte string to the framer; returns the last non-NONE result
+static int feed(CmdFramer* f, const char* bytes, int len) {
+    int last = CMD_FRAME_NONE;
+    for (int i = 0; i < len; i++) {
+        int r = cmdFramerPush(f, (uint8_t)bytes[i]);
+        if (r != CMD_FRAME_NONE) last = r;
+    }
+    return last;
+}
+
+// deltaSuperseded for the change logged as version v, against the whole log
+static bool supersededAt(uint32_t v) {
+    DeltaChange c;
+    return deltaAt(&deltaLog, v, &c) && deltaSuperseded(&deltaLog, &c, deltaLog.version);
+}
+
+static void testDeltaLog() {
+    reset();
+    // Clearing both tables counts as two resets; replays start after them
+    uint32_t start = deltaLog.version;
+    CHECK(deltaLog.base == start && deltaLog.resets == 2);
+    CHECK(deltaCanReplay(&deltaLog, start) && !deltaCanReplay(&deltaLog, start - 1));
+
+    seedTwoNetworks();
+    CHECK(deltaLog.version == start + 2 && hostEvents.table_changes == 2);
+    DeltaChange c;
+    CHECK(deltaAt(&deltaLog, start + 1, &c));
+    CHECK(c.op == DELTA_INSERT && c.table == DELTA_NETWORK && c.key == macToKey(AP1));
+
+    // Small RSSI moves are absorbed; one past the threshold is an update
+    int ap1 = findNetwork(macToKey(AP1));
+    uint8_t buf[256];
+    CHECK(surveyFrame(&survey, buf, fbBeacon(buf, AP1, "alpha", 6), -43, 6, 0, NULL) == SV_UPDATED);
+    CHECK(deltaLog.version == start + 2 && deltaLog.suppressed == 1);
+    CHECK(surveyFrame(&survey, buf, fbBeacon(buf, AP1, "alpha", 6), -46, 6, 0, NULL) == SV_UPDATED);
+    CHECK(deltaLog.version == start + 3);
+    CHECK(deltaAt(&deltaLog, start + 3, &c));
+    CHECK(c.op == DELTA_UPDATE && c.index == ap1 && networks[ap1].rssi == -46);
+    // Measured from the last reported value, not the last seen one
+    setNetworkRssi(ap1, -50);
+    CHECK(deltaLog.version == start + 3);
+
+    // The update supersedes the insert; AP2's insert stands
+    CHECK(supersededAt(start + 1));
+    CHECK(!supersededAt(start + 2));
+    // Only changes up to the given version count
+    CHECK(deltaAt(&deltaLog, start + 1, &c) && !deltaSuperseded(&deltaLog, &c, start + 2));
+
+    // Client inserts, RSSI updates and evictions, keyed by MAC
+    addTestClient(1, AP1, 0);
+    uint8_t mac[6];
+    fbMac(mac, 0x10, 1);
+    int cli = findClient(macToKey(mac));
+    setClientRssi(cli, -80);
+    evictClient(cli);
+    CHECK(deltaAt(&deltaLog, deltaLog.version, &c));
+    CHECK(c.op == DELTA_EVICT && c.table == DELTA_CLIENT && c.index == cli && c.key == macToKey(mac));
+    CHECK(supersededAt(deltaLog.version - 2));
+    int ap2 = findNetwork(macToKey(AP2));
+    retireNetwork(ap2);
+    uint32_t retired = deltaLog.version;
+    CHECK(deltaAt(&deltaLog, retired, &c) && c.op == DELTA_EVICT);
+
+    // Heard again, AP2 comes back at a new index. A replay still has to
+    // evict the old one, or the host keeps a ghost record there.
+    int back;
+    CHECK(surveyFrame(&survey, buf, fbBeacon(buf, AP2, "beta", 36), -60, 36, 0, &back) == SV_ADDED);
+    CHECK(back != ap2 && deltaAt(&deltaLog, deltaLog.version, &c) && c.index == back);
+    CHECK(!supersededAt(retired) && !supersededAt(deltaLog.version));
+    retireNetwork(back);
+    CHECK(!supersededAt(retired) && supersededAt(retired + 1));
+
+    // Only the last DELTA_LOG_SLOTS changes can be replayed
+    uint32_t before = deltaLog.version;
+    for (int i = 0; i < DELTA_LOG_SLOTS; i++) addTestClient(100 + i, NULL, 0);
+    CHECK(deltaLog.version == before + DELTA_LOG_SLOTS);
+    CHECK(deltaCanReplay(&deltaLog, before) && !deltaCanReplay(&deltaLog, before - 1));
+    CHECK(!deltaAt(&deltaLog, before, &c) && deltaAt(&deltaLog, before + 1, &c));
+    CHECK(!deltaCanReplay(&deltaLog, deltaLog.version + 1));
+
+    // A slot caught while the writer refills it reads as gone
+    uint32_t refilling = deltaLog.version - 1;
+    DeltaChange& slot = deltaLog.log[refilling & (DELTA_LOG_SLOTS - 1)];
+    slot.version = 0;
+    CHECK(!deltaAt(&deltaLog, refilling, &c));
+    slot.version = refilling;
+    CHECK(deltaAt(&deltaLog, refilling, &c));
+
+    // Renumbering the networks rules out any replay from before it
+    uint32_t sorted = deltaLog.version;
+    sortNetworks();
+    CHECK(deltaLog.version == sorted + 1 && deltaLog.base == sorted + 1);
+    CHECK(deltaAt(&deltaLog, sorted + 1, &c) && c.op == DELTA_RESET);
+    CHECK(!deltaCanReplay(&deltaLog, sorted) && deltaCanReplay(&deltaLog, sorted + 1));
+}
+
+static void testCmdQueue() {
+    static CmdFramer f;
+    cmdFramerInit(&f, CMD_SRC_USB);
+
+    // Noise outside a frame is ignored; an STX inside one starts over
+    CHECK(feed(&f, "junk\x02" "g\x03", 7) == CMD_FRAME_DONE);
+    CHECK(strcmp(f.msg.text, "g") == 0 && f.msg.source == CMD_SRC_USB);
+    CHECK(feed(&f, "\x02" "d1\x02" "s5\x03", 7) == CMD_FRAME_DONE);
+    CHECK(strcmp(f.msg.text, "s5") == 0);
+    CHECK(feed(&f, "\x02\x03", 2) == CMD_FRAME_NONE);
+
+    // Full-length commands fit; one byte more discards the whole frame
+    char frame[CMD_MAX_LEN + 3];
+    frame[0] = CMD_STX;
+    memset(frame + 1, 'a', CMD_MAX_LEN);
+    frame[CMD_MAX_LEN + 1] = CMD_ETX;
+    CHECK(feed(&f, frame, CMD_MAX_LEN + 2) == CMD_FRAME_DONE);
+    CHECK(f.msg.len == CMD_MAX_LEN && strlen(f.msg.text) == CMD_MAX_LEN);
+    memset(frame + 1, 'b', CMD_MAX_LEN + 1);
+    frame[CMD_MAX_LEN + 2] = CMD_ETX;
+    CHECK(feed(&f, frame, CMD_MAX_LEN + 3) == CMD_FRAME_TOO_LONG);
+    CHECK(feed(&f, "\x02" "i\x03", 3) == CMD_FRAME_DONE && strcmp(f.msg.text, "i") == 0);
+
+    // A request ID prefix is stripped off; handlers see the bare command
+    CHECK(f.msg.req_id == 0);
+    CHECK(feed(&f, "\x02#42s5\x03", 7) == CMD_FRAME_DONE);
+    CHECK(f.msg.req_id == 42 && f.msg.len == 2 && strcmp(f.msg.text, "s5") == 0);
+    CHECK(feed(&f, "\x02#65535g\x03", 9) == CMD_FRAME_DONE && f.msg.req_id == 65535);
+    CHECK(feed(&f, "\x02g\x03", 3) == CMD_FRAME_DONE && f.msg.req_id == 0);
+    CHECK(feed(&f, "\x02#65536g\x03", 9) == CMD_FRAME_BAD_ID);
+    CHECK(feed(&f, "\x02#0g\x03", 5) == CMD_FRAME_BAD_ID);
+    CHECK(feed(&f, "\x02#g\x03", 4) == CMD_FRAME_BAD_ID);
+    CHECK(feed(&f, "\x02#12\x03", 5) == CMD_FRAME_BAD_ID);
+
+    // Each queued command keeps its own copy of the text
+    static CmdQueue q;
+    cmdQueueInit(&q);
+    CHECK(cmdQueuePeek(&q) == NULL);
+    for (int i = 0; i < CMD_QUEUE_SLOTS; i++) {
+        char text[8];
+        snprintf(text, sizeof(text), "\x02" "c%d\x03", i);
+        CHECK(feed(&f, text, strlen(text)) == CMD_FRAME_DONE);
+        CHECK(cmdQueuePush(&q, &f.msg));
+    }
+    CHECK(!cmdQueuePush(&q, &f.msg));
+    CHECK(q.drops.load() == 1 && q.high_water.load() == CMD_QUEUE_SLOTS);
+    for (int i = 0; i < CMD_QUEUE_SLOTS; i++) {
+        CmdMsg* m = cmdQueuePeek(&q);
+        char expect[4];
+        snprintf(expect, sizeof(expect), "c%d", i);
+        CHECK(m && strcmp(m->text, expect) == 0 && m->req_id == 0);
+        cmdQueueRelease(&q);
+    }
+    CHECK(cmdQueuePeek(&q) == NULL && cmdQueueUsed(&q) == 0);
+
+    // Only handlers that block for seconds leave the dispatcher
+    CmdMsg m = {};
+    strcpy(m.text, "w1");
+    CHECK(cmdIsSlow(&m));
+    strcpy(m.text, "x");
+    CHECK(cmdIsSlow(&m));
+    strcpy(m.text, "ls");
+    CHECK(!cmdIsSlow(&m));
+    strcpy(m.text, "g");
+    CHECK(!cmdIsSlow(&m));
+
+    // Readers of what the capture worker writes run on the worker
+    CHECK(cmdOnWorker(&m));
+    strcpy(m.text, "hg");
+    CHECK(cmdOnWorker(&m));
+    strcpy(m.text, "R1");
+    CHECK(cmdOnWorker(&m));
+    strcpy(m.text, "Rs");
+    CHECK(!cmdOnWorker(&m));
+    strcpy(m.text, "ur1200");
+    CHECK(cmdOnWorker(&m));
+    strcpy(m.text, "u1");
+    CHECK(!cmdOnWorker(&m));
+    strcpy(m.text, "i");
+    CHECK(!cmdOnWorker(&m));
+}
+
+static void testProtoCrc() {
+    // CRC-16/CCITT-FALSE check value
+    CHECK(crc16Ccitt((const uint8_t*)"123456789", 9) == 0x29B1);
+    CHECK(crc16Ccitt(NULL, 0) == 0xFFFF);
+    // Chaining over pieces gives the same result as one pass
+    CHECK(crc16Ccitt((const uint8_t*)"6789", 4, crc16Ccitt((const uint8_t*)"12345", 5)) == 0x29B1);
+}
+
+static void testProtoRequestId() {
+    uint8_t payload[3] = {1, 2, 3};
+    uint8_t plain[PROTO_MAX_FRAME], tagged[PROTO_MAX_FRAME];
+    size_t plainLen = protoEncodeFrame(plain, sizeof(plain), 'c', payload, 3);
+    size_t taggedLen = protoEncodeFrame(tagged, sizeof(tagged), 'c', payload, 3, 0x1234);
+
+    CHECK(plainLen == PROTO_HEADER_LEN + 3 + PROTO_CRC_LEN && plain[0] == PROTO_SYNC);
+    CHECK(taggedLen == plainLen + PROTO_ID_LEN);
+    CHECK(tagged[0] == PROTO_SYNC_ID && tagged[1] == 'c');
+    CHECK(tagged[2] == 0x34 && tagged[3] == 0x12 && tagged[4] == 3 && tagged[5] == 0);
+    CHECK(memcmp(tagged + 6, payload, 3) == 0);
+    uint16_t crc = crc16Ccitt(tagged + 1, 5 + 3);
+    CHECK(tagged[9] == (crc & 0xFF) && tagged[10] == (crc >> 8));
+
+    // The largest payload still fits a PROTO_MAX_FRAME buffer with an ID
+    static uint8_t big[PROTO_MAX_PAYLOAD];
+    CHECK(protoEncodeFrame(tagged, sizeof(tagged), 'n', big, PROTO_MAX_PAYLOAD, 1) == PROTO_MAX_FRAME);
+}
+
+static void testPcapRoundTrip() {
+    char path[] = "/tmp/gattrose_core_test_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    FILE* fp = fdopen(fd, "wb");
+    CHECK(fp);
+
+    uint8_t buf[256], sta[6];
+    fbMac(sta, 0x10, 3);
+    CHECK(pcapWriteHeader(fp, PCAP_DLT_IEEE802_11_RADIO));
+    CHECK(pcapWritePacket(fp, PCAP_DLT_IEEE802_11_RADIO, 1000000, buf, fbBeacon(buf, AP1, "alpha", 6), -42, 6));
+    CHECK(pcapWritePacket(fp, PCAP_DLT_IEEE802_11_RADIO, 1500000, buf, fbData(buf, sta, AP1, true, 60), -61, 6));
+    fclose(fp);
+
+    static PcapReader reader;
+    CHECK(pcapOpen(&reader, path));
+    PcapPacket pkt;
+    CHECK(pcapNext(&reader, &pkt) == 1);
+    CHECK(pkt.rssi == -42);
+    CHECK(pkt.channel == 6);
+    CHECK(pkt.ts_us == 1000000);
+    CHECK((pkt.frame[0] & 0xFC) == 0x80);
+
+    CHECK(pcapNext(&reader, &pkt) == 1);
+    CHECK(pkt.rssi == -61);
+    CHECK(pkt.len == 24 + 60);
+    CHECK(pcapNext(&reader, &pkt) == 0);
+    pcapClose(&reader);
+    unlink(path);
+}
+
+int main() {
+    testDataFramesAddClients();
+    testProbeAndAssoc();
+    testRetireAndSortKeepLinks();
+    testClientLruEviction();
+    testClientTtl();
+    testPmkidAndTruncation();
+    testRogueDetector();
+    testDeauthFlood();
+    testBaselineStore();
+    testProbeStats();
+    testIeParser();
+    testNetSurvey();
+    testSurveySweep();
+    testMacIndex();
+    testTxRing();
+    testCaptureRing();
+    testChannelSched();
+    testFrameStats();
+    testDeltaLog();
+    testCmdQueue();
+    testProtoCrc();
+    testProtoRequestId();
+    testPcapRoundTrip();
+    printf("core_test: all checks passed\n");
+    return 0;
+}
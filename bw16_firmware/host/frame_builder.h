@@ -0,0 +1,130 @@
+#ifndef GATTROSE_HOST_FRAME_BUILDER_H
+#define GATTROSE_HOST_FRAME_BUILDER_H
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Synthetic 802.11 frames for tests and benchmarks. Each builder writes
+ * into out (at least 256 bytes) and returns the frame length.
+ */
+
+static inline int fbHeader(uint8_t* out, uint8_t fc0, uint8_t fc1, const uint8_t* a1,
+                           const uint8_t* a2, const uint8_t* a3) {
+    memset(out, 0, 24);
+    out[0] = fc0;
+    out[1] = fc1;
+    memcpy(out + 4, a1, 6);
+    memcpy(out + 10, a2, 6);
+    memcpy(out + 16, a3, 6);
+    return 24;
+}
+
+static inline int fbIe(uint8_t* out, uint8_t id, const void* data, int len) {
+    out[0] = id;
+    out[1] = len;
+    memcpy(out + 2, data, len);
+    return 2 + len;
+}
+
+static inline int fbBeacon(uint8_t* out, const uint8_t* bssid, const char* ssid, int channel) {
+    static const uint8_t bcast[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    int n = fbHeader(out, 0x80, 0x00, bcast, bssid, bssid);
+    memset(out + n, 0, 12);
+    out[n + 8] = 0x64;              // Beacon interval 100 TU
+    out[n + 10] = 0x11;             // ESS + privacy
+    n += 12;
+    n += fbIe(out + n, 0, ssid, strlen(ssid));
+    uint8_t ch = channel;
+    n += fbIe(out + n, 3, &ch, 1);
+    return n;
+}
+
+// Sequence number lives in the top 12 bits of the sequence control field
+static inline void fbSetSeq(uint8_t* out, uint16_t seq) {
+    out[22] = (seq << 4) & 0xF0;
+    out[23] = seq >> 4;
+}
+
+static inline int fbProbeReq(uint8_t* out, const uint8_t* client, const char* ssid) {
+    static const uint8_t bcast[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    int n = fbHeader(out, 0x40, 0x00, bcast, client, bcast);
+    n += fbIe(out + n, 0, ssid, strlen(ssid));
+    static const uint8_t rates[4] = {0x82, 0x84, 0x8B, 0x96};
+    n += fbIe(out + n, 1, rates, 4);
+    return n;
+}
+
+static inline int fbAssocReq(uint8_t* out, const uint8_t* client, const uint8_t* bssid) {
+    int n = fbHeader(out, 0x00, 0x00, bssid, client, bssid);
+    memset(out + n, 0, 4);
+    n += 4;
+    return n;
+}
+
+static inline int fbAuth(uint8_t* out, const uint8_t* client, const uint8_t* bssid) {
+    int n = fbHeader(out, 0xB0, 0x00, bssid, client, bssid);
+    memset(out + n, 0, 6);
+    out[n + 2] = 1;                 // Open system, sequence 1
+    return n + 6;
+}
+
+// Deauthentication (or disassociation, with disassoc set) from src to dst
+static inline int fbDeauth(uint8_t* out, const uint8_t* src, const uint8_t* dst, const uint8_t* bssid,
+                           uint16_t reason, bool disassoc = false) {
+    int n = fbHeader(out, disassoc ? 0xA0 : 0xC0, 0x00, dst, src, bssid);
+    out[n] = reason & 0xFF;
+    out[n + 1] = reason >> 8;
+    return n + 2;
+}
+
+// toAp: client -> AP (ToDS), otherwise AP -> client (FromDS)
+static inline int fbData(uint8_t* out, const uint8_t* client, const uint8_t* bssid, bool toAp, int payload) {
+    int n = toAp ? fbHeader(out, 0x08, 0x01, bssid, client, bssid)
+                 : fbHeader(out, 0x08, 0x02, client, bssid, bssid);
+    memset(out + n, 0x5A, payload);
+    return n + payload;
+}
+
+// EAPOL-Key message 1 from the AP carrying a PMKID KDE
+static inline int fbEapolM1(uint8_t* out, const uint8_t* client, const uint8_t* bssid, const uint8_t* pmkid) {
+    int n = fbHeader(out, 0x08, 0x02, client, bssid, bssid);
+    static const uint8_t snap[8] = {0xAA, 0xAA, 0x03, 0x00, 0x00, 0x00, 0x88, 0x8E};
+    memcpy(out + n, snap, 8);
+    n += 8;
+
+    uint8_t* e = out + n;
+    memset(e, 0, 99);
+    e[0] = 0x02;                    // Version
+    e[1] = 0x03;                    // Key
+    e[4] = 0x02;                    // RSN descriptor
+    e[5] = 0x00;
+    e[6] = 0x8A;                    // Key info: ACK, pairwise, HMAC-SHA1/AES
+    for (int i = 0; i < 32; i++) e[17 + i] = i;    // ANonce
+    e[97] = 0;
+    e[98] = 22;                     // Key data length
+    uint8_t* kd = e + 99;
+    kd[0] = 0xDD;
+    kd[1] = 0x14;
+    kd[2] = 0x00;
+    kd[3] = 0x0F;
+    kd[4] = 0xAC;
+    kd[5] = 0x04;
+    memcpy(kd + 6, pmkid, 16);
+    int bodyLen = 99 + 22;
+    e[2] = (bodyLen - 4) >> 8;
+    e[3] = (bodyLen - 4) & 0xFF;
+    return n + bodyLen;
+}
+
+// Deterministic unicast MAC from an index
+static inline void fbMac(uint8_t* mac, uint8_t prefix, uint32_t i) {
+    mac[0] = prefix & 0xFE;
+    mac[1] = 0x11;
+    mac[2] = i >> 24;
+    mac[3] = i >> 16;
+    mac[4] = i >> 8;
+    mac[5] = i;
+}
+
+#endif
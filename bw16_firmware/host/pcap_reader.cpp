@@ -0,0 +1,140 @@
+#include "pcap_reader.h"
+#include <string.h>
+
+#define PCAP_MAGIC_US   0xA1B2C3D4
+#define PCAP_MAGIC_NS   0xA1B23C4D
+
+static uint32_t swap32(uint32_t v) {
+    return (v >> 24) | ((v >> 8) & 0xFF00) | ((v << 8) & 0xFF0000) | (v << 24);
+}
+
+static uint16_t le16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+
+int freqToChannel(int mhz) {
+    if (mhz == 2484) return 14;
+    if (mhz >= 2412 && mhz <= 2472) return (mhz - 2407) / 5;
+    if (mhz >= 5000 && mhz <= 5900) return (mhz - 5000) / 5;
+    return 0;
+}
+
+int channelToFreq(int channel) {
+    if (channel == 14) return 2484;
+    if (channel >= 1 && channel <= 13) return 2407 + channel * 5;
+    return 5000 + channel * 5;
+}
+
+bool pcapOpen(PcapReader* r, const char* path) {
+    r->fp = fopen(path, "rb");
+    if (!r->fp) return false;
+
+    uint32_t hdr[6];
+    if (fread(hdr, sizeof(hdr), 1, r->fp) != 1) {
+        fclose(r->fp);
+        return false;
+    }
+
+    uint32_t magic = hdr[0];
+    r->swapped = (magic == swap32(PCAP_MAGIC_US) || magic == swap32(PCAP_MAGIC_NS));
+    if (r->swapped) magic = swap32(magic);
+    if (magic != PCAP_MAGIC_US && magic != PCAP_MAGIC_NS) {
+        fclose(r->fp);
+        return false;
+    }
+    r->nanos = (magic == PCAP_MAGIC_NS);
+    r->linktype = r->swapped ? swap32(hdr[5]) : hdr[5];
+    return r->linktype == PCAP_DLT_IEEE802_11 || r->linktype == PCAP_DLT_IEEE802_11_RADIO;
+}
+
+void pcapClose(PcapReader* r) {
+    if (r->fp) fclose(r->fp);
+    r->fp = NULL;
+}
+
+// Walks the radiotap fields we care about (TSFT, Flags, Rate, Channel, FHSS,
+// dBm antenna signal). Returns the header length, or -1 if malformed.
+static int parseRadiotap(const uint8_t* p, int len, PcapPacket* pkt, bool* hasFcs) {
+    if (len < 8) return -1;
+    int rtLen = le16(p + 2);
+    if (rtLen < 8 || rtLen > len) return -1;
+
+    uint32_t present = p[4] | (p[5] << 8) | (p[6] << 16) | ((uint32_t)p[7] << 24);
+
+    // Skip extended presence bitmaps
+    int off = 8;
+    uint32_t word = present;
+    while (word & 0x80000000) {
+        if (off + 4 > rtLen) return -1;
+        word = p[off] | (p[off + 1] << 8) | (p[off + 2] << 16) | ((uint32_t)p[off + 3] << 24);
+        off += 4;
+    }
+
+    // Field bit -> (alignment, size)
+    static const uint8_t align[6] = {8, 1, 1, 2, 1, 1};
+    static const uint8_t size[6] = {8, 1, 1, 4, 2, 1};
+    for (int bit = 0; bit < 6; bit++) {
+        if (!(present & (1u << bit))) continue;
+        off = (off + align[bit] - 1) & ~(align[bit] - 1);
+        if (off + size[bit] > rtLen) return -1;
+
+        if (bit == 1 && (p[off] & 0x10)) *hasFcs = true;
+        if (bit == 3) pkt->channel = freqToChannel(le16(p + off));
+        if (bit == 5) pkt->rssi = (int8_t)p[off];
+        off += size[bit];
+    }
+    return rtLen;
+}
+
+int pcapNext(PcapReader* r, PcapPacket* pkt) {
+    uint32_t rec[4];
+    if (fread(rec, sizeof(rec), 1, r->fp) != 1) return 0;
+    if (r->swapped) {
+        for (int i = 0; i < 4; i++) rec[i] = swap32(rec[i]);
+    }
+
+    uint32_t capLen = rec[2];
+    if (capLen > sizeof(r->buf)) return -1;
+    if (fread(r->buf, 1, capLen, r->fp) != capLen) return -1;
+
+    pkt->ts_us = (uint64_t)rec[0] * 1000000 + (r->nanos ? rec[1] / 1000 : rec[1]);
+    pkt->rssi = -50;
+    pkt->channel = 0;
+    pkt->frame = r->buf;
+    pkt->len = capLen;
+
+    if (r->linktype == PCAP_DLT_IEEE802_11_RADIO) {
+        bool hasFcs = false;
+        int rtLen = parseRadiotap(r->buf, capLen, pkt, &hasFcs);
+        if (rtLen < 0) return -1;
+        pkt->frame += rtLen;
+        pkt->len -= rtLen;
+        if (hasFcs && pkt->len >= 4) pkt->len -= 4;
+    }
+    return 1;
+}
+
+bool pcapWriteHeader(FILE* fp, uint32_t linktype) {
+    uint32_t hdr[6] = {PCAP_MAGIC_US, 0x00040002, 0, 0, 65535, linktype};
+    return fwrite(hdr, sizeof(hdr), 1, fp) == 1;
+}
+
+bool pcapWritePacket(FILE* fp, uint32_t linktype, uint64_t ts_us,
+                     const uint8_t* frame, int len, int rssi, int channel) {
+    // Radiotap: Channel (bit 3) and dBm antenna signal (bit 5)
+    uint8_t rt[14] = {0, 0, 14, 0, 0x28, 0, 0, 0};
+    int rtLen = 0;
+    if (linktype == PCAP_DLT_IEEE802_11_RADIO) {
+        uint16_t freq = channelToFreq(channel);
+        rt[8] = freq & 0xFF;
+        rt[9] = freq >> 8;
+        rt[10] = channel > 14 ? 0x00 : 0x80;  // 2 GHz flag
+        rt[11] = channel > 14 ? 0x01 : 0x00;  // 5 GHz flag
+        rt[12] = (uint8_t)(int8_t)rssi;
+        rtLen = 14;
+    }
+
+    uint32_t rec[4] = {(uint32_t)(ts_us / 1000000), (uint32_t)(ts_us % 1000000),
+                       (uint32_t)(len + rtLen), (uint32_t)(len + rtLen)};
+    if (fwrite(rec, sizeof(rec), 1, fp) != 1) return false;
+    if (rtLen && fwrite(rt, rtLen, 1, fp) != 1) return false;
+    return fwrite(frame, 1, len, fp) == (size_t)len;
+}
@@ -0,0 +1,46 @@
+#ifndef GATTROSE_HOST_PCAP_READER_H
+#define GATTROSE_HOST_PCAP_READER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Minimal pcap reader/writer for the host tools. Understands classic
+ * (non-ng) pcap files with raw 802.11 (DLT 105) or radiotap (DLT 127)
+ * framing. Radiotap is stripped; RSSI, channel and FCS presence are taken
+ * from it when available.
+ */
+
+#define PCAP_DLT_IEEE802_11         105
+#define PCAP_DLT_IEEE802_11_RADIO   127
+
+typedef struct {
+    FILE* fp;
+    uint32_t linktype;
+    bool swapped;
+    bool nanos;
+    uint8_t buf[65536];
+} PcapReader;
+
+typedef struct {
+    uint8_t* frame;         // 802.11 header onwards, FCS removed
+    int len;
+    int rssi;               // dBm, -50 if the capture has none
+    int channel;            // 0 if the capture has none
+    uint64_t ts_us;
+} PcapPacket;
+
+bool pcapOpen(PcapReader* r, const char* path);
+// 1 = packet, 0 = end of file, -1 = malformed
+int pcapNext(PcapReader* r, PcapPacket* pkt);
+void pcapClose(PcapReader* r);
+
+// Writer, for generating fixtures. Radiotap output carries rssi and channel.
+bool pcapWriteHeader(FILE* fp, uint32_t linktype);
+bool pcapWritePacket(FILE* fp, uint32_t linktype, uint64_t ts_us,
+                     const uint8_t* frame, int len, int rssi, int channel);
+
+int freqToChannel(int mhz);
+int channelToFreq(int channel);
+
+#endif
@@ -0,0 +1,116 @@
+#include "platform_host.h"
+#include "platform.h"
+#include "net_tables.h"
+#include "log.h"
+#include "rogue_detect.h"
+#include "deauth_detect.h"
+#include "net_survey.h"
+#include "delta_log.h"
+#include <stdio.h>
+#include <string.h>
+
+HostEvents hostEvents;
+bool hostVerbose = false;
+uint8_t hostStore[BS_SLOTS][BS_SLOT_SIZE];
+unsigned long hostStoreErases = 0;
+
+static unsigned long hostMillis = 0;
+
+void hostSetMillis(unsigned long ms) {
+    hostMillis = ms;
+}
+
+void hostResetEvents() {
+    memset(&hostEvents, 0, sizeof(hostEvents));
+}
+
+unsigned long platformMillis() {
+    return hostMillis;
+}
+
+void logEmit(int level, const char* line, size_t len) {
+    (void)level;
+    if (hostVerbose) printf("  log: %.*s", (int)len, line);
+}
+
+void onNetworkAdded(int networkIndex) {
+    hostEvents.networks_added++;
+    if (hostVerbose) {
+        char mac[MAC_STR_LEN];
+        formatMac(mac, networks[networkIndex].bssid);
+        printf("  new network %s ch%d \"%s\"\n", mac, networks[networkIndex].channel,
+               networks[networkIndex].ssid);
+    }
+}
+
+void onClientAdded(int clientIndex) {
+    hostEvents.clients_added++;
+    if (hostVerbose) {
+        char mac[MAC_STR_LEN];
+        formatMac(mac, clients[clientIndex].mac);
+        printf("  new client %s -> AP %d\n", mac, clients[clientIndex].ap_index);
+    }
+}
+
+void onTableChange(const DeltaChange* change) {
+    (void)change;
+    hostEvents.table_changes++;
+}
+
+void onProbeSsid(const uint8_t* mac, const char* ssid, int rssi) {
+    (void)mac;
+    (void)rssi;
+    hostEvents.probe_ssids++;
+    if (hostVerbose) printf("  probe for \"%s\"\n", ssid);
+}
+
+void onEapolCaptured(char type, const char* ssid) {
+    if (type == 'h') hostEvents.pmkids++;
+    else hostEvents.handshakes++;
+    if (hostVerbose) printf("  %s captured for \"%s\"\n", type == 'h' ? "PMKID" : "handshake", ssid);
+}
+
+void onRogueAlert(const RogueAlert* alert) {
+    hostEvents.rogue_alerts++;
+    if (hostVerbose) {
+        char mac[MAC_STR_LEN];
+        formatMac(mac, alert->bssid);
+        printf("  rogue %s %s ch%d \"%s\" %u -> %u\n", rogueAlertName(alert->type), mac,
+               alert->channel, alert->ssid, (unsigned)alert->expected, (unsigned)alert->observed);
+    }
+}
+
+void onDeauthAlert(const DeauthAlert* alert) {
+    hostEvents.deauth_alerts++;
+    if (hostVerbose) {
+        char mac[MAC_STR_LEN];
+        formatMac(mac, alert->mac);
+        printf("  %s %s ch%d count=%u reason=%u\n", deauthAlertName(alert->type), mac,
+               alert->channel, alert->count, alert->reason);
+    }
+}
+
+void hostEraseStore() {
+    memset(hostStore, 0xFF, sizeof(hostStore));
+    hostStoreErases = 0;
+}
+
+bool storeReadSlot(int slot, uint32_t offset, void* buf, uint32_t len) {
+    if (slot < 0 || slot >= BS_SLOTS || offset + len > BS_SLOT_SIZE) return false;
+    memcpy(buf, hostStore[slot] + offset, len);
+    return true;
+}
+
+bool storeEraseSlot(int slot) {
+    if (slot < 0 || slot >= BS_SLOTS) return false;
+    memset(hostStore[slot], 0xFF, BS_SLOT_SIZE);
+    hostStoreErases++;
+    return true;
+}
+
+bool storeWriteSlot(int slot, const uint8_t* buf, uint32_t len, uint32_t headerLen) {
+    if (len > BS_SLOT_SIZE || headerLen > len || !storeEraseSlot(slot)) return false;
+    memcpy(hostStore[slot] + headerLen, buf + headerLen, len - headerLen);
+    memcpy(hostStore[slot], buf, headerLen);
+    return true;
+}
@@ -0,0 +1,34 @@
+#ifndef GATTROSE_HOST_PLATFORM_HOST_H
+#define GATTROSE_HOST_PLATFORM_HOST_H
+
+#include <stdint.h>
+#include "baseline_store.h"
+
+/*
+ * Host implementation of the firmware's platform.h hooks. Time is driven by
+ * the caller (pcap timestamps or a synthetic clock) and hook calls are just
+ * counted, optionally logged to stdout. The baseline store's flash is a RAM
+ * array; hostEraseStore() puts it in the erased state.
+ */
+
+typedef struct {
+    unsigned long networks_added;
+    unsigned long clients_added;
+    unsigned long probe_ssids;
+    unsigned long pmkids;
+    unsigned long handshakes;
+    unsigned long rogue_alerts;
+    unsigned long deauth_alerts;
+    unsigned long table_changes;
+} HostEvents;
+
+extern HostEvents hostEvents;
+extern bool hostVerbose;
+extern uint8_t hostStore[BS_SLOTS][BS_SLOT_SIZE];
+extern unsigned long hostStoreErases;
+
+void hostSetMillis(unsigned long ms);
+void hostResetEvents();
+void hostEraseStore();
+
+#endif
@@ -0,0 +1,141 @@
+// gattrose_replay - feed pcap captures through the firmware's frame parser
+// and print the resulting network and client tables.
+//
+//   gattrose_replay [-v] [--capture] [--rogue] file.pcap [more.pcap ...]
+//
+// Networks come from beacons and probe responses in the capture, through
+// the same passive survey the firmware runs with sv1. With --rogue the
+// networks seeded from the first file become the rogue AP baseline and the
+// remaining files are checked against it. Deauth and disassoc frames
+// always go through the flood monitor.
+
+#include <stdio.h>
+#include <string.h>
+#include "pcap_reader.h"
+#include "platform_host.h"
+#include "net_tables.h"
+#include "frame_parser.h"
+#include "rogue_detect.h"
+#include "deauth_detect.h"
+#include "net_survey.h"
+#include "delta_log.h"
+
+static void printTables() {
+    printf("\nNetworks (%d)\n", activeNetworkCount());
+    printf("  %-4s %-17s %4s %5s %7s  %s\n", "idx", "bssid", "ch", "rssi", "clients", "ssid");
+    for (size_t i = 0; i < networks.size(); i++) {
+        WiFiNetwork& net = networks[i];
+        if (net.vacant) continue;
+        char bssid[MAC_STR_LEN];
+        formatMac(bssid, net.bssid);
+        printf("  %-4zu %-17s %4d %5d %7d  %s\n", i, bssid, net.channel, net.rssi,
+               net.client_count, net.hidden ? "<hidden>" : net.ssid);
+    }
+
+    printf("\nClients (%d, %u evicted)\n", activeClientCount(),
+           clientStats.evicted_lru + clientStats.evicted_ttl);
+    printf("  %-17s %4s %5s\n", "mac", "ap", "rssi");
+    for (size_t i = 0; i < clients.size(); i++) {
+        if (clients[i].vacant) continue;
+        char mac[MAC_STR_LEN];
+        formatMac(mac, clients[i].mac);
+        printf("  %-17s %4d %5d\n", mac, clients[i].ap_index, clients[i].rssi);
+    }
+}
+
+static RogueDetector rogue;
+static DeauthDetector deauth;
+static NetSurvey survey;
+
+static void startRogueMonitor() {
+    rogueInit(&rogue);
+    for (size_t i = 0; i < networks.size(); i++) {
+        if (networks[i].vacant) continue;
+        rogueAddBaseline(&rogue, networks[i].bssid, networks[i].ssid, networks[i].channel);
+    }
+    rogue.active = true;
+}
+
+int main(int argc, char** argv) {
+    bool rogueMode = false;
+    int firstFile = 1;
+    for (; firstFile < argc && argv[firstFile][0] == '-'; firstFile++) {
+        if (strcmp(argv[firstFile], "-v") == 0) {
+            hostVerbose = true;
+        } else if (strcmp(argv[firstFile], "--capture") == 0) {
+            pmkidCaptureActive = true;
+            handshakeCaptureActive = true;
+        } else if (strcmp(argv[firstFile], "--rogue") == 0) {
+            rogueMode = true;
+        } else {
+            fprintf(stderr, "unknown option %s\n", argv[firstFile]);
+            return 2;
+        }
+    }
+    if (firstFile >= argc) {
+        fprintf(stderr, "usage: %s [-v] [--capture] [--rogue] file.pcap [...]\n", argv[0]);
+        return 2;
+    }
+
+    netTablesInit();
+    rogueInit(&rogue);
+    deauthInit(&deauth);
+    deauth.active = true;
+    surveyInit(&survey);
+    survey.active = true;
+    hostResetEvents();
+
+    unsigned long packets = 0, malformed = 0;
+    unsigned long lastAge = 0;
+    for (int f = firstFile; f < argc; f++) {
+        static PcapReader reader;
+        if (!pcapOpen(&reader, argv[f])) {
+            fprintf(stderr, "%s: not a raw 802.11 or radiotap pcap\n", argv[f]);
+            return 1;
+        }
+
+        PcapPacket pkt;
+        int rc;
+        while ((rc = pcapNext(&reader, &pkt)) != 0) {
+            if (rc < 0) {
+                malformed++;
+                break;
+            }
+            packets++;
+            unsigned long now = pkt.ts_us / 1000;
+            hostSetMillis(now);
+            // Same cadence as the firmware's capture worker
+            if (now - lastAge >= CLIENT_AGE_INTERVAL_MS) {
+                lastAge = now;
+                ageClients(now);
+                deauthTick(&deauth, now);
+                surveyAge(&survey, now);
+            }
+            rogueCheckFrame(&rogue, pkt.frame, pkt.len, pkt.channel, now);
+            deauthCheckFrame(&deauth, pkt.frame, pkt.len, pkt.rssi, pkt.channel, now);
+            if (surveyFrame(&survey, pkt.frame, pkt.len, pkt.rssi, pkt.channel, now, NULL) != SV_IGNORED) {
+                continue;
+            }
+            processFrame(pkt.frame, pkt.len, pkt.rssi, NULL);
+        }
+        pcapClose(&reader);
+        if (rogueMode && f == firstFile) startRogueMonitor();
+    }
+
+    printTables();
+
+    printf("\nFrames: %lu read, %lu malformed files\n", packets, malformed);
+    printf("Parser: data=%lu unmatched=%lu probe=%lu assoc=%lu auth=%lu\n",
+           dataFrameCount, unmatchedBssidCount, probeCount, assocCount, authCount);
+    printf("Survey: frames=%u added=%u updated=%u retired=%u full=%u\n",
+           survey.frames, survey.added, survey.updated, survey.retired, survey.full);
+    printf("Changes: version=%u changes=%u suppressed=%u resets=%u\n",
+           deltaLog.version.load(), deltaLog.changes, deltaLog.suppressed, deltaLog.resets);
+    printf("Deauth: deauth=%u disassoc=%u broadcast=%u spoof=%u floods=%u spoofed=%u\n",
+           deauth.deauth, deauth.disassoc, deauth.broadcast, deauth.spoof_indicators,
+           deauth.alerts[DA_FLOOD] + deauth.alerts[DA_SRC_FLOOD], deauth.alerts[DA_SPOOFED]);
+    printf("Events: clients=%lu probe_ssids=%lu pmkid=%lu handshake=%lu rogue=%lu deauth=%lu\n",
+           hostEvents.clients_added, hostEvents.probe_ssids, hostEvents.pmkids, hostEvents.handshakes,
+           hostEvents.rogue_alerts, hostEvents.deauth_alerts);
+    return 0;
+}